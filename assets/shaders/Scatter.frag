@@ -0,0 +1,35 @@
+#version 450 core
+
+out vec4 frag_color;
+
+struct Light
+{
+    vec3 direction;
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+uniform Light light;
+uniform vec3 view_pos;
+uniform vec3 color;
+
+in vec3 frag_pos;
+in vec3 normal;
+
+void main()
+{
+    // Blades are single quads seen from both sides
+    vec3 n = normalize(normal);
+    if (!gl_FrontFacing) n = -n;
+
+    vec3 l = normalize(-light.direction);
+    vec3 v = normalize(view_pos - frag_pos);
+    vec3 h = normalize(l + v);
+
+    vec3 ambient = light.ambient * 0.5 * color;
+    vec3 diffuse = light.diffuse * max(dot(n, l), 0.0) * color;
+    vec3 specular = light.specular * pow(max(dot(n, h), 0.0), 32.0) * color * 0.2;
+
+    frag_color = vec4(ambient + diffuse + specular, 1.0);
+}
@@ -0,0 +1,18 @@
+#version 450 core
+layout (location = 0) in vec3 in_pos;
+layout (location = 1) in vec3 in_normal;
+layout (location = 4) in mat4 in_matrices;
+
+out vec3 frag_pos;
+out vec3 normal;
+
+uniform mat4 projection;
+uniform mat4 view;
+
+// Instances are only rotated about y and scaled uniformly, so the matrix itself turns the normals
+void main()
+{
+    frag_pos = vec3(in_matrices * vec4(in_pos, 1.0));
+    normal = mat3(in_matrices) * in_normal;
+    gl_Position = projection * view * vec4(frag_pos, 1.0);
+}
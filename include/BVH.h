@@ -0,0 +1,52 @@
+#pragma once
+#ifndef BVH_H
+#define BVH_H
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Utils.h"
+
+using namespace std;
+
+// Bounding volume hierarchy over the triangles of a mesh
+// The tree topology is built once in local space, later transforms only refit the bounds
+class BVH
+{
+public:
+	BVH(const vector<info::VertexLayout>& vertices, const vector<info::uint>& indices);
+	~BVH();
+
+	// Move every vertex to world space by M and recompute the node bounds bottom-up
+	void refit(const glm::mat4& M);
+
+	// Find the closest point on the mesh within max_dist of pos
+	bool closestPoint(
+		const glm::vec3& pos, float max_dist,
+		glm::vec3& closest, glm::vec3& normal) const;
+
+	inline const glm::mat4& getTransform() const { return m_transform; };
+	inline int getNumTriangles() const { return int(m_tris.size()); };
+
+private:
+	struct Node
+	{
+		glm::vec3 b_min;
+		glm::vec3 b_max;
+		int first; // First triangle for a leaf, right child for an inner node
+		int count; // 0 for an inner node, left child is always the next node
+	};
+
+	int build(int begin, int end);
+	void computeTriBounds(int begin, int end, glm::vec3& b_min, glm::vec3& b_max) const;
+
+	vector<Node> m_nodes;
+	vector<glm::ivec3> m_tris;
+	vector<glm::vec3> m_local;
+	vector<glm::vec3> m_positions;
+
+	glm::mat4 m_transform;
+};
+
+#endif // !BVH_H
@@ -23,11 +23,16 @@ private:
 
 public:
 	VertexBuffer();
+	void createBuffers(const vector<unsigned int>& indices);
 	void createBuffers(const vector<info::VertexLayout>& layouts);
 	void createBuffers(const vector<info::VertexLayout>& layouts, const vector<unsigned int>& indices);
 	void createBuffers(const vector<info::VertexLayout>& layouts, const vector<glm::vec3>& colors);
 	void updateBuffer(const vector<info::VertexLayout>& layouts);
 	void updateBuffer(const vector<info::VertexLayout>& layouts, const vector<glm::vec3>& colors);
+
+	// Instance matrices from a buffer filled elsewhere, e.g. by a compute pass
+	void setInstanceBuffer(GLuint buffer);
+
 	void bind() const;
 	void unbind() const;
 	
@@ -46,6 +51,8 @@ public:
 	inline void setMatrices(vector<glm::mat4> ms) { m_matrices = ms; };
 
 private:
+	void setupInstanceAttribs();
+
 	GLuint m_VAO;
 	GLuint m_VBO;
 	GLuint m_EBO;
@@ -6,19 +6,34 @@
 #include <iostream>
 #include <unordered_map>
 
+#include "ClothBuilder.h"
 #include "Particle.h"
 #include "Object.h"
 
 using namespace std;
 
+class BVH;
+class DeformableNormals;
+class SimValidator;
+class SleepRegions;
+class SpatialHash;
+class Terrain;
+
 class Cloth : public Object
 {
 public:
 	Cloth();
+	Cloth(const ClothBuilder& builder);
 	~Cloth();
 
 	bool getSimulate() { return m_simulate; };
-	void setSimulate(bool s) { m_simulate = s; };
+	void setSimulate(bool s);
+	void wake();
+	void setColliders(const vector<shared_ptr<Object>>& colliders) { m_colliders = colliders; };
+	void setTerrains(const vector<shared_ptr<Terrain>>& terrains) { m_terrains = terrains; };
+
+	virtual bool getIsCollider() override { return false; };
+	virtual void renderExtraProperty() override;
 
 	virtual void draw(
 		const glm::mat4& P, 
@@ -27,34 +42,86 @@ public:
 		const Light& light) override;
 
 private:
+	void init();
 	void simulate();
 	void initParticles();
-	void buildHash(vector<shared_ptr<ClothParticle>>& predict);
+	void rebuild();
+	void buildConstraintGraph();
+	void buildCollisionPairs();
+	bool isTopologicalNeighbor(int i, int j);
+	void buildSleepRegions();
+	void updateSleep();
+	void validate();
+
+	void updateStretch();
+	void updateBending(const glm::ivec4& ids, float rest_angle);
+	void updateCollision();
+	void updateMeshCollision();
+	void updateTerrainCollision();
 
-	void updateStretch(int index, vector<shared_ptr<ClothParticle>>& predict);
-	void updateBending(int index, float rest_angle, vector<ClothParticle*>& predict);
-	void updateCollision(vector<shared_ptr<ClothParticle>>& predict);
+	// Moves a world space particle penetration along normal, less the Coulomb friction of its move from prev
+	void pushOut(glm::vec3& p, const glm::vec3& prev, const glm::vec3& normal, float penetration) const;
 
-	glm::ivec3 getGridPos(glm::vec3 pos);
-	info::uint getIndex(glm::ivec3& pos);
-	info::uint getHashIndex(glm::ivec3& pos);
+	ClothBuilder m_builder;
 
 	vector<shared_ptr<ClothParticle>> m_particles;
-	unordered_map<info::uint, ClothParticle*> m_hash;
+	vector<glm::vec3> m_predict;
+	vector<float> m_inv_mass;
+	vector<ClothEdge> m_edges;
+	vector<glm::ivec4> m_bends;
+	unique_ptr<SpatialHash> m_hash;
+	unique_ptr<DeformableNormals> m_normals;
+	vector<glm::vec3> m_particle_pos;
+	vector<glm::vec3> m_particle_normals;
+
+	// Particles connected by a stretch constraint (CSR), never tested for self collision
+	vector<int> m_adj_start;
+	vector<int> m_adj_ids;
+
+	// Self collision candidates of each particle, rebuilt every substep (CSR)
+	vector<int> m_collision_start;
+	vector<int> m_collision_ids;
+	vector<glm::vec3> m_collision_pos;
+	vector<glm::vec3> m_collision_delta;
+
+	// Scene meshes the cloth collides with, refreshed every frame by ObjectManager
+	vector<shared_ptr<Object>> m_colliders;
+	vector<BVH*> m_collider_bvhs;
+	vector<glm::mat4> m_collider_transforms;
+
+	// Terrains the cloth collides with through their heightfield, refreshed every frame by ObjectManager
+	vector<shared_ptr<Terrain>> m_terrains;
+	vector<glm::vec3> m_terrain_pos;
+	vector<float> m_terrain_heights;
+	vector<glm::vec3> m_terrain_normals;
+
+	// Tiles of the particle grid that stop simulating once they settle
+	unique_ptr<SleepRegions> m_sleep;
+	vector<int> m_particle_region;
+	vector<float> m_region_energy;
+	vector<int> m_region_count;
+	glm::mat4 m_sleep_transform;
+	int m_sleep_cols;
+
+	// Debug build checks after every step
+	unique_ptr<SimValidator> m_validator;
+	vector<glm::vec3> m_validation_vel;
 
 	vector<info::VertexLayout> m_layouts;
 	vector<info::uint> m_indices;
 
 	float m_scale;
-	float m_width;
-	float m_height;
-	float m_depth;
+	int m_cols;
+	int m_rows;
 
 	float t;
 	float n_sub_steps;
 	float t_sub;
 
 	float m_rest;
+	float m_thickness;
+	float m_mesh_thickness;
+	float m_friction;
 
 	bool m_simulate;
 };
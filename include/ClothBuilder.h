@@ -0,0 +1,62 @@
+#pragma once
+#ifndef CLOTHBUILDER_H
+#define CLOTHBUILDER_H
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Utils.h"
+
+using namespace std;
+
+struct ClothEdge
+{
+	int a;
+	int b;
+	float rest;
+};
+
+// Everything Cloth needs to simulate and draw a sheet, one particle per render vertex
+struct ClothData
+{
+	vector<info::VertexLayout> layouts;
+	vector<info::uint> indices;
+	vector<bool> pinned;
+
+	vector<ClothEdge> edges;	// Stretch constraints
+	vector<glm::ivec4> bends;	// Shared edge (x, y) and the two opposite particles (z, w)
+
+	int cols;
+	int rows;
+	float spacing;
+};
+
+// Generates a flat cloth on the XZ plane with square cells
+class ClothBuilder
+{
+public:
+	ClothBuilder(float width = 16.0f, float height = 16.0f, int resolution = 33);
+
+	// Pin the particle nearest to (u, v), both in [0, 1] across the width and height
+	void pin(float u, float v);
+	void pinRow(float v);
+	inline void clearPins() { m_pins.clear(); m_pin_rows.clear(); };
+
+	ClothData build() const;
+
+	inline void setResolution(int resolution) { m_resolution = max(2, resolution); };
+	inline int& getResolution() { return m_resolution; };
+	inline float getWidth() const { return m_width; };
+	inline float getHeight() const { return m_height; };
+
+private:
+	vector<glm::vec2> m_pins;
+	vector<float> m_pin_rows;
+
+	float m_width;
+	float m_height;
+	int m_resolution; // Particles along the width
+};
+
+#endif // !CLOTHBUILDER_H
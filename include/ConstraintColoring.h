@@ -0,0 +1,29 @@
+#pragma once
+#ifndef CONSTRAINTCOLORING_H
+#define CONSTRAINTCOLORING_H
+
+#include <vector>
+
+using namespace std;
+
+// Greedy graph colouring of constraints, two constraints sharing a particle never get the same colour
+// Constraints of one colour touch disjoint particles, so each colour can be projected in parallel
+class ConstraintColoring
+{
+public:
+	ConstraintColoring();
+
+	// ids holds arity particle indices per constraint
+	void build(const vector<int>& ids, int arity, int num_particles);
+
+	// Constraints ordered by colour, colour c owns getOrder()[getColorStart()[c] .. getColorStart()[c + 1])
+	inline const vector<int>& getOrder() const { return m_order; };
+	inline const vector<int>& getColorStart() const { return m_color_start; };
+	inline int getNumColors() const { return int(m_color_start.size()) - 1; };
+
+private:
+	vector<int> m_order;
+	vector<int> m_color_start;
+};
+
+#endif // !CONSTRAINTCOLORING_H
@@ -0,0 +1,45 @@
+#pragma once
+#ifndef DEFORMABLENORMALS_H
+#define DEFORMABLENORMALS_H
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Utils.h"
+
+using namespace std;
+
+// Smooth vertex normals for meshes whose positions change every frame but whose topology does not
+// The vertex to face adjacency is built once (CSR), normals are then area weighted and computed in parallel
+class DeformableNormals
+{
+public:
+	DeformableNormals();
+	DeformableNormals(const vector<info::uint>& indices, int num_vertices, bool flip = false);
+
+	void build(const vector<info::uint>& indices, int num_vertices, bool flip = false);
+
+	// normals[i] is the normalized sum of the (area weighted) normals of the faces around vertex i
+	void compute(const vector<glm::vec3>& positions, vector<glm::vec3>& normals);
+	void compute(vector<info::VertexLayout>& layouts);
+
+	inline int getNumVertices() const { return int(m_vertex_start.size()) - 1; };
+	inline int getNumFaces() const { return int(m_faces.size()); };
+
+private:
+	vector<glm::ivec3> m_faces;
+	vector<glm::vec3> m_face_normals;
+
+	// Faces around each vertex (CSR)
+	vector<int> m_vertex_start;
+	vector<int> m_vertex_faces;
+
+	// Scratch buffers for the layout overload
+	vector<glm::vec3> m_positions;
+	vector<glm::vec3> m_normals;
+
+	bool m_flip;
+};
+
+#endif // !DEFORMABLENORMALS_H
@@ -0,0 +1,42 @@
+#pragma once
+#ifndef HEIGHTMAP_H
+#define HEIGHTMAP_H
+
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+using namespace std;
+
+// Heights and normals of square grids kept in two float texture arrays, one layer per grid
+// Edits upload only the dirty rectangle of a layer, the rest of the textures is never touched again
+class HeightMap
+{
+public:
+	HeightMap(int res, int num_layers = 1);
+	~HeightMap();
+
+	// heights and normals : res * res values, row major with x fastest
+	void upload(int layer, const vector<float>& heights, const vector<glm::vec3>& normals);
+
+	// Uploads grid vertices [x0, x1] x [z0, z1] of each array into layer
+	void updateHeights(int layer, const vector<float>& heights, int x0, int z0, int x1, int z1);
+	void updateNormals(int layer, const vector<glm::vec3>& normals, int x0, int z0, int x1, int z1);
+
+	void bind(int height_unit, int normal_unit) const;
+
+	inline int getRes() const { return m_res; };
+	inline int getNumLayers() const { return m_num_layers; };
+
+private:
+	void updateRect(GLuint texture, GLenum format, int layer, const void* data, int stride, int x0, int z0, int x1, int z1);
+
+	GLuint m_height_texture;
+	GLuint m_normal_texture;
+
+	int m_res;
+	int m_num_layers;
+};
+
+#endif // !HEIGHTMAP_H
@@ -0,0 +1,67 @@
+#pragma once
+#ifndef HEIGHTPYRAMID_H
+#define HEIGHTPYRAMID_H
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+using namespace std;
+
+// Min/max mip pyramid over the cells of a square heightfield, a quadtree of height bounds
+// Level 0 holds one bound per grid cell, every level above merges 2x2 cells of the level below.
+// Rays are traversed top down and near child first, so a hit only visits the nodes along the ray.
+class HeightPyramid
+{
+public:
+	HeightPyramid();
+
+	// heights : res * res grid heights, row major with x fastest
+	void build(const vector<float>& heights, int res);
+
+	// Refreshes the bounds of the cells touching grid vertices [x0, x1] x [z0, z1] and their parents
+	void update(const vector<float>& heights, int x0, int z0, int x1, int z1);
+
+	// origin : world position of grid vertex (0, 0) in x and z, spacing : distance between grid vertices
+	// Returns the closest hit along ray_dir with its ray parameter and the grid cell it landed in
+	bool intersect(
+		const glm::vec3& ray_dir,
+		const glm::vec3& ray_pos,
+		const glm::vec2& origin,
+		const glm::vec2& spacing,
+		float& t,
+		glm::ivec2& cell) const;
+
+	// Slab test, returns the entry and exit parameter of the ray in the box
+	static bool intersectBox(
+		const glm::vec3& ray_dir,
+		const glm::vec3& ray_pos,
+		const glm::vec3& box_min,
+		const glm::vec3& box_max,
+		float& t_near,
+		float& t_far);
+
+	inline int getNumLevels() const { return int(m_levels.size()); };
+	inline float getMin() const { return m_levels.empty() ? 0.0f : m_levels.back()[0].x; };
+	inline float getMax() const { return m_levels.empty() ? 0.0f : m_levels.back()[0].y; };
+
+private:
+	void updateLevel(int level, int x0, int z0, int x1, int z1);
+
+	bool intersectCell(
+		const glm::vec3& ray_dir,
+		const glm::vec3& ray_pos,
+		const glm::vec2& origin,
+		const glm::vec2& spacing,
+		int x, int z,
+		float& t) const;
+
+	// Bounds (min, max) of each node, one array per level from the cells up to the root
+	vector<vector<glm::vec2>> m_levels;
+	vector<int> m_sizes;
+
+	const vector<float>* m_heights;
+	int m_res;
+};
+
+#endif // !HEIGHTPYRAMID_H
@@ -10,6 +10,7 @@
 #include "imgui-docking/imgui_impl_opengl3.h"
 
 #include "FileDialog.h"
+#include "Profiler.h"
 
 class Object;
 class ObjectCollection;
@@ -107,4 +108,22 @@ public:
 	
 };
 
+#if PROFILING
+class ProfilerPanel : public ImGuiPanel
+{
+public:
+	ProfilerPanel();
+	~ProfilerPanel();
+	virtual void render(
+		shared_ptr<ObjectCollection>& collection,
+		shared_ptr<Object>& clicked_object) override;
+
+private:
+	void renderFlameGraph(const Profiler::Frame& frame);
+	void renderZoneTable(const Profiler::Frame& frame);
+
+	vector<float> m_frame_times;
+};
+#endif
+
 #endif // !IMGUIPANEL_H
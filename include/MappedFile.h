@@ -0,0 +1,36 @@
+#pragma once
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+
+using namespace std;
+
+// Read only view of a whole file
+// Pages are read by the OS when first touched, so looking at a few records of a large file costs only those.
+class MappedFile
+{
+public:
+	MappedFile(const string& path);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	inline const char* getData() const { return m_data; };
+	inline size_t getSize() const { return m_size; };
+
+private:
+	const char* m_data;
+	size_t m_size;
+
+#ifdef _WIN32
+	void* m_file;
+	void* m_mapping;
+#else
+	int m_fd;
+#endif
+};
+
+#endif // !MAPPEDFILE_H
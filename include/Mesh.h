@@ -30,11 +30,16 @@ public:
 	void drawInstance();
 	void drawTess(const Shader& shader, float res);
 
+	// Instanced draw whose command sits at offset in the bound GL_DRAW_INDIRECT_BUFFER
+	void drawIndirect(GLintptr offset);
+
 	void renderProperty(Sphere& preview_object, const FrameBuffer& preview_fb);
 
 	inline bool intersect(const glm::vec3& ray_dir, const glm::vec3& ray_pos) { return m_bbox->intersect(ray_dir, ray_pos); };
 	inline void updateBuffer(const vector<info::VertexLayout>& layouts) { m_buffer->updateBuffer(layouts); };
 	inline void setupBuffer(const vector<info::VertexLayout>& vertices) { m_buffer->createBuffers(vertices); };
+	inline void setupBuffer(const vector<info::uint>& indices) { m_buffer->createBuffers(indices); };
+	inline void setInstanceBuffer(GLuint buffer) { m_buffer->setInstanceBuffer(buffer); };
 	inline void setupBuffer(
 		const vector<info::VertexLayout>& vertices,
 		const vector<info::uint>& indices) {
@@ -13,6 +13,7 @@
 #include "Transform.h"
 
 class SoftBodySolver;
+class BVH;
 class Material;
 class Sphere;
 class FrameBuffer;
@@ -85,11 +86,15 @@ public:
 
 	inline vector<info::VertexLayout> getVertices() { return m_mesh->getVertices(); };
 	inline vector<info::uint> getIndices() { return m_mesh->getIndices(); };
+
+	// Objects with an indexed triangle mesh collide with simulated cloth by default
+	virtual bool getIsCollider() { return m_mesh != nullptr && m_mesh->getSizeIndices() > 1; };
+	BVH* getBVH();
 	
 protected:
 	inline void updateBuffer(const vector<info::VertexLayout>& layouts) { m_mesh->updateBuffer(layouts); };
 	inline void setBBoxMinMax(const glm::vec3& b_min, const glm::vec3& b_max) { m_mesh->setMinMax(b_min, b_max); };
-	void computeBBox();
+	virtual void computeBBox();
 	void drawTessMesh(const glm::mat4& P, const glm::mat4& V, const Shader& shader, float res);
 
 private:
@@ -97,6 +102,7 @@ private:
 	Transform::Type m_transform_type;
 
 	shared_ptr<Mesh> m_mesh;
+	shared_ptr<BVH> m_bvh;
 
 	string m_name_id;
 	string m_name;
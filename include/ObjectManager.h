@@ -8,6 +8,7 @@ class SPHSystemCuda;
 class Terrain;
 class Cloth;
 class SoftBodyObject;
+class SoftBodyWorld;
 
 class ObjectManager
 {
@@ -15,6 +16,8 @@ public:
 	ObjectManager(ObjectManager const&) = delete;
 	ObjectManager& operator=(ObjectManager const&) = delete;
 
+	~ObjectManager();
+
 	static ObjectManager* getObjectManager();
 
 	inline int getNumObjects() { return m_objects.size(); };
@@ -36,6 +39,8 @@ public:
 	void addCloth(const shared_ptr<Cloth>& cloth);
 	void addSoftBody(const shared_ptr<SoftBodyObject>& soft);
 
+	inline SoftBodyWorld* getSoftBodyWorld() { return m_soft_world.get(); };
+
 	bool checkObjectClick(
 		shared_ptr<Object>& clicked_object,
 		const glm::vec3& ray_dir, const glm::vec3& ray_pos);
@@ -55,11 +60,16 @@ public:
 		const Shader& shader);
 
 private:
+	void updateClothColliders();
+	void updateTerrainColliders();
+	void updateSoftBodies();
+
 	vector<shared_ptr<Object>> m_objects;
 	vector<weak_ptr<SPHSystemCuda>> m_fluids;
 	vector<weak_ptr<Terrain>> m_terrains;
 	vector<weak_ptr<Cloth>> m_clothes;
 	vector<weak_ptr<SoftBodyObject>> m_softs;
+	unique_ptr<SoftBodyWorld> m_soft_world;
 	unordered_map<string, vector<int>> m_object_ids;
 
 	static unique_ptr<ObjectManager> m_object_manager;
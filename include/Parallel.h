@@ -0,0 +1,44 @@
+#pragma once
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <execution>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace parallel
+{
+	// Split [0, n) into contiguous blocks and run each block on the standard parallel algorithms.
+	// func(i) is called exactly once per index, so it only has to be safe across different indices.
+	template <typename Func>
+	inline void forEach(int n, Func func, int min_block = 256)
+	{
+		if (n <= 0) return;
+
+		int n_threads = max(1, int(thread::hardware_concurrency()));
+		int block = max(min_block, (n + n_threads * 4 - 1) / (n_threads * 4));
+		int n_blocks = (n + block - 1) / block;
+
+		if (n_blocks == 1)
+		{
+			for (int i = 0; i < n; ++i) func(i);
+			return;
+		}
+
+		vector<int> blocks(n_blocks);
+		for (int b = 0; b < n_blocks; ++b) blocks[b] = b;
+
+		for_each(execution::par, blocks.begin(), blocks.end(),
+			[&](int b)
+			{
+				int begin = b * block;
+				int end = min(n, begin + block);
+				for (int i = begin; i < end; ++i) func(i);
+			});
+	}
+}
+
+#endif // !PARALLEL_H
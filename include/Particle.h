@@ -39,9 +39,7 @@ class ClothParticle : public Particle
 {
 public:
 	ClothParticle(glm::vec3);
-	ClothParticle* m_next;
 
-	vector<int> m_ids;
 	float m_mass;
 	bool m_pinned;
 };
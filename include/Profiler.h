@@ -0,0 +1,130 @@
+#pragma once
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+
+using namespace std;
+
+// Profiling runs in debug builds, release builds compile every zone out of the renderer.
+// Define PROFILING as 1 in the project settings to profile an optimized build.
+#ifndef PROFILING
+#ifdef _DEBUG
+#define PROFILING 1
+#else
+#define PROFILING 0
+#endif
+#endif
+
+#if PROFILING
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+// Once at the start of every frame
+#define PROFILE_FRAME() Profiler::getProfiler()->beginFrame()
+
+// Zones last until the end of the enclosing scope, name has to be a string literal
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__)(name, false)
+#define PROFILE_GPU_SCOPE(name) ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__)(name, true)
+#else
+#define PROFILE_FRAME()
+#define PROFILE_SCOPE(name)
+#define PROFILE_GPU_SCOPE(name)
+#endif
+
+#if PROFILING
+
+// Frame profiler of nested CPU zones and GPU render passes
+// A GPU zone wraps its pass in a GL_TIME_ELAPSED query. Each frame has its own set of queries and reads them
+// back frames later, once they are available, so the CPU never waits on the GPU. Only one GL_TIME_ELAPSED query
+// can run at a time, a GPU zone opened inside another one is timed on the CPU only.
+class Profiler
+{
+public:
+	struct Zone
+	{
+		const char* name;
+		int depth;
+
+		// Milliseconds, start since the profiler was created
+		double cpu_start;
+		double cpu_ms;
+		double gpu_ms;		// Negative without a GPU timing
+
+		int query;			// Into the query set of the frame, -1 for CPU zones
+	};
+
+	struct Frame
+	{
+		vector<Zone> zones;
+		long long index;
+		double start;
+		double cpu_ms;
+		int num_queries;
+	};
+
+	Profiler(Profiler const&) = delete;
+	Profiler& operator=(Profiler const&) = delete;
+
+	~Profiler();
+
+	static Profiler* getProfiler();
+
+	// Closes the last frame and reads back the GPU timings that are ready
+	void beginFrame();
+
+	int beginZone(const char* name, bool is_gpu);
+	void endZone(int zone);
+
+	// Recorded frames as Chrome trace_event JSON, GPU passes on their own track starting with their CPU zone
+	bool writeTrace(const string& path) const;
+
+	// Latest frame with its GPU timings, nullptr before the first one is read back
+	inline const Frame* getLastFrame() const { return m_history.empty() ? nullptr : &m_history.back(); };
+	inline const deque<Frame>& getHistory() const { return m_history; };
+	inline bool& getIsPaused() { return m_is_paused; };
+
+private:
+	Profiler();
+
+	double getTime() const;
+
+	// false when the queries of the frame are not available yet and wait is false
+	bool readQueries(Frame& frame, bool wait);
+
+	Frame m_current;
+	deque<Frame> m_pending;
+	deque<Frame> m_history;
+
+	// One set of queries per frame in flight, reused once its frame is read back
+	vector<vector<GLuint>> m_queries;
+
+	chrono::steady_clock::time_point m_epoch;
+	long long m_frame_index;
+	int m_depth;
+	bool m_is_gpu_open;
+	bool m_is_paused;
+
+	static unique_ptr<Profiler> m_profiler;
+};
+
+// Zone from construction to the end of the scope
+class ProfileScope
+{
+public:
+	ProfileScope(const char* name, bool is_gpu) : m_zone(Profiler::getProfiler()->beginZone(name, is_gpu)) {};
+	~ProfileScope() { Profiler::getProfiler()->endZone(m_zone); };
+
+private:
+	int m_zone;
+};
+
+#endif // PROFILING
+
+#endif // !PROFILER_H
@@ -0,0 +1,69 @@
+#pragma once
+#ifndef SDFBAKER_H
+#define SDFBAKER_H
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Utils.h"
+
+using namespace std;
+
+// Signed distance field of a closed triangle mesh on a regular grid, negative inside
+// Reference : Robert Bridson, makelevelset3 (exact narrow band, sweeping, ray parity)
+// Every pass is split over independent slices or grid lines, so the result does not depend on thread count
+class SDFBaker
+{
+public:
+	SDFBaker(const glm::vec3& origin, float dx, int ni, int nj, int nk, int exact_band = 1);
+
+	void bake(const vector<glm::vec3>& vertices, const vector<glm::ivec3>& tris);
+	void bake(const vector<glm::vec3>& vertices, const vector<info::uint>& indices);
+
+	// Trilinear sample and central difference gradient, clamped to the grid
+	float sample(const glm::vec3& pos) const;
+	glm::vec3 gradient(const glm::vec3& pos) const;
+
+	inline float getPhi(int i, int j, int k) const { return m_phi[getIndex(i, j, k)]; };
+	inline const vector<float>& getPhi() const { return m_phi; };
+	inline const glm::vec3& getOrigin() const { return m_origin; };
+	inline float getDx() const { return m_dx; };
+	inline int getNi() const { return m_ni; };
+	inline int getNj() const { return m_nj; };
+	inline int getNk() const { return m_nk; };
+
+	// Bake the mesh at several resolutions and print the timings
+	static void benchmark(
+		const vector<glm::vec3>& vertices, const vector<info::uint>& indices,
+		const glm::vec3& b_min, const glm::vec3& b_max);
+
+private:
+	inline int getIndex(int i, int j, int k) const { return i + m_ni * (j + m_nj * k); };
+
+	void computeNarrowBand();
+	void sweep(int axis, int dir);
+	void computeSign();
+
+	float distanceToTri(const glm::vec3& p, int t) const;
+
+	const vector<glm::vec3>* m_vertices;
+	const vector<glm::ivec3>* m_tris;
+
+	// Triangles overlapping each k slice, so that each slice is owned by one task
+	vector<int> m_slice_start;
+	vector<int> m_slice_tris;
+
+	vector<float> m_phi;
+	vector<int> m_closest_tri;
+	vector<int> m_intersections;
+
+	glm::vec3 m_origin;
+	float m_dx;
+	int m_ni;
+	int m_nj;
+	int m_nk;
+	int m_exact_band;
+};
+
+#endif // !SDFBAKER_H
@@ -21,12 +21,16 @@ __device__ glm::vec3* d_force;
 __device__ float* d_density;
 __device__ float* d_pressure;
 
+// Normal and height of the terrain under the box, xyz and w
+__device__ glm::vec4* d_terrain;
+
 __device__ glm::ivec3 getHashPos_kernel(const glm::vec3&);
 __device__ info::uint getHashKey_kernel(const glm::ivec3&);
 
 void computeBlocks(int n);
 cudaError_t setParams(info::SPHParams* params);
 cudaError_t setHash(vector<int>& hash, vector<int>& neighbors);
+cudaError_t setTerrain(const vector<glm::vec4>& samples);
 cudaError_t copyToCuda(
 	int n,
 	vector<glm::vec3>& pos,
@@ -41,6 +45,9 @@ cudaError_t copyFromCuda(
 
 cudaError_t simulateCuda(int n, float t, vector<glm::vec3>& pos);
 
+// Velocities of the last step, for the debug validator
+cudaError_t copyVelocityFromCuda(int n, vector<glm::vec3>& h_vel);
+
 cudaError_t freeResources();
 
 __global__ void updateDensPress_kernel(
@@ -66,7 +73,8 @@ __global__ void updatePosition_kernel(
 	glm::vec3* pos,
 	glm::vec3* vel,
 	glm::vec3* force,
-	float* density);
+	float* density,
+	glm::vec4* terrain);
 
 __global__ void fillHash_kernel(
 	int n, 
@@ -46,6 +46,7 @@ public:
     
     virtual void update();
     virtual void draw();
+    virtual bool getIsCollider() override { return false; };
     
     virtual void setupFrame(const glm::mat4& V, const Camera& camera);
 
@@ -10,6 +10,8 @@
 //#include "Particle.h"
 
 class FluidParticle;
+class SimValidator;
+class Terrain;
 
 // Host
 class SPHSystemCuda : public Object
@@ -29,8 +31,10 @@ public:
 	
 	void setupFrameBuffer(const glm::mat4& SP, const glm::mat4& P, const glm::mat4& V);
 	virtual void renderExtraProperty() override;
+	virtual bool getIsCollider() override { return false; };
 
 	inline void setIsSimulate(bool simulate) { m_simulation = simulate; };
+	inline void setTerrains(const vector<shared_ptr<Terrain>>& terrains) { m_terrains = terrains; };
 
 private:
 	void initParticle();
@@ -40,12 +44,26 @@ private:
 	void getCurvature(const glm::mat4& P, const glm::mat4& V);
 	void getNormal(const glm::mat4& P, const glm::mat4& V);
 	void reset();
+	void updateTerrain();
+	void validate(const vector<glm::vec3>& new_pos);
 
 	vector<shared_ptr<FluidParticle>> m_particles;
 	vector<int> m_neighbors;
 	vector<int> m_hash;
 
 	unique_ptr<Point> m_point;
+
+	// Terrains under the box, sampled on a grid over it every step for the position kernel
+	vector<shared_ptr<Terrain>> m_terrains;
+	vector<glm::vec3> m_terrain_pos;
+	vector<float> m_terrain_heights;
+	vector<glm::vec3> m_terrain_normals;
+	vector<glm::vec4> m_terrain_samples;
+
+	// Debug build checks after every step, velocities are taken from the change of positions
+	unique_ptr<SimValidator> m_validator;
+	vector<glm::vec3> m_validation_pos;
+	vector<glm::vec3> m_validation_vel;
 	
 	unique_ptr<ShadowBuffer> m_fb;
 	unique_ptr<ShadowBuffer> m_fb_curvature;
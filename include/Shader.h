@@ -34,6 +34,7 @@ public:
 	void setVec2(const string& name, const glm::vec2& vector) const;
 	void setVec3(const string& name, const glm::vec3& vector) const;
 	void setVec3(const string& name, float x, float y, float z) const;
+	void setVec4(const string& name, const glm::vec4& vector) const;
 	void setMat4(const string& name, const glm::mat4& matrix) const;
 	void setPVM(const glm::mat4& P, const glm::mat4& V, const glm::mat4& m) const;
 	void setLight(const Light& light) const;
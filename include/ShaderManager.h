@@ -25,13 +25,14 @@ class ShaderManager
 {
 public:
 	static void createShader(const string& name, const vector<string>& paths);
+	static void createComputeShader(const string& name, const string& path);
 	static shared_ptr<Shader> getShader(const string& name);
 
 private:
 	ShaderManager() = delete;
 
 	static unordered_map<string, shared_ptr<Shader>> shader_cache;
-	static shared_ptr<Shader> compileShader(const string& name, const vector<string>& paths);
+	static shared_ptr<Shader> compileShader(const string& name, const vector<string>& paths, const vector<GLenum>& shader_types);
 	static bool readShader(const string& filePath, GLenum shaderType, GLuint& outShader);
 	static bool isCompiled(const GLuint& shader);
 
@@ -0,0 +1,55 @@
+#pragma once
+#ifndef SIMVALIDATOR_H
+#define SIMVALIDATOR_H
+
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+using namespace std;
+
+// Validation runs in debug builds only, release builds compile every check out of the solvers
+#ifdef _DEBUG
+#define SIM_VALIDATION 1
+#else
+#define SIM_VALIDATION 0
+#endif
+
+// Checks the state of a simulation after each step
+// The first failure writes a reproducer (reason, parameters and every watched array) to assets/repro and asserts
+class SimValidator
+{
+public:
+	SimValidator(const string& name);
+
+	// Arrays written into the reproducer, they have to outlive the validator
+	void watch(const string& name, const vector<glm::vec3>* values);
+	void setParam(const string& name, float value);
+
+	// Call once per step before the checks
+	void beginStep();
+
+	bool checkFinite(const vector<glm::vec3>& values, const string& what);
+
+	// energy : mean kinetic energy per particle, fails on a jump far above the running average
+	bool checkEnergy(float energy);
+
+	// violation : largest constraint error of the step, in the unit of tolerance
+	bool checkConstraint(float violation, float tolerance, const string& what);
+
+	inline bool getHasFailed() const { return m_has_failed; };
+
+private:
+	void fail(const string& reason);
+
+	vector<pair<string, const vector<glm::vec3>*>> m_watched;
+	vector<pair<string, float>> m_params;
+
+	string m_name;
+	float m_energy_avg;
+	int m_step;
+	bool m_has_failed;
+};
+
+#endif // !SIMVALIDATOR_H
@@ -0,0 +1,41 @@
+#pragma once
+#ifndef SLEEPREGIONS_H
+#define SLEEPREGIONS_H
+
+#include <vector>
+
+using namespace std;
+
+// Tracks the kinetic energy of groups of particles and puts groups that stay calm to sleep
+// A sleeping region is neither integrated nor uploaded until something wakes it up
+class SleepRegions
+{
+public:
+	SleepRegions(int num_regions = 1);
+
+	void resize(int num_regions);
+
+	// energy : mean kinetic energy per unit mass of the region in the last frame
+	void update(int region, float energy);
+
+	void wake(int region);
+	void wakeAll();
+
+	inline bool isAsleep(int region) const { return m_frames[region] >= m_sleep_frames; };
+	inline bool isAllAsleep() const { return m_num_asleep == int(m_frames.size()); };
+	inline int getNumRegions() const { return int(m_frames.size()); };
+	inline int getNumAsleep() const { return m_num_asleep; };
+
+	inline float& getThreshold() { return m_threshold; };
+	inline void setThreshold(float threshold) { m_threshold = threshold; };
+
+private:
+	// Number of consecutive calm frames of each region
+	vector<int> m_frames;
+
+	float m_threshold;
+	int m_sleep_frames;
+	int m_num_asleep;
+};
+
+#endif // !SLEEPREGIONS_H
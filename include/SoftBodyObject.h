@@ -3,6 +3,7 @@
 #ifndef SOFTBODYOBJECT_H
 #define SOFTBODYOBJECT_H
 
+#include <atomic>
 #include <unordered_map>
 
 #include "glm/gtx/string_cast.hpp"
@@ -13,11 +14,29 @@
 
 #include "Mesh.h"
 #include "Object.h"
+#include "TetCache.h"
 
-class SoftParticle;
+class DeformableNormals;
 class Light;
+struct SoftBody;
 class Transform;
 
+// Tetrahedralization running on a worker thread
+struct TetJob
+{
+	enum Stage
+	{
+		LOAD_CACHE = 0,
+		SIGNED_DISTANCE,
+		TET_MESH,
+		SAVE_CACHE
+	};
+
+	TetData data;
+	atomic<int> stage{ LOAD_CACHE };
+	atomic<bool> is_done{ false };
+};
+
 class SoftBodyObject : public Object
 {
 public:
@@ -35,43 +54,57 @@ public:
 		const glm::vec3& view_pos,
 		const Light& light) override;
 
-	void simulate();
+	virtual bool getIsCollider() override { return false; };
+	virtual void renderExtraProperty() override;
 
-	inline void setSimulate(bool simulate) { m_simulate = simulate; };
+	void setSimulate(bool simulate);
+	void wake();
 
 	inline bool getSimulate() { return m_simulate; };
 
+	// Null until the tet mesh is ready, then solved by the SoftBodyWorld of the ObjectManager
+	inline const shared_ptr<SoftBody>& getBody() { return m_body; };
+
 private:
 	vector<glm::vec3> transformVertices(
 		const vector<info::VertexLayout>& vertices);
 
-	void getTet(
+	void setupPlaceholder(
+		const vector<info::VertexLayout>& vertices,
+		const vector<glm::vec3>& transformed_vertices,
+		const vector<info::uint>& indices);
+	bool updateJob();
+
+	// Runs on the worker, must not touch the object
+	static void getTet(
 		const vector<glm::vec3>& vertices,
 		const vector<info::uint>& indices,
+		float dx,
 		const glm::vec3& b_min, 
-		const glm::vec3& b_max);
+		const glm::vec3& b_max,
+		TetJob& job);
 	
-	void getTetVertices(const TetMesh& tet_mesh);
-	void solveDistance(vector<glm::vec3>& predict);
-	void solveVolume(vector<glm::vec3>& predict);
-
-	void reset();
+	static void computeTetData(const TetMesh& tet_mesh, TetData& data);
+	static void colorTetData(TetData& data);
+	static void computeSkinning(const vector<glm::vec3>& surface, TetData& data);
+	void getTetVertices(const TetData& data);
+	void updateSurface();
 	
-	vector<shared_ptr<SoftParticle>> m_tets;
-	vector<info::VertexLayout> m_tet_vertices_og;
-	vector<info::VertexLayout> m_tet_vertices;
-	vector<info::uint> m_tet_indices;
-	vector<info::uint> m_faces;
-	vector<float> m_rest_d;
-	vector<float> m_rest_v;
+	shared_ptr<SoftBody> m_body;
+	unique_ptr<DeformableNormals> m_normals;
+	shared_ptr<TetJob> m_job;
+
+	// Rendered surface, each vertex follows one tet through fixed barycentric weights
+	vector<info::VertexLayout> m_surface_vertices;
+	vector<info::uint> m_surface_indices;
+	vector<int> m_skin_tets;
+	vector<glm::vec3> m_skin_weights;
 	
 	float m_dx;
-	float t;
-	float n_sub_steps;
-	float t_sub;
 	
 	bool m_simulate;
 	bool m_reset;
+	bool m_is_ready;
 };
 
 #endif // !SOFTBODYOBJECT_H
\ No newline at end of file
@@ -0,0 +1,152 @@
+#pragma once
+#ifndef SOFTBODYWORLD_H
+#define SOFTBODYWORLD_H
+
+#include <array>
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "TetCache.h"
+
+using namespace std;
+
+class SimValidator;
+class SleepRegions;
+class SpatialHash;
+class Terrain;
+
+// Rest state and parameters of one soft body, shared between the object drawing it and the world solving it
+// Indices are local to the body, constraints are sorted by colour
+struct SoftBody
+{
+	enum Model
+	{
+		EDGE_VOLUME = 0,	// Edge length and tet volume constraints
+		NEO_HOOKEAN			// Stable Neo-Hookean strain energy per tet
+	};
+
+	SoftBody(const TetData& data);
+
+	vector<glm::vec3> rest_positions;
+	vector<glm::ivec2> edges;
+	vector<float> rest_d;
+	vector<int> edge_colors;
+	vector<glm::ivec4> tets;
+	vector<float> rest_v;
+	vector<int> tet_colors;
+
+	// Current positions, written back by the world after every step that moved the body
+	vector<glm::vec3> positions;
+
+	int model;
+	float edge_compliance;
+	float volume_compliance;
+	float youngs_modulus;
+	float poisson_ratio;
+	float damping;
+
+	// Requests picked up by the next step
+	bool simulate;
+	bool reset;
+	bool wake;
+
+	// Set by the world when positions changed
+	bool moved;
+
+	// Place in the world, -1 until the body is packed
+	int slot;
+	int particle_begin;
+};
+
+// Solves every soft body of the scene at once
+// Particles and constraints of all bodies are packed into one set of arrays and merged colour by colour,
+// so each colour of the whole world is a single parallel pass. Bodies collide through one shared spatial hash.
+class SoftBodyWorld
+{
+public:
+	SoftBodyWorld();
+	~SoftBodyWorld();
+
+	// Bodies are held weakly, a body is dropped from the world once its object is gone
+	void addBody(const shared_ptr<SoftBody>& body);
+
+	// Terrains the bodies land on, refreshed every frame by ObjectManager
+	inline void setTerrains(const vector<shared_ptr<Terrain>>& terrains) { m_terrains = terrains; };
+
+	void step();
+
+	inline int getNumBodies() const { return int(m_bodies.size()); };
+	inline int getNumParticles() const { return int(m_positions.size()); };
+	inline float& getRadius() { return m_radius; };
+	inline int& getIterations() { return n_iterations; };
+
+private:
+	bool lockBodies();
+	void pack();
+	void solveDistance();
+	void solveVolume();
+	void solveNeoHookean();
+	void solveNeoHookeanBlock(int first, int count);
+	void solveCollision();
+	void solveTerrain();
+	void validate();
+
+	vector<weak_ptr<SoftBody>> m_pending;
+	vector<weak_ptr<SoftBody>> m_bodies;
+
+	// Bodies locked for the duration of a step
+	vector<shared_ptr<SoftBody>> m_live;
+
+	// Particles of all bodies
+	vector<glm::vec3> m_positions;
+	vector<glm::vec3> m_predict;
+	vector<glm::vec3> m_velocities;
+	vector<float> m_inv_mass;
+	vector<int> m_particle_body;
+
+	// Constraints of all bodies with global indices, colour c of every body is merged into colour c of the world
+	vector<glm::ivec2> m_edges;
+	vector<float> m_rest_d;
+	vector<int> m_edge_colors;
+	vector<glm::ivec4> m_tets;
+	vector<float> m_rest_v;
+	vector<int> m_tet_colors;
+
+	// Inverse rest matrix of each tet, one array per entry (row * 3 + col) so blocks of tets load contiguous lanes
+	array<vector<float>, 9> m_inv_rest;
+
+	// Lagrange multipliers of the deviatoric and hydrostatic constraint of each tet, reset every substep
+	vector<float> m_tet_lambda_d;
+	vector<float> m_tet_lambda_h;
+
+	// Per body state of the current step
+	vector<char> m_active;
+	vector<int> m_model;
+	vector<float> m_edge_alpha;
+	vector<float> m_volume_alpha;
+	vector<float> m_mu;
+	vector<float> m_lambda;
+
+	// Inter body collision
+	unique_ptr<SpatialHash> m_hash;
+	vector<glm::vec3> m_collision_delta;
+	vector<int> m_contact_body;
+	float m_radius;
+
+	// Heightfield collision
+	vector<shared_ptr<Terrain>> m_terrains;
+	vector<float> m_terrain_heights;
+	vector<glm::vec3> m_terrain_normals;
+
+	unique_ptr<SleepRegions> m_sleep;
+	unique_ptr<SimValidator> m_validator;
+
+	float t;
+	float n_sub_steps;
+	float t_sub;
+	int n_iterations;
+};
+
+#endif // !SOFTBODYWORLD_H
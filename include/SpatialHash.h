@@ -0,0 +1,69 @@
+#pragma once
+#ifndef SPATIALHASH_H
+#define SPATIALHASH_H
+
+#include <algorithm>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Utils.h"
+
+using namespace std;
+
+// Dense hash grid built by counting sort
+// Reference : Matthias Muller, Ten Minute Physics, "Spatial hashing"
+class SpatialHash
+{
+public:
+	SpatialHash(float spacing, int max_num);
+
+	void create(const vector<glm::vec3>& positions);
+
+	// Call func(id) for every entry stored in the cells overlapping [pos - max_dist, pos + max_dist]
+	// Entries inside a cell are visited in ascending id order
+	template <typename Func>
+	void query(const glm::vec3& pos, float max_dist, Func func) const
+	{
+		glm::ivec3 c_min = getCell(pos - glm::vec3(max_dist));
+		glm::ivec3 c_max = getCell(pos + glm::vec3(max_dist));
+
+		// Different cells can share a bucket, so each bucket is only visited once
+		info::uint visited[64];
+		int n_visited = 0;
+
+		for (int x = c_min.x; x <= c_max.x; ++x)
+		{
+			for (int y = c_min.y; y <= c_max.y; ++y)
+			{
+				for (int z = c_min.z; z <= c_max.z; ++z)
+				{
+					info::uint h = getHashIndex(glm::ivec3(x, y, z));
+					if (find(visited, visited + n_visited, h) != visited + n_visited) continue;
+					if (n_visited < 64) visited[n_visited++] = h;
+
+					for (int i = m_cell_start[h]; i < m_cell_start[h + 1]; ++i)
+					{
+						func(m_cell_entries[i]);
+					}
+				}
+			}
+		}
+	}
+
+	inline float getSpacing() const { return m_spacing; };
+	inline void setSpacing(float spacing) { m_spacing = spacing; };
+
+private:
+	glm::ivec3 getCell(const glm::vec3& pos) const;
+	info::uint getHashIndex(const glm::ivec3& cell) const;
+
+	vector<int> m_cell_start;
+	vector<int> m_cell_entries;
+	vector<info::uint> m_hashes;
+
+	float m_spacing;
+	int m_table_size;
+};
+
+#endif // !SPATIALHASH_H
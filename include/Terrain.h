@@ -2,25 +2,52 @@
 #ifndef TERRAIN_H
 #define TERRAIN_H
 
+#include <array>
 #include <unordered_map>
 
 #include "Object.h"
-#include "Tri.h"
 #include "ImGuiButton.h"
+#include "TerrainErosion.h"
 
-struct TerrainVertex
+class HeightMap;
+class TerrainHistory;
+class TerrainScatter;
+class TerrainStreamer;
+struct TerrainTile;
+struct TerrainNoise;
+
+// Erosion of a block of level 0 tiles running on a worker thread
+struct ErosionJob
 {
-	glm::vec3 pos;
-	glm::vec3 color;
-	shared_ptr<TerrainVertex> next;
+	// Pinned while the job runs, the result is written back into them
+	vector<shared_ptr<TerrainTile>> tiles;
+	vector<float> heights;
+
+	// Level 0 samples covered by heights
+	int x0 = 0;
+	int z0 = 0;
+	int width = 0;
+	int depth = 0;
 
-	TerrainVertex(glm::vec3 p, glm::vec3 c) 
-		: pos(p), color(c), next(nullptr) {};
+	bool is_started = false;
+	atomic<bool> is_done{ false };
+	ErosionProgress progress;
 };
 
+// Chunked terrain drawn with continuous distance LOD (CDLOD)
+// The world is a quadtree of height tiles streamed from disk around the camera. Every selected node is drawn
+// with the same patch grid, and vertices morph into the grid of the next level before a node hands over to its parent.
 class Terrain : public Object
 {
 public:
+	enum Brush
+	{
+		BRUSH_SCULPT = 0,
+		BRUSH_HYDRAULIC,
+		BRUSH_THERMAL,
+		BRUSH_SCATTER
+	};
+
 	Terrain(float res);
 	~Terrain();
 
@@ -36,27 +63,108 @@ public:
 
 	virtual void renderExtraProperty() override;
 
+	// Simulations collide with the heightfield instead of the patch grid
+	virtual bool getIsCollider() override { return false; };
+
+	// Heightfield collision in world space, O(1) from the finest resident tile under p
+	// height : surface height below p, normal : bilinear surface normal, false off the terrain
+	bool getSurface(const glm::vec3& p, float& height, glm::vec3& normal);
+
+	// getSurface for every point, height is -FLT_MAX where there is no terrain
+	void getSurfaces(const vector<glm::vec3>& points, vector<float>& heights, vector<glm::vec3>& normals);
+
+protected:
+	virtual void computeBBox() override;
+
 private:
-	int getIndex(const glm::vec2&);
+	// Uploads finished loads into free layers of the height map and releases evicted ones
+	void updateTiles();
+	bool uploadTile(TerrainTile& tile);
+	void refreshBorders(const TerrainTile& tile);
+	void updateResident();
+
+	// Regenerates the resident tiles that still hold generated heights after the noise settings changed
+	void regenerate();
+	TerrainNoise getNoise() const;
+
+	void selectNode(int level, int x, int z, const glm::vec3& view_pos, const array<glm::vec4, 6>& planes);
+	void pickNode(int level, int x, int z, const glm::vec3& ray_dir, const glm::vec3& ray_pos, float& t);
+	bool pick(const glm::vec3& ray_dir, const glm::vec3& ray_pos);
+
+	// Erodes the level 0 tiles around the camera, the job waits until all of them are resident
+	void startErosion();
+	void updateErosion();
+	void erodeBrush(int x0, int z0, int x1, int z1);
+	float getRelief() const;
+
+	// Applies a pending undo or redo once every tile of its stroke is resident
+	void updateHistory();
+
+	// Level 0 samples [x0, x1] x [z0, z1], written into every resident tile holding a copy
+	void readHeights(int x0, int z0, int x1, int z1, vector<float>& heights) const;
+	void writeHeights(int x0, int z0, int x1, int z1, const vector<float>& heights);
+
+	// Refreshes every level over level 0 samples [x0, x1] x [z0, z1] after their heights changed
+	void refreshRect(int x0, int z0, int x1, int z1);
+	void computeNormals(TerrainTile& tile, int x0, int z0, int x1, int z1);
+
+	// gx, gz : sample of level, false when its tile is not resident
+	bool getHeight(int level, int gx, int gz, float& h) const;
+	void getNodeBox(const TerrainTile& tile, glm::vec3& b_min, glm::vec3& b_max) const;
+
+	// getSurface with the model matrix M, its inverse and its normal matrix N computed once per batch
+	bool sampleSurface(const glm::vec3& p, const glm::mat4& M, const glm::mat4& M_inv, const glm::mat3& N,
+		float& height, glm::vec3& normal) const;
+	inline float getNodeSize(int level) const { return m_cell_size * m_tile_cells * float(1 << level); };
+	inline glm::vec2 getOrigin() const { return glm::vec2(-m_width / 2.0f, -m_height / 2.0f); };
 
 	unique_ptr<ImGuiButton> m_button_plus;
 	unique_ptr<ImGuiButton> m_button_minus;
 
-	vector<shared_ptr<Tri>> m_trimeshes;
-	vector<shared_ptr<TerrainVertex>> m_vertices;
+	unique_ptr<TerrainStreamer> m_streamer;
+	int m_file_slot;			// Into the terrain files in use, 0 is default.terrain
+	unique_ptr<HeightMap> m_height_map;
+	unique_ptr<TerrainHistory> m_history;
+	unique_ptr<TerrainScatter> m_scatter;
+	vector<int> m_free_slots;
+
+	// Ready tiles by level and position for collision queries, rebuilt whenever tiles are loaded or evicted
+	vector<const TerrainTile*> m_resident;
+	vector<int> m_resident_start;
+
+	// Nodes drawn this frame and the distance up to which each level is refined
+	vector<shared_ptr<TerrainTile>> m_selected;
+	vector<float> m_lod_ranges;
+
+	shared_ptr<ErosionJob> m_erosion;
+	ErosionSettings m_erosion_settings;
 
 	glm::vec3 m_hit;
+	glm::vec3 m_view_pos;
 
-	float m_res;
+	float m_cell_size;
 	float m_width;
 	float m_height;
+	float m_lod_distance;
+	float m_triangle_size;
     float m_frequency;
     float m_brush_size;
     float m_strength;
 
+	int m_num_tiles;
+	int m_tile_cells;
+	int m_patches;
+	int m_brush;
+	int m_erosion_tiles;
+	int m_scatter_layer;
+
+	// -1 undo, 1 redo, 0 nothing waiting
+	int m_history_step;
+	bool m_is_stroke;
 	int m_noise_scale;
     int m_octaves;
     bool m_is_edit;
+	bool m_is_scatter;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,84 @@
+#pragma once
+#ifndef TERRAINEROSION_H
+#define TERRAINEROSION_H
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+using namespace std;
+
+struct ErosionSettings
+{
+	// Hydraulic, one droplet carries sediment downhill until it evaporates or stops
+	int lifetime = 30;
+	int radius = 3;
+	float inertia = 0.05f;
+	float capacity = 4.0f;
+	float min_capacity = 0.01f;
+	float erode_rate = 0.3f;
+	float deposit_rate = 0.3f;
+	float evaporate_rate = 0.01f;
+	float gravity = 4.0f;
+
+	// The droplet constants are tuned for a relief of about one, droplets measure heights in units of this
+	float relief = 1.0f;
+
+	// Thermal, material slides down wherever the slope exceeds the talus slope
+	float talus = 0.6f;
+	float thermal_rate = 0.5f;
+};
+
+// Shared with the thread running an erosion, value goes from 0 to 1
+struct ErosionProgress
+{
+	atomic<float> value{ 0.0f };
+	atomic<bool> cancel{ false };
+};
+
+// Erosion over a rectangle of terrain heights
+// Both passes run in parallel over blocks of the grid. Droplets of a block may wander into a halo around it, and blocks
+// are processed in four colors so no two blocks running at the same time share a halo. Thermal steps exchange material
+// across block borders through a second pass after every step. Samples on the border of the grid never change,
+// so an eroded rectangle still matches the terrain around it.
+class TerrainErosion
+{
+public:
+	// heights : width * depth samples with x fastest, spacing : distance between samples
+	TerrainErosion(vector<float>& heights, int width, int depth, float spacing);
+
+	// Spawns droplets uniformly over samples [x0, x1) x [z0, z1), false when cancelled.
+	// progress moves from begin to end, the result only depends on the seed, not on the number of threads.
+	bool hydraulic(const ErosionSettings& settings, int droplets, int x0, int z0, int x1, int z1, uint32_t seed,
+		ErosionProgress* progress = nullptr, float begin = 0.0f, float end = 1.0f);
+
+	bool thermal(const ErosionSettings& settings, int iterations,
+		ErosionProgress* progress = nullptr, float begin = 0.0f, float end = 1.0f);
+
+private:
+	struct Bounds
+	{
+		int x0, z0, x1, z1;
+	};
+
+	void runDroplet(const ErosionSettings& settings, glm::vec2 pos, const Bounds& bounds);
+
+	// Height and gradient of the bilinear surface at pos
+	float sample(const glm::vec2& pos, glm::vec2& gradient) const;
+
+	vector<float>& m_heights;
+	vector<glm::vec4> m_outflow;
+
+	// Erosion brush around a droplet, offsets and normalized weights
+	vector<glm::ivec2> m_brush_offsets;
+	vector<float> m_brush_weights;
+	int m_brush_radius;
+
+	int m_width;
+	int m_depth;
+	float m_spacing;
+};
+
+#endif // !TERRAINEROSION_H
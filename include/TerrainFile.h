@@ -0,0 +1,84 @@
+#pragma once
+#ifndef TERRAINFILE_H
+#define TERRAINFILE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+
+using namespace std;
+
+// Heights of every tile of a terrain quadtree in one file
+// A header and an index with one entry per tile of every level come first, tile records follow in the order they were
+// written. Records are 16 bit steps above the tile minimum, predicted from their left and upper neighbours, with the
+// residuals stored as variable length integers, so smooth terrain takes about a byte per sample. Reads go through a
+// memory mapping and only touch the pages of the tiles asked for. A tile written again goes back into its old record
+// when it fits, otherwise to the end of the file, then its index entry is updated.
+class TerrainFile
+{
+public:
+	TerrainFile(const string& path, int num_tiles, int num_levels, int tile_res);
+
+	// False when the tile was never written, heights are left alone then
+	bool read(int level, int x, int z, vector<float>& heights);
+	void write(int level, int x, int z, const vector<float>& heights);
+
+	// Height on the grid of steps the file stores, edits snapped to it read back bit for bit
+	static float quantize(float h);
+
+	inline int getNumWritten() const { return m_num_written; };
+	inline uint64_t getSize() const { return m_header.end; };
+
+private:
+	enum Encoding
+	{
+		ENCODING_NONE = 0,
+		ENCODING_DELTA,		// Steps above min, predicted from the neighbours
+		ENCODING_RAW		// Floats, for tiles whose range does not fit in 16 bits
+	};
+
+	struct Header
+	{
+		uint32_t magic;
+		uint32_t version;
+		int32_t num_tiles;
+		int32_t num_levels;
+		int32_t tile_res;
+		float step;
+		uint64_t end;		// End of the last record
+	};
+
+	struct Entry
+	{
+		uint64_t offset;
+		uint32_t size;
+		uint32_t capacity;	// Bytes reserved for the record, rewrites up to this size stay in place
+		float min;
+		float max;
+		uint32_t encoding;
+		uint32_t unused;
+	};
+
+	int getIndex(int level, int x, int z) const;
+	bool create();
+
+	void encode(const vector<float>& heights, vector<uint8_t>& record, Entry& entry) const;
+	bool decode(const uint8_t* record, const Entry& entry, vector<float>& heights) const;
+
+	string m_path;
+	Header m_header;
+	vector<Entry> m_entries;
+	vector<int> m_level_start;
+
+	// Dropped before every write, mapped again by the next read
+	unique_ptr<MappedFile> m_map;
+
+	int m_tile_res;
+	int m_num_written;
+	bool m_is_valid;
+};
+
+#endif // !TERRAINFILE_H
@@ -0,0 +1,74 @@
+#pragma once
+#ifndef TERRAINGENERATOR_H
+#define TERRAINGENERATOR_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "FastNoiseLite.h"
+
+using namespace std;
+
+struct TerrainNoise
+{
+	float frequency = 0.02f;
+	int octaves = 8;
+	float amplitude = 1.0f;
+};
+
+// Fractal noise heights for terrain tiles
+// Every octave is its own noise layer, evaluated in level 0 sample units, so coarse tiles see exactly the values of the
+// level 0 samples under them. Layers are cached per tile: a new amplitude only re-sums them, more octaves only evaluate
+// the new layers and a new frequency starts over.
+class TerrainGenerator
+{
+public:
+	TerrainGenerator(int tile_cells, int max_cached);
+
+	// Safe to call while tiles are generated, returns the new version when anything changed
+	int setNoise(const TerrainNoise& noise);
+	TerrainNoise getNoise() const;
+	int getVersion() const;
+
+	// Heights of the res * res level 0 samples (gx0 + i * step, gz0 + j * step), rows in parallel, nothing cached
+	void generate(int gx0, int gz0, int step, int res, vector<float>& heights) const;
+
+	// Times generate on fields up to 4096 x 4096 with the current settings
+	void benchmark() const;
+
+	// Heights of a tile from the cached layers, version : settings they were made with
+	void generateTile(int level, int x, int z, vector<float>& heights, int& version);
+
+private:
+	struct Entry
+	{
+		mutex lock;
+		vector<vector<float>> layers;
+		int last_used = 0;
+	};
+
+	static uint64_t getKey(int level, int x, int z);
+
+	// One noise per octave, raw values in [-1, 1]
+	static vector<FastNoiseLite> createLayers(const TerrainNoise& noise);
+
+	// Evaluates the given octaves over the samples, each layer into its own res * res array
+	static void evaluate(const vector<FastNoiseLite>& layers, int first, int last,
+		int gx0, int gz0, int step, int res, vector<vector<float>>& values);
+	static void sum(const vector<vector<float>>& values, const TerrainNoise& noise, vector<float>& heights);
+
+	unordered_map<uint64_t, shared_ptr<Entry>> m_cache;
+	vector<FastNoiseLite> m_layers;
+	mutable mutex m_mutex;
+
+	TerrainNoise m_noise;
+	int m_version;
+	int m_tile_cells;
+	int m_max_cached;
+	int m_clock;
+};
+
+#endif // !TERRAINGENERATOR_H
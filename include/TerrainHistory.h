@@ -0,0 +1,87 @@
+#pragma once
+#ifndef TERRAINHISTORY_H
+#define TERRAINHISTORY_H
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+struct TerrainTile;
+
+// Change of one level 0 tile in a stroke
+// Stores the bits that flipped, before ^ after, over the rectangle of changed samples, with runs of unchanged samples
+// packed away. Applying it to either state gives the other one, so the same delta serves undo and redo.
+struct TileDelta
+{
+	int x;
+	int z;
+
+	// Changed samples of the tile, inclusive
+	int x0, z0, x1, z1;
+
+	// (zero run, literal count, literals ...) repeated
+	vector<uint32_t> packed;
+};
+
+struct TerrainStroke
+{
+	vector<TileDelta> tiles;
+	size_t bytes = 0;
+};
+
+// Undo and redo of terrain edits, one entry per stroke
+// Tiles are copied the first time a stroke writes to them and diffed when it ends, untouched tiles cost nothing.
+// The oldest strokes are dropped once the history exceeds its memory budget.
+class TerrainHistory
+{
+public:
+	TerrainHistory(int tile_res, size_t max_bytes);
+
+	void begin();
+	void end();
+	inline bool isRecording() const { return m_is_recording; };
+
+	// Call before the first write of a stroke into a level 0 tile
+	void touch(const shared_ptr<TerrainTile>& tile);
+
+	inline const TerrainStroke* getUndo() const { return m_undo.empty() ? nullptr : &m_undo.back(); };
+	inline const TerrainStroke* getRedo() const { return m_redo.empty() ? nullptr : &m_redo.back(); };
+
+	// Once the stroke from getUndo or getRedo is applied to the tiles
+	void popUndo();
+	void popRedo();
+
+	void clear();
+
+	// Flips heights between the two states of the delta
+	void apply(const TileDelta& delta, vector<float>& heights) const;
+
+	inline int getNumUndo() const { return int(m_undo.size()); };
+	inline int getNumRedo() const { return int(m_redo.size()); };
+	inline size_t getBytes() const { return m_bytes; };
+
+private:
+	struct Snapshot
+	{
+		shared_ptr<TerrainTile> tile;
+		vector<float> heights;
+	};
+
+	bool diff(const Snapshot& snapshot, TileDelta& delta) const;
+	void trim();
+
+	deque<TerrainStroke> m_undo;
+	deque<TerrainStroke> m_redo;
+	unordered_map<uint64_t, Snapshot> m_snapshots;
+
+	size_t m_bytes;
+	size_t m_max_bytes;
+	int m_tile_res;
+	bool m_is_recording;
+};
+
+#endif // !TERRAINHISTORY_H
@@ -0,0 +1,143 @@
+#pragma once
+#ifndef TERRAINSCATTER_H
+#define TERRAINSCATTER_H
+
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+using namespace std;
+
+class HeightMap;
+class Light;
+class Mesh;
+struct TerrainTile;
+
+// Rocks and plants scattered over the terrain by density maps
+// Every layer places candidates on a jittered grid in each level 0 tile and keeps those under its density, so painting
+// density only changes which candidates survive. Instances only store their position in the plane, a compute pass
+// reads their height from the terrain node drawn over them, culls them against the frustum and the slope of the layer,
+// picks their LOD by distance and appends their matrices for one indirect instanced draw per layer and LOD.
+class TerrainScatter
+{
+public:
+	// num_tiles x num_tiles tiles of tile_size from origin, in the space of the terrain
+	TerrainScatter(int num_tiles, float tile_size, const glm::vec2& origin);
+	~TerrainScatter();
+
+	// Adds amount of density to layer, fading out to radius, and scatters the tiles under the brush again
+	void paint(int layer, const glm::vec2& center, float radius, float amount);
+
+	// nodes : terrain nodes drawn this frame, planes and local_view_pos in the space of the terrain
+	void draw(
+		const glm::mat4& P,
+		const glm::mat4& V,
+		const glm::mat4& M,
+		const glm::vec3& view_pos,
+		const glm::vec3& local_view_pos,
+		const array<glm::vec4, 6>& planes,
+		const Light& light,
+		const vector<shared_ptr<TerrainTile>>& nodes,
+		const HeightMap& height_map,
+		int grid_cells);
+
+	inline int getNumLayers() const { return int(m_layers.size()); };
+	inline const string& getLayerName(int layer) const { return m_layers[layer].name; };
+	inline int getNumInstances() const { return m_num_instances; };
+	inline int getNumCells() const { return int(m_cells.size()); };
+
+private:
+	struct Layer
+	{
+		string name;
+		glm::vec3 color;
+
+		// Finest first, each drawn up to its distance
+		vector<shared_ptr<Mesh>> lods;
+		vector<float> lod_distances;
+
+		// Candidates are spacing apart, at most one instance each
+		float spacing;
+		float min_scale;
+		float max_scale;
+		float max_slope;	// Degrees
+		float radius;		// Bounding sphere of the meshes at scale 1
+
+		// (num_tiles * DENSITY_CELLS + 1)^2 samples from 0 to 1
+		vector<float> density;
+
+		int capacity;		// Candidates per tile
+		int first;			// First instance of the layer
+		int first_command;
+	};
+
+	// Matches the structs of ScatterCull.comp
+	struct Instance
+	{
+		glm::vec2 position;
+		float scale;
+		float rotation;
+	};
+
+	struct Cell
+	{
+		GLuint first;
+		GLuint count;
+		GLint layer;
+		GLint slot;
+		glm::vec2 node_origin;
+		float node_size;
+		float unused;
+	};
+
+	struct LayerParams
+	{
+		glm::vec4 lod_distances;
+		float min_normal_y;
+		float radius;
+		GLint num_lods;
+		GLint first_command;
+	};
+
+	struct Command
+	{
+		GLuint count;
+		GLuint instance_count;
+		GLuint first_index;
+		GLint base_vertex;
+		GLuint base_instance;
+	};
+
+	void addLayer(Layer&& layer);
+	void createBuffers();
+
+	// Candidates of one tile that survive the density map, the rest of the tile's range is unused
+	void scatterTile(int layer, int tile);
+	float getDensity(const Layer& layer, const glm::vec2& p) const;
+
+	// Cells of the tiles under the drawn nodes that are near and inside the frustum
+	void collectCells(const vector<shared_ptr<TerrainTile>>& nodes, const glm::vec3& local_view_pos, const array<glm::vec4, 6>& planes);
+
+	vector<Layer> m_layers;
+	vector<Instance> m_instances;
+	vector<int> m_counts;			// Per layer and tile
+	vector<Cell> m_cells;
+	vector<Command> m_commands;		// Instance counts zeroed, uploaded before every cull
+
+	GLuint m_instance_buffer;
+	GLuint m_cell_buffer;
+	GLuint m_layer_buffer;
+	GLuint m_command_buffer;
+	GLuint m_visible_buffer;
+
+	glm::vec2 m_origin;
+	float m_tile_size;
+	int m_num_tiles;
+	int m_num_instances;
+};
+
+#endif // !TERRAINSCATTER_H
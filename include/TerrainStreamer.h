@@ -0,0 +1,136 @@
+#pragma once
+#ifndef TERRAINSTREAMER_H
+#define TERRAINSTREAMER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "HeightPyramid.h"
+#include "TerrainFile.h"
+#include "TerrainGenerator.h"
+
+using namespace std;
+
+// One node of the terrain quadtree
+// A tile of level l covers 2^l x 2^l tiles of level 0 with the same number of samples, every 2^l-th one,
+// so each sample of a coarse tile is exactly a sample of the level 0 tile below it. Border samples are shared by neighbours.
+struct TerrainTile
+{
+	enum State
+	{
+		LOADING = 0,	// Owned by the worker
+		LOADED,			// Heights and pyramid filled in, waiting for the render thread
+		READY			// Normals computed and uploaded into slot
+	};
+
+	TerrainTile(int l, int tx, int tz) :
+		level(l), x(tx), z(tz), slot(-1), last_used(0), noise_version(-1), dirty(false), generated(false) {};
+
+	int level;
+	int x;
+	int z;
+
+	vector<float> heights;
+	vector<glm::vec3> normals;
+	HeightPyramid pyramid;
+
+	// Layer of the tile in the height map
+	int slot;
+	int last_used;
+
+	// Settings the heights were generated with, tiles read from disk are not generated
+	int noise_version;
+	bool dirty;
+	bool generated;
+
+	atomic<int> state{ LOADING };
+};
+
+// Pages terrain tiles in and out of memory around what the renderer asks for
+// Loads and saves run in order on one worker thread, so a tile evicted and requested again reads back its own save.
+// Only dirty tiles are ever written, each into its own record of the terrain file. Tiles missing from the file are
+// generated from noise. Resident tiles are capped, the least recently used ones are evicted first.
+class TerrainStreamer
+{
+public:
+	TerrainStreamer(const string& path, int num_tiles, int tile_cells, int max_resident);
+	~TerrainStreamer();
+
+	// Returns the tile if it is ready and marks it used this frame, otherwise queues its load and returns nullptr
+	shared_ptr<TerrainTile> request(int level, int x, int z);
+
+	// Ready tile or nullptr, never loads
+	shared_ptr<TerrainTile> find(int level, int x, int z) const;
+
+	// Once per frame on the render thread
+	// loaded : tiles whose load finished, the caller uploads them and sets them READY
+	// evicted : tiles dropped from memory, dirty ones are already queued for saving
+	void update(vector<shared_ptr<TerrainTile>>& loaded, vector<shared_ptr<TerrainTile>>& evicted);
+
+	// Queues a save of every dirty tile
+	void flush();
+
+	// Every ready tile
+	void getTiles(vector<shared_ptr<TerrainTile>>& tiles) const;
+
+	inline TerrainGenerator& getGenerator() { return *m_generator; };
+
+	inline int getNumLevels() const { return m_num_levels; };
+	inline int getTileCells() const { return m_tile_cells; };
+	inline int getTileRes() const { return m_tile_cells + 1; };
+	inline int getNumTiles(int level) const { return max(m_num_tiles >> level, 1); };
+	inline int getMaxResident() const { return m_max_resident; };
+	inline int getNumResident() const { return int(m_tiles.size()); };
+	inline int getNumPending() const { return m_num_pending; };
+	inline int getFrame() const { return m_frame; };
+
+private:
+	struct Job
+	{
+		shared_ptr<TerrainTile> tile;	// Load when set
+		int level;						// Save otherwise
+		int x;
+		int z;
+		vector<float> heights;
+	};
+
+	void run();
+	void load(TerrainTile& tile);
+	void save(const Job& job);
+	void push(Job&& job);
+	void pushSave(const TerrainTile& tile);
+
+	static uint64_t getKey(int level, int x, int z);
+
+	unordered_map<uint64_t, shared_ptr<TerrainTile>> m_tiles;
+	unique_ptr<TerrainGenerator> m_generator;
+
+	// Only touched by the worker
+	unique_ptr<TerrainFile> m_file;
+
+	deque<Job> m_jobs;
+	mutex m_mutex;
+	condition_variable m_cv;
+	thread m_worker;
+	bool m_quit;
+
+	int m_num_tiles;
+	int m_num_levels;
+	int m_tile_cells;
+	int m_max_resident;
+	int m_max_pending;
+	int m_num_pending;
+	int m_frame;
+};
+
+#endif // !TERRAINSTREAMER_H
@@ -0,0 +1,61 @@
+#pragma once
+#ifndef TETCACHE_H
+#define TETCACHE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Utils.h"
+
+using namespace std;
+
+// Tetrahedral mesh of a soft body with its rest state
+struct TetData
+{
+	vector<glm::vec3> vertices;
+	vector<glm::ivec4> tets;
+	vector<glm::ivec2> edges; // Unique edges of the tets
+	vector<float> rest_d; // 1 length per edge
+	vector<float> rest_v; // 1 volume per tet
+
+	// Colour offsets of edges and tets once they are sorted by colour, not cached
+	vector<int> edge_colors;
+	vector<int> tet_colors;
+
+	// Tet and barycentric weights of each surface vertex, not cached
+	vector<int> skin_tets;
+	vector<glm::vec3> skin_weights;
+};
+
+// Stores tetrahedralizations under assets/cache so the same input is only meshed once
+class TetCache
+{
+public:
+	// Content hash of everything the tetrahedralization depends on
+	static uint64_t computeKey(
+		const vector<glm::vec3>& vertices,
+		const vector<info::uint>& indices,
+		float dx, const glm::vec3& b_min, const glm::vec3& b_max);
+
+	// Memory maps the cache file of key, returns false on a miss or a corrupted file
+	static bool load(uint64_t key, TetData& data);
+	static bool save(uint64_t key, const TetData& data);
+
+	static string getPath(uint64_t key);
+
+private:
+	struct Header
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t key;
+		uint64_t num_vertices;
+		uint64_t num_tets;
+		uint64_t num_edges;
+	};
+};
+
+#endif // !TETCACHE_H
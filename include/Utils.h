@@ -31,15 +31,6 @@ namespace info
 		glm::vec2 texCoord = { 0.0f, 0.0f };
 	};
 
-    struct TerrainVertexLayout
-    {
-        glm::vec3 position = { 0.0f, 0.0f, 0.0f };
-        glm::vec3 normal = { 0.0f, 0.0f, 0.0f };
-        glm::vec3 tangent = { 0.0f, 0.0f, 0.0f };
-        glm::vec2 texCoord = { 0.0f, 0.0f };
-        int paint = 0;
-    };
-
     struct SPHParams
     {
         glm::vec3 min_box;
@@ -62,6 +53,11 @@ namespace info
         float t;
 
         int max_num_neighbors;
+
+        // Terrain under the box sampled on a grid from terrain_min, terrain_res is 0 without terrain
+        glm::vec2 terrain_min;
+        glm::vec2 terrain_cell;
+        int terrain_res;
     };
 }
 
@@ -0,0 +1,240 @@
+#include "BVH.h"
+
+#include <algorithm>
+#include <cfloat>
+
+#include "Parallel.h"
+
+// Reference : Real-Time Collision Detection, Christer Ericson, 5.1.5
+static glm::vec3 closestPointTriangle(
+	const glm::vec3& p, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+{
+	glm::vec3 ab = b - a;
+	glm::vec3 ac = c - a;
+	glm::vec3 ap = p - a;
+
+	float d1 = glm::dot(ab, ap);
+	float d2 = glm::dot(ac, ap);
+	if (d1 <= 0.0f && d2 <= 0.0f) return a;
+
+	glm::vec3 bp = p - b;
+	float d3 = glm::dot(ab, bp);
+	float d4 = glm::dot(ac, bp);
+	if (d3 >= 0.0f && d4 <= d3) return b;
+
+	float vc = d1 * d4 - d3 * d2;
+	if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+	{
+		float v = d1 / (d1 - d3);
+		return a + v * ab;
+	}
+
+	glm::vec3 cp = p - c;
+	float d5 = glm::dot(ab, cp);
+	float d6 = glm::dot(ac, cp);
+	if (d6 >= 0.0f && d5 <= d6) return c;
+
+	float vb = d5 * d2 - d1 * d6;
+	if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+	{
+		float w = d2 / (d2 - d6);
+		return a + w * ac;
+	}
+
+	float va = d3 * d6 - d5 * d4;
+	if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+	{
+		float w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+		return b + w * (c - b);
+	}
+
+	float denom = 1.0f / (va + vb + vc);
+	float v = vb * denom;
+	float w = vc * denom;
+	return a + ab * v + ac * w;
+}
+
+static float distanceToBox(const glm::vec3& p, const glm::vec3& b_min, const glm::vec3& b_max)
+{
+	glm::vec3 d = glm::max(glm::max(b_min - p, p - b_max), glm::vec3(0.0f));
+	return glm::dot(d, d);
+}
+
+BVH::BVH(const vector<info::VertexLayout>& vertices, const vector<info::uint>& indices) :
+	m_transform(glm::mat4(1.0f))
+{
+	m_local.resize(vertices.size());
+	for (int i = 0; i < vertices.size(); ++i)
+	{
+		m_local[i] = vertices[i].position;
+	}
+	m_positions = m_local;
+
+	for (int i = 0; i + 2 < indices.size(); i += 3)
+	{
+		m_tris.push_back(glm::ivec3(indices[i], indices[i + 1], indices[i + 2]));
+	}
+
+	if (m_tris.empty()) return;
+
+	m_nodes.reserve(2 * m_tris.size());
+	build(0, int(m_tris.size()));
+
+	cout << "Build BVH with " << m_tris.size() << " triangles and " << m_nodes.size() << " nodes" << endl;
+}
+
+BVH::~BVH()
+{}
+
+void BVH::computeTriBounds(int begin, int end, glm::vec3& b_min, glm::vec3& b_max) const
+{
+	b_min = glm::vec3(FLT_MAX);
+	b_max = glm::vec3(-FLT_MAX);
+
+	for (int i = begin; i < end; ++i)
+	{
+		for (int k = 0; k < 3; ++k)
+		{
+			const glm::vec3& p = m_positions[m_tris[i][k]];
+			b_min = glm::min(b_min, p);
+			b_max = glm::max(b_max, p);
+		}
+	}
+}
+
+int BVH::build(int begin, int end)
+{
+	int index = int(m_nodes.size());
+	m_nodes.push_back(Node());
+
+	glm::vec3 b_min, b_max;
+	computeTriBounds(begin, end, b_min, b_max);
+	m_nodes[index].b_min = b_min;
+	m_nodes[index].b_max = b_max;
+
+	if (end - begin <= 4)
+	{
+		m_nodes[index].first = begin;
+		m_nodes[index].count = end - begin;
+		return index;
+	}
+
+	// Median split on the longest axis of the node
+	glm::vec3 size = b_max - b_min;
+	int axis = 0;
+	if (size.y > size[axis]) axis = 1;
+	if (size.z > size[axis]) axis = 2;
+
+	int mid = (begin + end) / 2;
+	const vector<glm::vec3>& positions = m_positions;
+	nth_element(m_tris.begin() + begin, m_tris.begin() + mid, m_tris.begin() + end,
+		[&positions, axis](const glm::ivec3& lhs, const glm::ivec3& rhs)
+		{
+			float c1 = positions[lhs.x][axis] + positions[lhs.y][axis] + positions[lhs.z][axis];
+			float c2 = positions[rhs.x][axis] + positions[rhs.y][axis] + positions[rhs.z][axis];
+			return c1 < c2;
+		});
+
+	build(begin, mid);
+	int right = build(mid, end);
+
+	m_nodes[index].first = right;
+	m_nodes[index].count = 0;
+	return index;
+}
+
+void BVH::refit(const glm::mat4& M)
+{
+	m_transform = M;
+
+	parallel::forEach(int(m_local.size()), [&](int i)
+		{
+			m_positions[i] = glm::vec3(M * glm::vec4(m_local[i], 1.0f));
+		});
+
+	// Children are always stored after their parent
+	for (int i = int(m_nodes.size()) - 1; i >= 0; --i)
+	{
+		Node& node = m_nodes[i];
+		if (node.count > 0)
+		{
+			computeTriBounds(node.first, node.first + node.count, node.b_min, node.b_max);
+		}
+		else
+		{
+			const Node& left = m_nodes[i + 1];
+			const Node& right = m_nodes[node.first];
+			node.b_min = glm::min(left.b_min, right.b_min);
+			node.b_max = glm::max(left.b_max, right.b_max);
+		}
+	}
+}
+
+bool BVH::closestPoint(
+	const glm::vec3& pos, float max_dist,
+	glm::vec3& closest, glm::vec3& normal) const
+{
+	if (m_nodes.empty()) return false;
+
+	float best = max_dist * max_dist;
+	int best_tri = -1;
+
+	int stack[64];
+	int n_stack = 0;
+	stack[n_stack++] = 0;
+
+	while (n_stack > 0)
+	{
+		const Node& node = m_nodes[stack[--n_stack]];
+		if (distanceToBox(pos, node.b_min, node.b_max) > best) continue;
+
+		if (node.count > 0)
+		{
+			for (int i = node.first; i < node.first + node.count; ++i)
+			{
+				const glm::vec3& a = m_positions[m_tris[i].x];
+				const glm::vec3& b = m_positions[m_tris[i].y];
+				const glm::vec3& c = m_positions[m_tris[i].z];
+
+				glm::vec3 q = closestPointTriangle(pos, a, b, c);
+				float d2 = glm::dot(pos - q, pos - q);
+				if (d2 < best)
+				{
+					best = d2;
+					best_tri = i;
+					closest = q;
+				}
+			}
+			continue;
+		}
+
+		// Visit the nearer child first
+		int left = int(&node - &m_nodes[0]) + 1;
+		int right = node.first;
+		float d_left = distanceToBox(pos, m_nodes[left].b_min, m_nodes[left].b_max);
+		float d_right = distanceToBox(pos, m_nodes[right].b_min, m_nodes[right].b_max);
+
+		if (n_stack + 2 > 64) continue;
+		if (d_left < d_right)
+		{
+			stack[n_stack++] = right;
+			stack[n_stack++] = left;
+		}
+		else
+		{
+			stack[n_stack++] = left;
+			stack[n_stack++] = right;
+		}
+	}
+
+	if (best_tri == -1) return false;
+
+	const glm::vec3& a = m_positions[m_tris[best_tri].x];
+	const glm::vec3& b = m_positions[m_tris[best_tri].y];
+	const glm::vec3& c = m_positions[m_tris[best_tri].z];
+	glm::vec3 n = glm::cross(b - a, c - a);
+	float len = glm::length(n);
+	normal = len > 0.0f ? n / len : glm::vec3(0.0f, 1.0f, 0.0f);
+
+	return true;
+}
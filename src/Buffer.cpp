@@ -6,6 +6,25 @@ VertexBuffer::VertexBuffer() :
 {
 }
 
+void VertexBuffer::createBuffers(const vector<unsigned int>& indices)
+{
+	// No vertex attributes, the shader rebuilds each vertex from gl_VertexID, which is the index itself
+	m_layouts.clear();
+	m_indices = indices;
+	n_layouts = 0;
+	n_indices = static_cast<unsigned int>(indices.size());
+	cout << "Create index buffer without vertices: " << n_indices << endl;
+
+	glGenVertexArrays(1, &m_VAO);
+	glGenBuffers(1, &m_EBO);
+
+	glBindVertexArray(m_VAO);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, n_indices * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+
+	glBindVertexArray(0);
+}
+
 void VertexBuffer::createBuffers(const vector<info::VertexLayout>& layouts)
 {
 	m_layouts.clear();
@@ -45,19 +64,7 @@ void VertexBuffer::createBuffers(const vector<info::VertexLayout>& layouts)
 		glBindBuffer(GL_ARRAY_BUFFER, m_IBO);
 		glBufferData(GL_ARRAY_BUFFER, m_matrices.size() * sizeof(glm::mat4), &m_matrices[0], GL_STATIC_DRAW);
 
-		glEnableVertexAttribArray(TEXCOORD_ATTRIB + 1);
-		glVertexAttribPointer(TEXCOORD_ATTRIB + 1, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)0);
-		glEnableVertexAttribArray(TEXCOORD_ATTRIB + 2);
-		glVertexAttribPointer(TEXCOORD_ATTRIB + 2, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(1 * sizeof(glm::vec4)));
-		glEnableVertexAttribArray(TEXCOORD_ATTRIB + 3);
-		glVertexAttribPointer(TEXCOORD_ATTRIB + 3, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(2 * sizeof(glm::vec4)));
-		glEnableVertexAttribArray(TEXCOORD_ATTRIB + 4);
-		glVertexAttribPointer(TEXCOORD_ATTRIB + 4, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(3 * sizeof(glm::vec4)));
-
-		glVertexAttribDivisor(TEXCOORD_ATTRIB + 1, 1);
-		glVertexAttribDivisor(TEXCOORD_ATTRIB + 2, 1);
-		glVertexAttribDivisor(TEXCOORD_ATTRIB + 3, 1);
-		glVertexAttribDivisor(TEXCOORD_ATTRIB + 4, 1);
+		setupInstanceAttribs();
 	}
 
 	glBindVertexArray(0);
@@ -102,19 +109,7 @@ void VertexBuffer::createBuffers(const vector<info::VertexLayout>& layouts, cons
 		glBindBuffer(GL_ARRAY_BUFFER, m_IBO);
 		glBufferData(GL_ARRAY_BUFFER, m_matrices.size() * sizeof(glm::mat4), &m_matrices[0], GL_STATIC_DRAW);
 
-		glEnableVertexAttribArray(TEXCOORD_ATTRIB + 1);
-		glVertexAttribPointer(TEXCOORD_ATTRIB + 1, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)0);
-		glEnableVertexAttribArray(TEXCOORD_ATTRIB + 2);
-		glVertexAttribPointer(TEXCOORD_ATTRIB + 2, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(1 * sizeof(glm::vec4)));
-		glEnableVertexAttribArray(TEXCOORD_ATTRIB + 3);
-		glVertexAttribPointer(TEXCOORD_ATTRIB + 3, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(2 * sizeof(glm::vec4)));
-		glEnableVertexAttribArray(TEXCOORD_ATTRIB + 4);
-		glVertexAttribPointer(TEXCOORD_ATTRIB + 4, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(3 * sizeof(glm::vec4)));
-
-		glVertexAttribDivisor(TEXCOORD_ATTRIB + 1, 1);
-		glVertexAttribDivisor(TEXCOORD_ATTRIB + 2, 1);
-		glVertexAttribDivisor(TEXCOORD_ATTRIB + 3, 1);
-		glVertexAttribDivisor(TEXCOORD_ATTRIB + 4, 1);
+		setupInstanceAttribs();
 	}
 
 	// Reset the vertex array binder
@@ -187,6 +182,28 @@ void VertexBuffer::updateBuffer(const vector<info::VertexLayout>& layouts, const
 	glUnmapBuffer(GL_ARRAY_BUFFER);
 }
 
+void VertexBuffer::setInstanceBuffer(GLuint buffer)
+{
+	// Matrices written on the GPU, the buffer belongs to the caller
+	m_IBO = buffer;
+
+	glBindVertexArray(m_VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, m_IBO);
+	setupInstanceAttribs();
+	glBindVertexArray(0);
+}
+
+void VertexBuffer::setupInstanceAttribs()
+{
+	// One matrix per instance in the buffer bound to GL_ARRAY_BUFFER, a column per attribute
+	for (int i = 0; i < 4; ++i)
+	{
+		glEnableVertexAttribArray(TEXCOORD_ATTRIB + 1 + i);
+		glVertexAttribPointer(TEXCOORD_ATTRIB + 1 + i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(i * sizeof(glm::vec4)));
+		glVertexAttribDivisor(TEXCOORD_ATTRIB + 1 + i, 1);
+	}
+}
+
 void VertexBuffer::bind() const
 {
 	glBindVertexArray(m_VAO);
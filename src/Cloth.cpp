@@ -1,316 +1,404 @@
 #include "Cloth.h"
+#include "BVH.h"
+#include "DeformableNormals.h"
 #include "Object.h"
-#include "MeshImporter.h"
 #include "Material.h"
+#include "Parallel.h"
+#include "SimValidator.h"
+#include "SleepRegions.h"
+#include "SpatialHash.h"
+#include "Terrain.h"
+#include "imgui-docking/imgui.h"
 #include <cmath>
 
 Cloth::Cloth() : Object("Cloth")
+{
+	// Same sheet as assets/models/Cloth.fbx, pinned at a corner and the middle of the first row
+	m_builder = ClothBuilder(16.0f, 16.0f, 33);
+	m_builder.pin(0.0f, 0.0f);
+	m_builder.pin(0.5f, 0.0f);
+
+	init();
+}
+
+Cloth::Cloth(const ClothBuilder& builder) : Object("Cloth"), m_builder(builder)
+{
+	init();
+}
+
+Cloth::~Cloth() {}
+
+void Cloth::init()
 {
 	m_simulate = false;
+	m_sleep_transform = glm::mat4(1.0f);
 	m_scale = 0.5f;
 
 	t = 0.02f;
 	n_sub_steps = 3;
 	t_sub = t / n_sub_steps;
 
-	vector<shared_ptr<Mesh>> meshes;
-	shared_ptr<MeshImporter> importer = MeshImporter::create("assets/models/Cloth.fbx");
-	importer->importMesh(meshes);
-	addMesh(meshes.back());
+	m_friction = 0.5f;
 
-	m_layouts = meshes.back()->getVertices();
-	m_indices = meshes.back()->getIndices();
+	m_validator = make_unique<SimValidator>("cloth");
+	m_validator->watch("positions", &m_particle_pos);
+	m_validator->watch("velocities", &m_validation_vel);
 
 	initParticles();
 }
 
-Cloth::~Cloth() {}
-
 void Cloth::initParticles()
 {
-	glm::vec3 diff = m_layouts[0].position - m_layouts[1].position;
-	m_rest = glm::length(diff);
-
-	glm::vec3 size_cloth = getSize() * (1.0f / m_rest);
-	m_width = size_cloth.x <= 0.0001f ? 0 : size_cloth.x;
-	m_height = size_cloth.y <= 0.0001f ? 0 : size_cloth.y;
-	m_depth = size_cloth.z <= 0.0001f ? 0 : size_cloth.z;
-	m_particles.resize( size_t((m_width+1) * (m_height+1) * (m_depth+1)) );
-
-	for (int i = 0; i < m_particles.size(); ++i)
+	ClothData data = m_builder.build();
+
+	m_layouts = move(data.layouts);
+	m_indices = move(data.indices);
+	m_edges = move(data.edges);
+	m_bends = move(data.bends);
+	m_cols = data.cols;
+	m_rows = data.rows;
+	m_rest = data.spacing;
+
+	int n = int(m_layouts.size());
+	m_particles.resize(n);
+	for (int i = 0; i < n; ++i)
 	{
-		m_particles[i] = nullptr;
+		m_particles[i] = make_shared<ClothParticle>(m_layouts[i].position);
+		m_particles[i]->m_pinned = data.pinned[i];
 	}
 
+	shared_ptr<Mesh> mesh = make_shared<Mesh>("Cloth");
+	mesh->setupBuffer(m_layouts, m_indices);
+	addMesh(mesh);
+
 	cout << endl;
 	cout << "*************************Cloth Information**************************" << endl;
-	//cout << "Cloth size : " << size_cloth << " rest distance : " << m_rest << endl;
-	cout << "Width : " << m_width << endl;
-	cout << "Height : " << m_height << endl;
-	cout << "Depth : " << m_depth << endl;
+	cout << "Columns : " << m_cols << endl;
+	cout << "Rows : " << m_rows << endl;
+	cout << "Rest distance : " << m_rest << endl;
 	cout << "Size of layout : " << m_layouts.size() << endl;
 	cout << "Size of indices : " << m_indices.size() << endl;
 	cout << "********************************end*********************************" << endl;
 	cout << endl;
 
-	m_hash.reserve(info::HASH_SIZE);
+	buildConstraintGraph();
+
+	m_predict.resize(n);
+	m_inv_mass.resize(n);
+
+	m_normals = make_unique<DeformableNormals>(m_indices, n);
+	m_particle_pos.resize(n);
+	m_particle_normals.resize(n);
+
+	buildSleepRegions();
+
+	m_thickness = m_rest;
+	m_mesh_thickness = m_rest;
+	m_hash = make_unique<SpatialHash>(1.5f * m_thickness, n);
+	m_collision_start.assign(n + 1, 0);
+	m_collision_pos.resize(n);
+	m_collision_delta.resize(n);
+}
+
+void Cloth::rebuild()
+{
+	initParticles();
+}
 
-	for (int i = 0; i < m_layouts.size(); ++i)
+void Cloth::buildConstraintGraph()
+{
+	int n = int(m_particles.size());
+
+	vector<vector<int>> neighbors(n);
+	for (const auto& e : m_edges)
 	{
-		glm::ivec3 grid_pos = getGridPos(m_layouts[i].position);
-		info::uint grid_index = getIndex(grid_pos);
-		if (m_particles[grid_index] == nullptr)
-		{
-			shared_ptr<ClothParticle> p = make_shared<ClothParticle>(m_layouts[i].position);
-			
-			if (grid_index == 0 || grid_index == 16 )
-			{
-				p->m_pinned = true;
-			}
+		neighbors[e.a].push_back(e.b);
+		neighbors[e.b].push_back(e.a);
+	}
 
-			m_particles[grid_index] = p;
-		}
+	m_adj_start.assign(n + 1, 0);
+	m_adj_ids.clear();
+	for (int i = 0; i < n; ++i)
+	{
+		m_adj_start[i] = int(m_adj_ids.size());
+		m_adj_ids.insert(m_adj_ids.end(), neighbors[i].begin(), neighbors[i].end());
+	}
+	m_adj_start[n] = int(m_adj_ids.size());
+}
+
+void Cloth::buildSleepRegions()
+{
+	// Square tiles of the particle grid, in the same layout as the stretch constraints
+	const int tile = 8;
+	int n = int(m_particles.size());
+
+	m_sleep_cols = (m_cols + tile - 1) / tile;
+	int rows = (m_rows + tile - 1) / tile;
 
-		m_particles[grid_index]->m_ids.push_back(i);
+	m_particle_region.resize(n);
+	for (int i = 0; i < n; ++i)
+	{
+		m_particle_region[i] = (i / m_cols / tile) * m_sleep_cols + (i % m_cols) / tile;
 	}
+
+	m_sleep = make_unique<SleepRegions>(m_sleep_cols * rows);
+	m_region_energy.resize(m_sleep->getNumRegions());
+	m_region_count.resize(m_sleep->getNumRegions());
 }
 
-void Cloth::buildHash(vector<shared_ptr<ClothParticle>>& predict)
+void Cloth::updateSleep()
 {
-	for (int i = 0; i < m_hash.size(); ++i)
+	int n_regions = m_sleep->getNumRegions();
+	fill(m_region_energy.begin(), m_region_energy.end(), 0.0f);
+	fill(m_region_count.begin(), m_region_count.end(), 0);
+
+	for (int i = 0; i < m_particles.size(); ++i)
 	{
-		m_hash[i] = nullptr;
+		int r = m_particle_region[i];
+		m_region_energy[r] += 0.5f * glm::dot(m_particles[i]->m_velocity, m_particles[i]->m_velocity);
+		m_region_count[r]++;
 	}
 
-	for (int i = 0; i < predict.size(); ++i)
+	for (int r = 0; r < n_regions; ++r)
 	{
-		ClothParticle* p = predict[i].get();
-		glm::ivec3 grid_pos = getGridPos(p->m_position);
-		info::uint hash_index = getHashIndex(grid_pos);
-		
-		if (m_hash[hash_index] == nullptr)
-		{
-			p->m_next = nullptr;
-			m_hash[hash_index] = p;
-		}
-		else
+		if (m_region_count[r] == 0) continue;
+		m_sleep->update(r, m_region_energy[r] / m_region_count[r]);
+	}
+
+	// A moving patch keeps the patches around it awake, so it never pulls against a frozen one
+	int rows = n_regions / m_sleep_cols;
+	for (int r = 0; r < n_regions; ++r)
+	{
+		if (m_region_count[r] == 0 || 
+			m_region_energy[r] / m_region_count[r] < m_sleep->getThreshold()) continue;
+
+		int row = r / m_sleep_cols;
+		int col = r % m_sleep_cols;
+		for (int y = max(0, row - 1); y <= min(rows - 1, row + 1); ++y)
 		{
-			p->m_next = m_hash[hash_index];
-			m_hash[hash_index] = p;
+			for (int x = max(0, col - 1); x <= min(m_sleep_cols - 1, col + 1); ++x)
+			{
+				m_sleep->wake(y * m_sleep_cols + x);
+			}
 		}
 	}
 }
 
-info::uint Cloth::getIndex(glm::ivec3& pos)
+void Cloth::wake()
+{
+	m_sleep->wakeAll();
+}
+
+void Cloth::setSimulate(bool s)
 {
-	return info::uint(pos.x + (m_height + 1) * (pos.y + (m_depth + 1) * pos.z));
+	if (s && !m_simulate) wake();
+	m_simulate = s;
 }
 
-glm::ivec3 Cloth::getGridPos(glm::vec3 pos)
+bool Cloth::isTopologicalNeighbor(int i, int j)
 {
-	return glm::ivec3(pos * (1.0f / m_rest));
+	for (int k = m_adj_start[i]; k < m_adj_start[i + 1]; ++k)
+	{
+		if (m_adj_ids[k] == j) return true;
+	}
+
+	return false;
 }
 
-info::uint Cloth::getHashIndex(glm::ivec3& pos)
+void Cloth::buildCollisionPairs()
 {
-	return ((info::uint)(pos.x * 73856093) ^
-			(info::uint)(pos.y * 19349663) ^
-			(info::uint)(pos.z * 83492791)) % info::HASH_SIZE;
+	int n = int(m_predict.size());
+	float max_dist = m_hash->getSpacing();
+
+	m_hash->create(m_predict);
+
+	// Two passes over the grid (count, then fill) keep each particle's list in a fixed order
+	auto forEachCandidate = [&](int i, auto func)
+	{
+		glm::vec3 p1 = m_predict[i];
+		m_hash->query(p1, max_dist, [&](int j)
+			{
+				if (j == i || isTopologicalNeighbor(i, j)) return;
+				if (glm::length2(m_predict[j] - p1) > max_dist * max_dist) return;
+				func(j);
+			});
+	};
+
+	parallel::forEach(n, [&](int i)
+		{
+			int count = 0;
+			forEachCandidate(i, [&](int j) { count++; });
+			m_collision_start[i + 1] = count;
+		});
+
+	m_collision_start[0] = 0;
+	for (int i = 0; i < n; ++i)
+	{
+		m_collision_start[i + 1] += m_collision_start[i];
+	}
+	m_collision_ids.resize(m_collision_start[n]);
+
+	parallel::forEach(n, [&](int i)
+		{
+			int k = m_collision_start[i];
+			forEachCandidate(i, [&](int j) { m_collision_ids[k++] = j; });
+		});
 }
 
 void Cloth::simulate()
 {
 	if (!m_simulate) return;
 
-	for (int i = 0; i < m_layouts.size(); ++i)
+	// Bounds of the colliders are refit on the main thread before the parallel queries
+	m_collider_bvhs.clear();
+	for (auto& collider : m_colliders)
 	{
-		m_layouts[i].normal = glm::vec3(0.0f);
+		BVH* bvh = collider->getBVH();
+		if (bvh->getNumTriangles() > 0)
+			m_collider_bvhs.push_back(bvh);
 	}
 
-	vector<shared_ptr<ClothParticle>> predict(m_particles.size());
-	vector<ClothParticle*> predict2(m_layouts.size(), nullptr);
+	// Moving the cloth, any collider or any terrain counts as a contact and wakes every region
+	vector<glm::mat4> transforms;
+	for (BVH* bvh : m_collider_bvhs)
+	{
+		transforms.push_back(bvh->getTransform());
+	}
+	for (auto& terrain : m_terrains)
+	{
+		transforms.push_back(terrain->getModelTransform());
+	}
 
-	for (int i = 0; i < m_particles.size(); ++i)
+	if (getModelTransform() != m_sleep_transform || transforms != m_collider_transforms)
 	{
-		ClothParticle* pi = m_particles[i].get();
-		glm::vec3 predict_vel = pi->m_velocity + pi->m_gravity * t_sub;
-		glm::vec3 predict_pos = pi->m_position + predict_vel * t_sub;
-		predict[i] = make_shared<ClothParticle>(predict_pos);
-		predict[i]->m_ids = pi->m_ids;
+		wake();
+		m_sleep_transform = getModelTransform();
+		m_collider_transforms = transforms;
+	}
 
-		if (pi->m_pinned)
-		{
-			predict[i]->m_mass = 0.0f;
-		}
+	// Nothing moves, so there is nothing to integrate or upload
+	if (m_sleep->isAllAsleep()) return;
+
+	int n = int(m_particles.size());
 
-		for (int j = 0; j < pi->m_ids.size(); ++j)
+	// Sleeping particles act as pinned for the awake ones around them
+	parallel::forEach(n, [&](int i)
 		{
-			predict2[pi->m_ids[j]] = predict[i].get();
-		}
-	}
+			ClothParticle* pi = m_particles[i].get();
+			bool is_fixed = pi->m_pinned || m_sleep->isAsleep(m_particle_region[i]);
+			m_inv_mass[i] = is_fixed ? 0.0f : pi->m_mass;
+		});
 
-	buildHash(predict);
-	
 	for (int sub = 0; sub < n_sub_steps; ++sub)
 	{
 		// Update predict position
-		for (int i = 0; i < m_particles.size(); ++i)
-		{
-			ClothParticle* pi = m_particles[i].get();
-			//pi->m_velocity += pi->m_gravity * t_sub;
-			glm::vec3 predict_vel = pi->m_velocity + pi->m_gravity * t_sub;
-			glm::vec3 predict_pos = pi->m_position + predict_vel * t_sub;
-			predict[i]->m_position = predict_pos;
-		}
+		parallel::forEach(n, [&](int i)
+			{
+				ClothParticle* pi = m_particles[i].get();
+				if (m_sleep->isAsleep(m_particle_region[i]))
+				{
+					m_predict[i] = pi->m_position;
+					return;
+				}
+
+				glm::vec3 predict_vel = pi->m_velocity + pi->m_gravity * t_sub;
+				m_predict[i] = pi->m_position + predict_vel * t_sub;
+			});
+
+		// Particles moved, so the self collision grid is rebuilt every substep
+		buildCollisionPairs();
 
  		// Compute Constraints
 		for (int iter = 0; iter < 3; ++iter)
 		{
-			for (int i = 0; i < predict.size(); ++i)
-			{
-				updateStretch(i, predict);
-			}
+			updateStretch();
 
-			for (int i = 0; i < predict2.size()-3; i +=4)
+			for (int i = 0; i < m_bends.size(); ++i)
 			{
-				updateBending(i, 0.0f, predict2);
+				updateBending(m_bends[i], 0.0f);
 			}
 
-			updateCollision(predict);
+			updateCollision();
+			updateMeshCollision();
+			updateTerrainCollision();
 		}
 		
 		// Update Velocity & Position
-		for (int i = 0; i < m_particles.size(); ++i)
-		{
-			ClothParticle* p = m_particles[i].get();
-			
-			if (p->m_pinned)
+		parallel::forEach(n, [&](int i)
 			{
-				p->m_velocity = glm::vec3(0.0f);
-			}
-			else
-			{
-				p->m_velocity  = (predict[i]->m_position - p->m_position) / t_sub * (1.0f - 0.25f*t_sub);
-				p->m_position  = predict[i]->m_position;			
-			}
-		}
+				ClothParticle* p = m_particles[i].get();
 
-		// Air resistance
-		for (int i = 0; i < m_particles.size(); ++i)
-		{
-			m_particles[i]->m_velocity *= 0.998f;
-		}
+				if (m_inv_mass[i] == 0.0f)
+				{
+					p->m_velocity = glm::vec3(0.0f);
+				}
+				else
+				{
+					p->m_velocity = (m_predict[i] - p->m_position) / t_sub * (1.0f - 0.25f * t_sub);
+					p->m_position = m_predict[i];
+				}
+
+				// Air resistance
+				p->m_velocity *= 0.998f;
+			});
 	}
 
+	updateSleep();
+
 	// Update Normal
-	//vector<unsigned int> indices = m_mesh->getBuffer().getIndices();
-	for (int i = 0; i < m_indices.size()-2; i+=3)
-	{		
-		int id1 = m_indices[i];
-		int id2 = m_indices[i+1];
-		int id3 = m_indices[i+2];
-
-		glm::vec3 p1 = predict2[id1]->m_position;
-		glm::vec3 p2 = predict2[id2]->m_position;
-		glm::vec3 p3 = predict2[id3]->m_position;
-
-		glm::vec3 n = -glm::normalize(glm::cross(p2 - p1, p3 - p1));
-		m_layouts[id1].normal = n;
-		m_layouts[id2].normal = n;
-		m_layouts[id3].normal = n;
-	}
+	parallel::forEach(n, [&](int i)
+		{
+			m_particle_pos[i] = m_particles[i]->m_position;
+		});
+
+#if SIM_VALIDATION
+	validate();
+#endif
+
+	m_normals->compute(m_particle_pos, m_particle_normals);
 
 	// Update positions
-	for (int i = 0; i < m_particles.size(); ++i)
-	{
-		ClothParticle* p = m_particles.at(i).get();
-		for (int i = 0; i < p->m_ids.size(); ++i)
+	parallel::forEach(n, [&](int i)
 		{
-			m_layouts[p->m_ids[i]].position = p->m_position; // *m_scale;
-		}
-	}
+			m_layouts[i].position = m_particle_pos[i];
+			m_layouts[i].normal = m_particle_normals[i];
+		});
 
 	updateVertices(m_layouts);
 }
 
-void Cloth::updateStretch(int index, vector<shared_ptr<ClothParticle>>& predict)
+void Cloth::updateStretch()
 {
-	glm::vec3 p1 = predict[index]->m_position;
-	float w1 = predict[index]->m_mass;
-
-	int offset = int(max(m_width, max(m_height, m_depth))) + 1;
-	glm::vec3 sum = glm::vec3(0.0f);
-
-	if ( (index+1) % offset != 0 && (index+1) < predict.size())
-	{
-		// Right
-		info::uint index2 = index + 1;
-		glm::vec3 p2 = predict[index2]->m_position;
-		float w2 = predict[index2]->m_mass;
-
-		glm::vec3 diff = p1 - p2;
-		float dist = glm::length(diff);
-
-		if (dist > m_rest && w1 + w2 > 0.0f)
-		{
-			float lamda = (dist - m_rest) / (w1 + w2);
-			glm::vec3 gradient = diff / dist;
-			predict[index]->m_position  -= w1 * lamda * gradient;
-			predict[index2]->m_position += w2 * lamda * gradient;
-		}
-	}
-
-	if (index + offset < predict.size())
+	// Only stretching is resisted, a compressed edge lets the cloth fold
+	for (const auto& e : m_edges)
 	{
-		// Bottom
-		info::uint index2 = index + int(offset);
-		glm::vec3 p2 = predict[index2]->m_position;
-		float w2 = predict[index2]->m_mass;
+		float w1 = m_inv_mass[e.a];
+		float w2 = m_inv_mass[e.b];
 
-		glm::vec3 diff = p1 - p2;
+		glm::vec3 diff = m_predict[e.a] - m_predict[e.b];
 		float dist = glm::length(diff);
 
-		if (dist > m_rest && w1 + w2 > 0.0f)
+		if (dist > e.rest && w1 + w2 > 0.0f)
 		{
-			float lamda = (dist - m_rest) / (w1 + w2);
+			float lamda = (dist - e.rest) / (w1 + w2);
 			glm::vec3 gradient = diff / dist;
-			predict[index]->m_position  -= w1 * lamda * gradient;
-			predict[index2]->m_position += w2 * lamda * gradient;
-		}
-	}
-
-	if ((index + 1) % offset != 0 && (index + offset) < predict.size())
-	{
-		// Bottom Right
-		info::uint index2 = index + int(offset) + 1;
-		glm::vec3 p2 = predict[index2]->m_position;
-		float w2 = predict[index2]->m_mass;
-
-		glm::vec3 diff = p1 - p2;
-		float dist = glm::length(diff);
-
-		float seperation_diagonal = glm::length(2 * m_rest);
-		if (dist > seperation_diagonal && w1 + w2 > 0.0f)
-		{
-			float lamda = (dist - seperation_diagonal) / (w1 + w2);
-			glm::vec3 gradient = diff / dist;
-			predict[index]->m_position  -= w1 * lamda * gradient;
-			predict[index2]->m_position += w2 * lamda * gradient;
+			m_predict[e.a] -= w1 * lamda * gradient;
+			m_predict[e.b] += w2 * lamda * gradient;
 		}
 	}
 }
 
-void Cloth::updateBending(int index, float rest_angle, vector<ClothParticle*>& predict)
+void Cloth::updateBending(const glm::ivec4& ids, float rest_angle)
 {
-	glm::vec3 p1 = predict[index]->m_position;
-	glm::vec3 p2 = predict[index+2]->m_position;
-	glm::vec3 p3 = predict[index+3]->m_position;
-	glm::vec3 p4 = predict[index+1]->m_position;
+	glm::vec3 p1 = m_predict[ids.x];
+	glm::vec3 p2 = m_predict[ids.y];
+	glm::vec3 p3 = m_predict[ids.z];
+	glm::vec3 p4 = m_predict[ids.w];
 
-	float m1 = predict[index]->m_mass;
-	float m2 = predict[index+2]->m_mass;
-	float m3 = predict[index+3]->m_mass;
-	float m4 = predict[index+1]->m_mass;
+	float m1 = m_inv_mass[ids.x];
+	float m2 = m_inv_mass[ids.y];
+	float m3 = m_inv_mass[ids.z];
+	float m4 = m_inv_mass[ids.w];
 
 	glm::vec3 n1 = glm::normalize(glm::cross(p2 - p1, p3 - p1));
 	glm::vec3 n2 = glm::normalize(glm::cross(p2 - p1, p4 - p1));
@@ -334,55 +422,231 @@ void Cloth::updateBending(int index, float rest_angle, vector<ClothParticle*>& p
 	{
 		lamda = sqrt(1.0f - d * d) * (angle - rest_angle) / lamda;
 
-		predict[index]->m_position	  -= m1 * u1 * lamda;
-		predict[index + 1]->m_position -= m2 * u2 * lamda;
-		predict[index + 2]->m_position -= m3 * u3 * lamda;
-		predict[index + 3]->m_position -= m4 * u4 * lamda;
+		m_predict[ids.x] -= m1 * u1 * lamda;
+		m_predict[ids.y] -= m2 * u2 * lamda;
+		m_predict[ids.z] -= m3 * u3 * lamda;
+		m_predict[ids.w] -= m4 * u4 * lamda;
 	}
 }
 
-void Cloth::updateCollision(vector<shared_ptr<ClothParticle>>& predict)
+void Cloth::updateCollision()
 {
-	for (int i = 0; i < predict.size(); ++i)
-	{
-		ClothParticle* curr = predict[i].get();
-		glm::vec3 p1 = predict[i]->m_position;
-		float w1 = predict[i]->m_mass;
-		glm::ivec3 p1_grid = getGridPos(p1);
+	int n = int(m_predict.size());
+
+	parallel::forEach(n, [&](int i)
+		{
+			m_collision_pos[i] = m_predict[i];
+		});
 
-		for (int x = -1; x <= 1; x++)
+	// Jacobi style: every particle only moves itself, so the result does not depend on thread order
+	parallel::forEach(n, [&](int i)
 		{
-			for (int y = -1; y <= 1; y++)
+			glm::vec3 p1 = m_collision_pos[i];
+			float w1 = m_inv_mass[i];
+			glm::vec3 delta = glm::vec3(0.0f);
+
+			for (int k = m_collision_start[i]; k < m_collision_start[i + 1]; ++k)
 			{
-				for (int z = -1; z <= 1; z++)
+				int j = m_collision_ids[k];
+				glm::vec3 p2 = m_collision_pos[j];
+				float w2 = m_inv_mass[j];
+
+				glm::vec3 diff = p1 - p2;
+				float dist = glm::length(diff);
+
+				if (dist < m_thickness && w1 + w2 > 0.0f)
 				{
-					glm::ivec3 near_pos = p1_grid + glm::ivec3(x, y, z);
-					info::uint index = getHashIndex(near_pos);
-					ClothParticle* neighbor = m_hash[index];
-
-					while (neighbor)
-					{
-						glm::vec3 p2 = neighbor->m_position;
-						float w2 = neighbor->m_mass;
-						
-						glm::vec3 diff = p1 - p2;
-						float dist = glm::length(p1 - p2);
-
-						if (dist < m_rest && w1 + w2 > 0.0f && curr != neighbor)
-						{
-							glm::vec3 gradient = diff / (dist + 0.000001f);
-							float lamda = (dist - m_rest) / (w1 + w2);
-							predict[i]->m_position -= w1 * lamda * gradient;
-							neighbor->m_position   += w2 * lamda * gradient;
-						}
-
-						neighbor = neighbor->m_next;
-					}
+					glm::vec3 gradient = diff / (dist + 0.000001f);
+					float lamda = (dist - m_thickness) / (w1 + w2);
+					delta -= w1 * lamda * gradient;
 				}
 			}
-		}
+
+			m_collision_delta[i] = delta;
+		});
+
+	parallel::forEach(n, [&](int i)
+		{
+			m_predict[i] += m_collision_delta[i];
+		});
+}
+
+void Cloth::updateMeshCollision()
+{
+	if (m_collider_bvhs.empty()) return;
+
+	// Particles live in the local space of the cloth while the colliders are in world space
+	glm::mat4 M = getModelTransform();
+	glm::mat4 M_inv = glm::inverse(M);
+
+	parallel::forEach(int(m_predict.size()), [&](int i)
+		{
+			if (m_inv_mass[i] == 0.0f) return;
+
+			glm::vec3 p = glm::vec3(M * glm::vec4(m_predict[i], 1.0f));
+			glm::vec3 prev = glm::vec3(M * glm::vec4(m_particles[i]->m_position, 1.0f));
+			bool is_hit = false;
+
+			for (BVH* bvh : m_collider_bvhs)
+			{
+				glm::vec3 closest, normal;
+				if (!bvh->closestPoint(p, m_mesh_thickness, closest, normal)) continue;
+
+				float d = glm::dot(p - closest, normal);
+				if (d >= m_mesh_thickness) continue;
+
+				// Push out along the face normal
+				pushOut(p, prev, normal, m_mesh_thickness - d);
+				is_hit = true;
+			}
+
+			if (is_hit)
+			{
+				m_predict[i] = glm::vec3(M_inv * glm::vec4(p, 1.0f));
+			}
+		});
+}
+
+void Cloth::updateTerrainCollision()
+{
+	if (m_terrains.empty()) return;
+
+	glm::mat4 M = getModelTransform();
+	glm::mat4 M_inv = glm::inverse(M);
+
+	int n = int(m_predict.size());
+	m_terrain_pos.resize(n);
+	parallel::forEach(n, [&](int i) { m_terrain_pos[i] = glm::vec3(M * glm::vec4(m_predict[i], 1.0f)); });
+
+	for (auto& terrain : m_terrains)
+	{
+		terrain->getSurfaces(m_terrain_pos, m_terrain_heights, m_terrain_normals);
+
+		parallel::forEach(n, [&](int i)
+			{
+				if (m_inv_mass[i] == 0.0f) return;
+
+				// Distance to the tangent plane of the surface below the particle
+				glm::vec3 normal = m_terrain_normals[i];
+				float d = (m_terrain_pos[i].y - m_terrain_heights[i]) * normal.y;
+				if (d >= m_mesh_thickness) return;
+
+				glm::vec3 prev = glm::vec3(M * glm::vec4(m_particles[i]->m_position, 1.0f));
+				pushOut(m_terrain_pos[i], prev, normal, m_mesh_thickness - d);
+				m_predict[i] = glm::vec3(M_inv * glm::vec4(m_terrain_pos[i], 1.0f));
+			});
+	}
+}
+
+void Cloth::pushOut(glm::vec3& p, const glm::vec3& prev, const glm::vec3& normal, float penetration) const
+{
+	p += normal * penetration;
+
+	// Coulomb friction on the displacement of this substep
+	glm::vec3 move = p - prev;
+	glm::vec3 tangent = move - normal * glm::dot(move, normal);
+	float len = glm::length(tangent);
+	if (len > 0.000001f)
+	{
+		p -= tangent * min(1.0f, m_friction * penetration / len);
+	}
+}
+
+void Cloth::validate()
+{
+	int n = int(m_particles.size());
+	m_validation_vel.resize(n);
+
+	float energy = 0.0f;
+	for (int i = 0; i < n; ++i)
+	{
+		m_validation_vel[i] = m_particles[i]->m_velocity;
+		energy += 0.5f * glm::dot(m_validation_vel[i], m_validation_vel[i]);
+	}
+
+	m_validator->beginStep();
+	m_validator->setParam("t_sub", t_sub);
+	m_validator->setParam("columns", float(m_cols));
+	m_validator->setParam("rows", float(m_rows));
+	m_validator->setParam("thickness", m_mesh_thickness);
+	m_validator->setParam("friction", m_friction);
+
+	m_validator->checkFinite(m_particle_pos, "position");
+	m_validator->checkFinite(m_validation_vel, "velocity");
+	m_validator->checkEnergy(energy / max(1, n));
+
+	// Relative stretch of the worst edge
+	float strain = 0.0f;
+	for (const auto& e : m_edges)
+	{
+		float d = glm::length(m_particle_pos[e.b] - m_particle_pos[e.a]);
+		strain = max(strain, abs(d - e.rest) / e.rest);
 	}
+	m_validator->checkConstraint(strain, 1.0f, "Stretch");
+}
+
+void Cloth::renderExtraProperty()
+{
+	if (ImGui::CollapsingHeader("Cloth"))
+	{
+		static ImGuiTableFlags flags = ImGuiTableFlags_RowBg;
+		ImVec2 cell_padding(0.0f, 2.0f);
+		ImGui::PushStyleVar(ImGuiStyleVar_CellPadding, cell_padding);
+		ImGui::BeginTable("Cloth", 2);
+
+		ImGui::TableNextRow();
+		ImGui::TableNextColumn();
+		ImGui::AlignTextToFramePadding();
+		ImGui::Text("Thickness");
+		ImGui::TableNextColumn();
+		string id = "##thickness";
+		ImGui::SliderFloat(id.c_str(), &m_mesh_thickness, 0.0f, 4.0f * m_rest, "%.3f", 0);
+
+		ImGui::TableNextRow();
+		ImGui::TableNextColumn();
+		ImGui::AlignTextToFramePadding();
+		ImGui::Text("Friction");
+		ImGui::TableNextColumn();
+		id = "##friction";
+		ImGui::SliderFloat(id.c_str(), &m_friction, 0.0f, 1.0f, "%.2f", 0);
+
+		ImGui::TableNextRow();
+		ImGui::TableNextColumn();
+		ImGui::AlignTextToFramePadding();
+		ImGui::Text("Sleep Energy");
+		ImGui::TableNextColumn();
+		id = "##sleep";
+		if (ImGui::SliderFloat(id.c_str(), &m_sleep->getThreshold(), 0.0f, 0.01f, "%.4f", 0))
+		{
+			wake();
+		}
+
+		ImGui::TableNextRow();
+		ImGui::TableNextColumn();
+		ImGui::AlignTextToFramePadding();
+		ImGui::Text("Sleeping");
+		ImGui::TableNextColumn();
+		ImGui::Text("%d / %d", m_sleep->getNumAsleep(), m_sleep->getNumRegions());
+
+		ImGui::TableNextRow();
+		ImGui::TableNextColumn();
+		ImGui::AlignTextToFramePadding();
+		ImGui::Text("Resolution");
+		ImGui::TableNextColumn();
+		id = "##resolution";
+		ImGui::SliderInt(id.c_str(), &m_builder.getResolution(), 2, 1024, "%d", 0);
+
+		ImGui::TableNextRow();
+		ImGui::TableNextColumn();
+		ImGui::TableNextColumn();
+		if (ImGui::Button("Rebuild"))
+		{
+			rebuild();
+		}
 
+		ImGui::EndTable();
+		ImGui::PopStyleVar();
+	}
 }
 
 void Cloth::draw(
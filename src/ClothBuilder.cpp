@@ -0,0 +1,110 @@
+#include "ClothBuilder.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glm/gtc/constants.hpp>
+
+ClothBuilder::ClothBuilder(float width, float height, int resolution) :
+	m_width(width), m_height(height), m_resolution(max(2, resolution))
+{}
+
+void ClothBuilder::pin(float u, float v)
+{
+	m_pins.push_back(glm::vec2(u, v));
+}
+
+void ClothBuilder::pinRow(float v)
+{
+	m_pin_rows.push_back(v);
+}
+
+ClothData ClothBuilder::build() const
+{
+	ClothData data;
+	data.cols = m_resolution;
+	data.spacing = m_width / float(m_resolution - 1);
+	data.rows = max(2, int(round(m_height / data.spacing)) + 1);
+
+	int cols = data.cols;
+	int rows = data.rows;
+	int n = cols * rows;
+
+	auto getId = [cols](int col, int row) { return col + cols * row; };
+
+	data.layouts.resize(n);
+	data.pinned.assign(n, false);
+	for (int row = 0; row < rows; ++row)
+	{
+		for (int col = 0; col < cols; ++col)
+		{
+			info::VertexLayout& layout = data.layouts[getId(col, row)];
+			layout.position = glm::vec3(col * data.spacing, 0.0f, row * data.spacing);
+			layout.normal = glm::vec3(0.0f, 1.0f, 0.0f);
+			layout.tangent = glm::vec3(1.0f, 0.0f, 0.0f);
+			layout.texCoord = glm::vec2(float(col) / (cols - 1), float(row) / (rows - 1));
+		}
+	}
+
+	for (const auto& uv : m_pins)
+	{
+		int col = glm::clamp(int(round(uv.x * (cols - 1))), 0, cols - 1);
+		int row = glm::clamp(int(round(uv.y * (rows - 1))), 0, rows - 1);
+		data.pinned[getId(col, row)] = true;
+	}
+
+	for (float v : m_pin_rows)
+	{
+		int row = glm::clamp(int(round(v * (rows - 1))), 0, rows - 1);
+		for (int col = 0; col < cols; ++col)
+		{
+			data.pinned[getId(col, row)] = true;
+		}
+	}
+
+	// Stretch : right, bottom and bottom right of every particle
+	// The diagonal rests at the length of the cell diagonal, so it resists shearing
+	data.edges.reserve(3 * n);
+	for (int row = 0; row < rows; ++row)
+	{
+		for (int col = 0; col < cols; ++col)
+		{
+			int id = getId(col, row);
+
+			if (col + 1 < cols)
+				data.edges.push_back({ id, getId(col + 1, row), data.spacing });
+
+			if (row + 1 < rows)
+				data.edges.push_back({ id, getId(col, row + 1), data.spacing });
+
+			if (col + 1 < cols && row + 1 < rows)
+				data.edges.push_back({ id, getId(col + 1, row + 1), glm::root_two<float>() * data.spacing });
+		}
+	}
+
+	// Two triangles per cell split along the top left to bottom right diagonal
+	data.indices.reserve(6 * (cols - 1) * (rows - 1));
+	data.bends.reserve((cols - 1) * (rows - 1));
+	for (int row = 0; row + 1 < rows; ++row)
+	{
+		for (int col = 0; col + 1 < cols; ++col)
+		{
+			int tl = getId(col, row);
+			int tr = getId(col + 1, row);
+			int bl = getId(col, row + 1);
+			int br = getId(col + 1, row + 1);
+
+			data.indices.push_back(tl);
+			data.indices.push_back(bl);
+			data.indices.push_back(br);
+
+			data.indices.push_back(tl);
+			data.indices.push_back(br);
+			data.indices.push_back(tr);
+
+			data.bends.push_back(glm::ivec4(tl, br, tr, bl));
+		}
+	}
+
+	return data;
+}
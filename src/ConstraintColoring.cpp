@@ -0,0 +1,76 @@
+#include "ConstraintColoring.h"
+
+ConstraintColoring::ConstraintColoring()
+{
+	m_color_start.push_back(0);
+}
+
+void ConstraintColoring::build(const vector<int>& ids, int arity, int num_particles)
+{
+	int n = int(ids.size()) / arity;
+
+	// Constraints around each particle (CSR)
+	vector<int> particle_start(num_particles + 1, 0);
+	for (int i = 0; i < n * arity; ++i)
+	{
+		particle_start[ids[i] + 1]++;
+	}
+
+	for (int i = 0; i < num_particles; ++i)
+	{
+		particle_start[i + 1] += particle_start[i];
+	}
+
+	vector<int> particle_constraints(particle_start[num_particles]);
+	vector<int> fill = particle_start;
+	for (int i = 0; i < n * arity; ++i)
+	{
+		particle_constraints[fill[ids[i]]++] = i / arity;
+	}
+
+	// Smallest colour not taken by an already coloured neighbour, visited in constraint order so the result is stable
+	vector<int> colors(n, -1);
+	vector<int> stamp;
+	int n_colors = 0;
+	for (int i = 0; i < n; ++i)
+	{
+		for (int k = 0; k < arity; ++k)
+		{
+			int p = ids[i * arity + k];
+			for (int j = particle_start[p]; j < particle_start[p + 1]; ++j)
+			{
+				int c = colors[particle_constraints[j]];
+				if (c >= 0) stamp[c] = i;
+			}
+		}
+
+		int color = 0;
+		while (color < n_colors && stamp[color] == i) color++;
+		if (color == n_colors)
+		{
+			n_colors++;
+			stamp.push_back(-1);
+		}
+
+		colors[i] = color;
+	}
+
+	// Counting sort by colour
+	m_color_start.assign(n_colors + 1, 0);
+	for (int i = 0; i < n; ++i)
+	{
+		m_color_start[colors[i] + 1]++;
+	}
+
+	for (int c = 0; c < n_colors; ++c)
+	{
+		m_color_start[c + 1] += m_color_start[c];
+	}
+
+	m_order.resize(n);
+	fill = m_color_start;
+	for (int i = 0; i < n; ++i)
+	{
+		m_order[fill[colors[i]]++] = i;
+	}
+}
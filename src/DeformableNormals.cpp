@@ -0,0 +1,100 @@
+#include "DeformableNormals.h"
+
+#include "Parallel.h"
+
+DeformableNormals::DeformableNormals() : m_flip(false)
+{
+	m_vertex_start.push_back(0);
+}
+
+DeformableNormals::DeformableNormals(const vector<info::uint>& indices, int num_vertices, bool flip)
+{
+	build(indices, num_vertices, flip);
+}
+
+void DeformableNormals::build(const vector<info::uint>& indices, int num_vertices, bool flip)
+{
+	m_flip = flip;
+
+	m_faces.clear();
+	for (int i = 0; i + 2 < indices.size(); i += 3)
+	{
+		m_faces.push_back(glm::ivec3(indices[i], indices[i + 1], indices[i + 2]));
+	}
+	m_face_normals.resize(m_faces.size());
+
+	// Count the faces around each vertex, then fill in face order
+	m_vertex_start.assign(num_vertices + 1, 0);
+	for (const auto& f : m_faces)
+	{
+		for (int k = 0; k < 3; ++k)
+		{
+			if (f[k] < num_vertices) m_vertex_start[f[k] + 1]++;
+		}
+	}
+
+	for (int i = 0; i < num_vertices; ++i)
+	{
+		m_vertex_start[i + 1] += m_vertex_start[i];
+	}
+
+	m_vertex_faces.resize(m_vertex_start[num_vertices]);
+	vector<int> fill = m_vertex_start;
+	for (int i = 0; i < m_faces.size(); ++i)
+	{
+		for (int k = 0; k < 3; ++k)
+		{
+			int v = m_faces[i][k];
+			if (v < num_vertices) m_vertex_faces[fill[v]++] = i;
+		}
+	}
+}
+
+void DeformableNormals::compute(const vector<glm::vec3>& positions, vector<glm::vec3>& normals)
+{
+	int n = getNumVertices();
+	if (positions.size() < n) return;
+	normals.resize(n);
+
+	// Length of the cross product is twice the area of the face, so summing unnormalized normals weights by area
+	parallel::forEach(getNumFaces(), [&](int i)
+		{
+			const glm::ivec3& f = m_faces[i];
+			glm::vec3 a = positions[f.x];
+			glm::vec3 b = positions[f.y];
+			glm::vec3 c = positions[f.z];
+			m_face_normals[i] = glm::cross(b - a, c - a);
+		});
+
+	float sign = m_flip ? -1.0f : 1.0f;
+	parallel::forEach(n, [&](int i)
+		{
+			glm::vec3 sum = glm::vec3(0.0f);
+			for (int k = m_vertex_start[i]; k < m_vertex_start[i + 1]; ++k)
+			{
+				sum += m_face_normals[m_vertex_faces[k]];
+			}
+
+			float len = glm::length(sum);
+			normals[i] = len > 0.0f ? sign * sum / len : glm::vec3(0.0f, 1.0f, 0.0f);
+		});
+}
+
+void DeformableNormals::compute(vector<info::VertexLayout>& layouts)
+{
+	int n = getNumVertices();
+	if (layouts.size() < n) return;
+
+	m_positions.resize(n);
+	parallel::forEach(n, [&](int i)
+		{
+			m_positions[i] = layouts[i].position;
+		});
+
+	compute(m_positions, m_normals);
+
+	parallel::forEach(n, [&](int i)
+		{
+			layouts[i].normal = m_normals[i];
+		});
+}
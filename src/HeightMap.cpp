@@ -0,0 +1,73 @@
+#include "HeightMap.h"
+
+HeightMap::HeightMap(int res, int num_layers) : m_res(res), m_num_layers(num_layers)
+{
+	// Linear filtering, the tessellated vertices sample between grid vertices
+	glGenTextures(1, &m_height_texture);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_height_texture);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_R32F, m_res, m_res, m_num_layers, 0, GL_RED, GL_FLOAT, NULL);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	glGenTextures(1, &m_normal_texture);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_normal_texture);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGB32F, m_res, m_res, m_num_layers, 0, GL_RGB, GL_FLOAT, NULL);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+HeightMap::~HeightMap()
+{
+	glDeleteTextures(1, &m_height_texture);
+	glDeleteTextures(1, &m_normal_texture);
+}
+
+void HeightMap::upload(int layer, const vector<float>& heights, const vector<glm::vec3>& normals)
+{
+	updateHeights(layer, heights, 0, 0, m_res - 1, m_res - 1);
+	updateNormals(layer, normals, 0, 0, m_res - 1, m_res - 1);
+}
+
+void HeightMap::updateHeights(int layer, const vector<float>& heights, int x0, int z0, int x1, int z1)
+{
+	updateRect(m_height_texture, GL_RED, layer, heights.data(), 1, x0, z0, x1, z1);
+}
+
+void HeightMap::updateNormals(int layer, const vector<glm::vec3>& normals, int x0, int z0, int x1, int z1)
+{
+	updateRect(m_normal_texture, GL_RGB, layer, normals.data(), 3, x0, z0, x1, z1);
+}
+
+void HeightMap::updateRect(GLuint texture, GLenum format, int layer, const void* data, int stride, int x0, int z0, int x1, int z1)
+{
+	x0 = glm::clamp(x0, 0, m_res - 1);
+	z0 = glm::clamp(z0, 0, m_res - 1);
+	x1 = glm::clamp(x1, 0, m_res - 1);
+	z1 = glm::clamp(z1, 0, m_res - 1);
+	if (x1 < x0 || z1 < z0 || layer < 0 || layer >= m_num_layers) return;
+
+	// Rows of the rectangle are read straight out of the full grid
+	const float* first = static_cast<const float*>(data) + stride * (x0 + m_res * z0);
+
+	glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, m_res);
+	glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, x0, z0, layer, x1 - x0 + 1, z1 - z0 + 1, 1, format, GL_FLOAT, first);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+void HeightMap::bind(int height_unit, int normal_unit) const
+{
+	glActiveTexture(GL_TEXTURE0 + height_unit);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_height_texture);
+
+	glActiveTexture(GL_TEXTURE0 + normal_unit);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_normal_texture);
+}
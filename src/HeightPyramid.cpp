@@ -0,0 +1,274 @@
+#include "HeightPyramid.h"
+
+#include <algorithm>
+#include <cfloat>
+
+namespace
+{
+	// Ray against the triangle (a, b, c) from both sides, t is along the unnormalized ray_dir
+	bool intersectTri(const glm::vec3& ray_dir, const glm::vec3& ray_pos,
+		const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, float& t)
+	{
+		const float eps = 1.0e-7f;
+
+		glm::vec3 ab = b - a;
+		glm::vec3 ac = c - a;
+		glm::vec3 p = glm::cross(ray_dir, ac);
+		float det = glm::dot(ab, p);
+		if (glm::abs(det) < eps) return false;
+
+		float inv_det = 1.0f / det;
+		glm::vec3 ap = ray_pos - a;
+		float u = glm::dot(ap, p) * inv_det;
+		if (u < -eps || u > 1.0f + eps) return false;
+
+		glm::vec3 q = glm::cross(ap, ab);
+		float v = glm::dot(ray_dir, q) * inv_det;
+		if (v < -eps || u + v > 1.0f + eps) return false;
+
+		t = glm::dot(ac, q) * inv_det;
+		return t > 0.0f;
+	}
+}
+
+HeightPyramid::HeightPyramid() : m_heights(nullptr), m_res(0)
+{
+}
+
+bool HeightPyramid::intersectBox(
+	const glm::vec3& ray_dir,
+	const glm::vec3& ray_pos,
+	const glm::vec3& box_min,
+	const glm::vec3& box_max,
+	float& t_near,
+	float& t_far)
+{
+	t_near = 0.0f;
+	t_far = FLT_MAX;
+	for (int i = 0; i < 3; ++i)
+	{
+		if (glm::abs(ray_dir[i]) < 1.0e-12f)
+		{
+			if (ray_pos[i] < box_min[i] || ray_pos[i] > box_max[i]) return false;
+			continue;
+		}
+
+		float inv = 1.0f / ray_dir[i];
+		float t0 = (box_min[i] - ray_pos[i]) * inv;
+		float t1 = (box_max[i] - ray_pos[i]) * inv;
+		if (t0 > t1) swap(t0, t1);
+
+		t_near = max(t_near, t0);
+		t_far = min(t_far, t1);
+		if (t_near > t_far) return false;
+	}
+
+	return true;
+}
+
+void HeightPyramid::build(const vector<float>& heights, int res)
+{
+	m_heights = &heights;
+	m_res = res;
+
+	m_levels.clear();
+	m_sizes.clear();
+
+	int size = max(res - 1, 1);
+	while (true)
+	{
+		m_levels.push_back(vector<glm::vec2>(size * size));
+		m_sizes.push_back(size);
+		if (size == 1) break;
+		size = (size + 1) / 2;
+	}
+
+	update(heights, 0, 0, res - 1, res - 1);
+}
+
+void HeightPyramid::update(const vector<float>& heights, int x0, int z0, int x1, int z1)
+{
+	m_heights = &heights;
+	if (m_levels.empty()) return;
+
+	// A grid vertex belongs to the cells on both of its sides
+	int n = m_sizes[0];
+	x0 = glm::clamp(x0 - 1, 0, n - 1);
+	z0 = glm::clamp(z0 - 1, 0, n - 1);
+	x1 = glm::clamp(x1, 0, n - 1);
+	z1 = glm::clamp(z1, 0, n - 1);
+
+	for (int z = z0; z <= z1; ++z)
+	{
+		for (int x = x0; x <= x1; ++x)
+		{
+			float h00 = heights[x + m_res * z];
+			float h10 = heights[x + 1 + m_res * z];
+			float h01 = heights[x + m_res * (z + 1)];
+			float h11 = heights[x + 1 + m_res * (z + 1)];
+
+			m_levels[0][x + n * z] = glm::vec2(
+				min(min(h00, h10), min(h01, h11)),
+				max(max(h00, h10), max(h01, h11)));
+		}
+	}
+
+	for (int level = 1; level < m_levels.size(); ++level)
+	{
+		x0 /= 2; z0 /= 2; x1 /= 2; z1 /= 2;
+		updateLevel(level, x0, z0, x1, z1);
+	}
+}
+
+void HeightPyramid::updateLevel(int level, int x0, int z0, int x1, int z1)
+{
+	const vector<glm::vec2>& child = m_levels[level - 1];
+	int child_size = m_sizes[level - 1];
+	int size = m_sizes[level];
+
+	for (int z = z0; z <= z1; ++z)
+	{
+		for (int x = x0; x <= x1; ++x)
+		{
+			glm::vec2 bound(FLT_MAX, -FLT_MAX);
+			for (int j = 2 * z; j <= min(2 * z + 1, child_size - 1); ++j)
+			{
+				for (int i = 2 * x; i <= min(2 * x + 1, child_size - 1); ++i)
+				{
+					const glm::vec2& b = child[i + child_size * j];
+					bound.x = min(bound.x, b.x);
+					bound.y = max(bound.y, b.y);
+				}
+			}
+
+			m_levels[level][x + size * z] = bound;
+		}
+	}
+}
+
+bool HeightPyramid::intersectCell(
+	const glm::vec3& ray_dir,
+	const glm::vec3& ray_pos,
+	const glm::vec2& origin,
+	const glm::vec2& spacing,
+	int x, int z,
+	float& t) const
+{
+	const vector<float>& h = *m_heights;
+	glm::vec3 p1(origin.x + spacing.x * x, h[x + m_res * z], origin.y + spacing.y * z);
+	glm::vec3 p2(origin.x + spacing.x * (x + 1), h[x + 1 + m_res * z], origin.y + spacing.y * z);
+	glm::vec3 p3(origin.x + spacing.x * x, h[x + m_res * (z + 1)], origin.y + spacing.y * (z + 1));
+	glm::vec3 p4(origin.x + spacing.x * (x + 1), h[x + 1 + m_res * (z + 1)], origin.y + spacing.y * (z + 1));
+
+	// Same split as the terrain mesh, both triangles share the diagonal p1 p4
+	float t1 = FLT_MAX;
+	float t2 = FLT_MAX;
+	bool hit1 = intersectTri(ray_dir, ray_pos, p1, p4, p2, t1);
+	bool hit2 = intersectTri(ray_dir, ray_pos, p1, p3, p4, t2);
+	if (!hit1 && !hit2) return false;
+
+	t = min(hit1 ? t1 : FLT_MAX, hit2 ? t2 : FLT_MAX);
+	return true;
+}
+
+bool HeightPyramid::intersect(
+	const glm::vec3& ray_dir,
+	const glm::vec3& ray_pos,
+	const glm::vec2& origin,
+	const glm::vec2& spacing,
+	float& t,
+	glm::ivec2& cell) const
+{
+	if (m_levels.empty() || m_heights == nullptr) return false;
+
+	struct Node
+	{
+		int level;
+		int x;
+		int z;
+	};
+
+	// Depth first with the nearer children on top, at most 4 nodes per level wait on the stack
+	vector<Node> stack;
+	stack.reserve(4 * m_levels.size());
+	stack.push_back({ int(m_levels.size()) - 1, 0, 0 });
+
+	int n = m_sizes[0];
+	float best = FLT_MAX;
+	while (!stack.empty())
+	{
+		Node node = stack.back();
+		stack.pop_back();
+
+		const glm::vec2& bound = m_levels[node.level][node.x + m_sizes[node.level] * node.z];
+		int span = 1 << node.level;
+		int cx0 = node.x * span;
+		int cz0 = node.z * span;
+		int cx1 = min(cx0 + span, n);
+		int cz1 = min(cz0 + span, n);
+
+		glm::vec3 box_min(origin.x + spacing.x * cx0, bound.x, origin.y + spacing.y * cz0);
+		glm::vec3 box_max(origin.x + spacing.x * cx1, bound.y, origin.y + spacing.y * cz1);
+
+		float t_near, t_far;
+		if (!intersectBox(ray_dir, ray_pos, box_min, box_max, t_near, t_far)) continue;
+		if (t_near >= best) continue;
+
+		if (node.level == 0)
+		{
+			float t_cell;
+			if (intersectCell(ray_dir, ray_pos, origin, spacing, node.x, node.z, t_cell) && t_cell < best)
+			{
+				best = t_cell;
+				cell = glm::ivec2(node.x, node.z);
+			}
+			continue;
+		}
+
+		// Children in order of entry along the ray, pushed far first
+		int child_size = m_sizes[node.level - 1];
+		Node children[4];
+		float entry[4];
+		int count = 0;
+		for (int j = 0; j < 2; ++j)
+		{
+			for (int i = 0; i < 2; ++i)
+			{
+				int x = 2 * node.x + i;
+				int z = 2 * node.z + j;
+				if (x >= child_size || z >= child_size) continue;
+
+				int child_span = span / 2;
+				glm::vec2 center(
+					origin.x + spacing.x * (x + 0.5f) * child_span,
+					origin.y + spacing.y * (z + 0.5f) * child_span);
+
+				children[count] = { node.level - 1, x, z };
+				entry[count] = glm::dot(glm::vec2(ray_dir.x, ray_dir.z), center - glm::vec2(ray_pos.x, ray_pos.z));
+				count++;
+			}
+		}
+
+		for (int i = 0; i < count; ++i)
+		{
+			for (int j = i + 1; j < count; ++j)
+			{
+				if (entry[j] > entry[i])
+				{
+					swap(entry[i], entry[j]);
+					swap(children[i], children[j]);
+				}
+			}
+		}
+
+		for (int i = 0; i < count; ++i)
+		{
+			stack.push_back(children[i]);
+		}
+	}
+
+	if (best >= FLT_MAX) return false;
+
+	t = best;
+	return true;
+}
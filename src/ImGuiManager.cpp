@@ -4,6 +4,9 @@ ImGuiManager::ImGuiManager()
 {
 	m_panels.push_back(make_shared<SceneHierarchyPanel>());
 	m_panels.push_back(make_shared<PropertyPanel>());
+#if PROFILING
+	m_panels.push_back(make_shared<ProfilerPanel>());
+#endif
 
 	m_main_menu = make_unique<ImGuiMenuBar>();
 
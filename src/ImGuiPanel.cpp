@@ -9,6 +9,7 @@
 #include "Object.h"
 #include "ObjectManager.h"
 #include "ObjectCollection.h"
+#include "SDFBaker.h"
 #include "SPHSystemCuda.h"
 #include "SoftBodyObject.h"
 #include "Terrain.h"
@@ -326,6 +327,20 @@ void PopupObject::render(
 		ObjectManager::getObjectManager()->addSoftBody(soft);
 		collection->addObject(soft);
 	}
+
+	if (ImGui::MenuItem("Benchmark SDF"))
+	{
+		// The bounds are in world space, so bake the mesh where it is drawn
+		vector<info::VertexLayout> layouts = clicked_object->getVertices();
+		glm::mat4 M = clicked_object->getModelTransform();
+		vector<glm::vec3> positions(layouts.size());
+		for (int i = 0; i < layouts.size(); ++i)
+		{
+			positions[i] = glm::vec3(M * glm::vec4(layouts[i].position, 1.0f));
+		}
+
+		SDFBaker::benchmark(positions, clicked_object->getIndices(), clicked_object->getMin(), clicked_object->getMax());
+	}
 }
 
 PopupSceneHierarchy::PopupSceneHierarchy() : ImGuiPanel("PopupScene")
@@ -380,3 +395,117 @@ void PopupSceneHierarchy::render(
 	}
 
 }
+
+#if PROFILING
+ProfilerPanel::ProfilerPanel() : ImGuiPanel("Profiler") {}
+
+ProfilerPanel::~ProfilerPanel() {}
+
+void ProfilerPanel::render(
+	shared_ptr<ObjectCollection>& collection,
+	shared_ptr<Object>& clicked_object)
+{
+	ImGui::Begin("Profiler");
+	{
+		calculatePanelSize();
+
+		Profiler* profiler = Profiler::getProfiler();
+		ImGui::Checkbox("Pause", &profiler->getIsPaused());
+		ImGui::SameLine();
+		if (ImGui::Button("Export Trace"))
+		{
+			profiler->writeTrace("assets/profile/trace.json");
+		}
+
+		const Profiler::Frame* frame = profiler->getLastFrame();
+		if (frame == nullptr)
+		{
+			ImGui::End();
+			return;
+		}
+
+		// CPU frame times of the recorded frames
+		const deque<Profiler::Frame>& history = profiler->getHistory();
+		m_frame_times.resize(history.size());
+		for (int i = 0; i < int(history.size()); i++)
+		{
+			m_frame_times[i] = float(history[i].cpu_ms);
+		}
+
+		double gpu_ms = 0.0;
+		for (const auto& zone : frame->zones)
+		{
+			if (zone.gpu_ms >= 0.0) gpu_ms += zone.gpu_ms;
+		}
+
+		ImGui::Text("Frame %lld  CPU %.2f ms  GPU %.2f ms", frame->index, frame->cpu_ms, gpu_ms);
+		ImGui::PlotHistogram("##frame_times", m_frame_times.data(), int(m_frame_times.size()),
+			0, nullptr, 0.0f, FLT_MAX, ImVec2(ImGui::GetContentRegionAvail().x, 60.0f));
+
+		ImGui::SeparatorText("Flame Graph");
+		renderFlameGraph(*frame);
+
+		ImGui::SeparatorText("Zones");
+		renderZoneTable(*frame);
+	}
+	ImGui::End();
+}
+
+void ProfilerPanel::renderFlameGraph(const Profiler::Frame& frame)
+{
+	// One row per depth, widths from the CPU time of the zone
+	ImDrawList* draw_list = ImGui::GetWindowDrawList();
+	ImVec2 origin = ImGui::GetCursorScreenPos();
+	float width = max(ImGui::GetContentRegionAvail().x, 1.0f);
+	float row = ImGui::GetFrameHeight();
+	double scale = frame.cpu_ms > 0.0 ? width / frame.cpu_ms : 0.0;
+
+	int max_depth = 0;
+	for (const auto& zone : frame.zones)
+	{
+		max_depth = max(max_depth, zone.depth);
+
+		ImVec2 rect_min(origin.x + float((zone.cpu_start - frame.start) * scale), origin.y + zone.depth * row);
+		ImVec2 rect_max(rect_min.x + max(float(zone.cpu_ms * scale), 1.0f), rect_min.y + row - 1.0f);
+
+		// GPU passes in orange
+		ImU32 color = zone.gpu_ms >= 0.0 ? IM_COL32(200, 110, 60, 255) : IM_COL32(70, 120, 190, 255);
+		draw_list->AddRectFilled(rect_min, rect_max, color);
+
+		draw_list->PushClipRect(rect_min, rect_max, true);
+		draw_list->AddText(ImVec2(rect_min.x + 3.0f, rect_min.y + ImGui::GetStyle().FramePadding.y), IM_COL32_WHITE, zone.name);
+		draw_list->PopClipRect();
+
+		if (ImGui::IsMouseHoveringRect(rect_min, rect_max))
+		{
+			if (zone.gpu_ms >= 0.0) ImGui::SetTooltip("%s\nCPU %.3f ms\nGPU %.3f ms", zone.name, zone.cpu_ms, zone.gpu_ms);
+			else ImGui::SetTooltip("%s\nCPU %.3f ms", zone.name, zone.cpu_ms);
+		}
+	}
+
+	ImGui::Dummy(ImVec2(width, row * (max_depth + 1)));
+}
+
+void ProfilerPanel::renderZoneTable(const Profiler::Frame& frame)
+{
+	ImGui::BeginTable("Zones", 3, ImGuiTableFlags_RowBg);
+	ImGui::TableSetupColumn("Zone");
+	ImGui::TableSetupColumn("CPU ms");
+	ImGui::TableSetupColumn("GPU ms");
+	ImGui::TableHeadersRow();
+
+	for (const auto& zone : frame.zones)
+	{
+		ImGui::TableNextRow();
+		ImGui::TableNextColumn();
+		ImGui::Text("%*s%s", zone.depth * 2, "", zone.name);
+		ImGui::TableNextColumn();
+		ImGui::Text("%.3f", zone.cpu_ms);
+		ImGui::TableNextColumn();
+		if (zone.gpu_ms >= 0.0) ImGui::Text("%.3f", zone.gpu_ms);
+		else ImGui::Text("-");
+	}
+
+	ImGui::EndTable();
+}
+#endif
@@ -0,0 +1,54 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const string& path) : m_data(nullptr), m_size(0)
+{
+#ifdef _WIN32
+	m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	m_mapping = nullptr;
+	if (m_file == INVALID_HANDLE_VALUE) return;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0) return;
+
+	m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (m_mapping == nullptr) return;
+
+	m_data = (const char*)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+	if (m_data != nullptr) m_size = size_t(size.QuadPart);
+#else
+	m_fd = open(path.c_str(), O_RDONLY);
+	if (m_fd < 0) return;
+
+	struct stat st;
+	if (fstat(m_fd, &st) != 0 || st.st_size == 0) return;
+
+	void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+	if (data == MAP_FAILED) return;
+
+	m_data = (const char*)data;
+	m_size = size_t(st.st_size);
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+	if (m_data != nullptr) UnmapViewOfFile(m_data);
+	if (m_mapping != nullptr) CloseHandle(m_mapping);
+	if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+#else
+	if (m_data != nullptr) munmap((void*)m_data, m_size);
+	if (m_fd >= 0) close(m_fd);
+#endif
+}
@@ -58,6 +58,13 @@ void Mesh::drawInstance()
 	m_buffer->unbind();
 }
 
+void Mesh::drawIndirect(GLintptr offset)
+{
+	m_buffer->bind();
+	glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)offset);
+	m_buffer->unbind();
+}
+
 void Mesh::drawTess(const Shader& shader, float res)
 {
 	m_material->loadMaterialToShader(shader);
@@ -65,7 +72,10 @@ void Mesh::drawTess(const Shader& shader, float res)
 	//glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
 	m_buffer->bind();
-	glDrawArrays(GL_PATCHES, 0, 4 * res * res);
+	if (m_buffer->getSizeOfIndices() > 0)
+		glDrawElements(GL_PATCHES, m_buffer->getSizeOfIndices(), GL_UNSIGNED_INT, nullptr);
+	else
+		glDrawArrays(GL_PATCHES, 0, 4 * res * res);
 	m_buffer->unbind();
 
 	//glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
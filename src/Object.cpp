@@ -3,6 +3,7 @@
 #include "glm/gtx/string_cast.hpp"
 
 #include "Buffer.h"
+#include "BVH.h"
 #include "Material.h"
 #include "MapManager.h"
 #include "MeshImporter.h"
@@ -115,6 +116,24 @@ void Object::addMesh(const shared_ptr<Mesh>& mesh)
 	computeBBox();
 }
 
+BVH* Object::getBVH()
+{
+	glm::mat4 M = m_transform.getModelTransform();
+
+	// The hierarchy is built once, moving the object only refits the bounds
+	if (m_bvh == nullptr)
+	{
+		m_bvh = make_shared<BVH>(getVertices(), getIndices());
+		m_bvh->refit(M);
+	}
+	else if (m_bvh->getTransform() != M)
+	{
+		m_bvh->refit(M);
+	}
+
+	return m_bvh.get();
+}
+
 void Object::calcTransform(const glm::vec3& forward)
 {
 	int final_x = 0;
@@ -5,10 +5,17 @@
 #include "Terrain.h"
 #include "Cloth.h"
 #include "SoftBodyObject.h"
+#include "SoftBodyWorld.h"
 
 ObjectManager::ObjectManager() :
 	m_objects({})
-{}
+{
+	m_soft_world = make_unique<SoftBodyWorld>();
+}
+
+ObjectManager::~ObjectManager()
+{
+}
 
 ObjectManager* ObjectManager::getObjectManager()
 {
@@ -209,12 +216,90 @@ void ObjectManager::drawObjects(
 	glm::vec3& view_pos,
 	const Light& light)
 {
+	updateClothColliders();
+	updateTerrainColliders();
+	updateSoftBodies();
+
 	for (int i = 0; i < m_objects.size(); ++i)
 	{
 		m_objects.at(i)->draw(P, V, view_pos, light);
 	}
 }
 
+void ObjectManager::updateClothColliders()
+{
+	if (m_clothes.empty()) return;
+
+	vector<shared_ptr<Object>> colliders;
+	for (int i = 0; i < m_objects.size(); ++i)
+	{
+		if (m_objects.at(i)->getIsCollider())
+		{
+			colliders.push_back(m_objects.at(i));
+		}
+	}
+
+	for (const auto& it : m_clothes)
+	{
+		if (it.lock())
+		{
+			it.lock()->setColliders(colliders);
+		}
+	}
+}
+
+void ObjectManager::updateTerrainColliders()
+{
+	// Cloth, soft bodies and fluids collide with the heightfield of every terrain
+	vector<shared_ptr<Terrain>> terrains;
+	for (const auto& it : m_terrains)
+	{
+		if (it.lock())
+		{
+			terrains.push_back(it.lock());
+		}
+	}
+
+	for (const auto& it : m_clothes)
+	{
+		if (it.lock())
+		{
+			it.lock()->setTerrains(terrains);
+		}
+	}
+
+	for (const auto& it : m_fluids)
+	{
+		if (it.lock())
+		{
+			it.lock()->setTerrains(terrains);
+		}
+	}
+
+	m_soft_world->setTerrains(terrains);
+}
+
+void ObjectManager::updateSoftBodies()
+{
+	// Bodies join the world once their tet mesh is ready, all of them are solved in one step
+	for (const auto& it : m_softs)
+	{
+		if (it.lock() && it.lock()->getBody())
+		{
+			m_soft_world->addBody(it.lock()->getBody());
+		}
+	}
+
+	m_softs.erase(
+		remove_if(m_softs.begin(), m_softs.end(),
+			[](const weak_ptr<SoftBodyObject>& soft) {return soft.expired(); }
+		),
+		m_softs.end()
+	);
+
+	m_soft_world->step();
+}
+
 void ObjectManager::drawObjectsMesh(const glm::mat4& P, const glm::mat4& V, const Shader& shader)
 {
 	for (int i = 0; i < m_objects.size(); ++i)
@@ -14,7 +14,7 @@ FluidParticle::FluidParticle(glm::vec3 p) :
 }
 
 ClothParticle::ClothParticle(glm::vec3 p) :
-	Particle(p), m_next(nullptr), m_ids({}), m_pinned(false) , m_mass(1.0f)
+	Particle(p), m_pinned(false) , m_mass(1.0f)
 {
 }
 
@@ -0,0 +1,201 @@
+#include "Profiler.h"
+
+#if PROFILING
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+// The frame being recorded and two frames in flight, fewer sets would wait on the GPU most frames
+static const int QUERY_SETS = 3;
+static const int MAX_HISTORY = 240;
+
+Profiler::Profiler() :
+	m_epoch(chrono::steady_clock::now()), m_frame_index(1), m_depth(0),
+	m_is_gpu_open(false), m_is_paused(false)
+{
+	m_current.index = 0;
+	m_current.start = 0.0;
+	m_current.cpu_ms = 0.0;
+	m_current.num_queries = 0;
+
+	m_queries.resize(QUERY_SETS);
+}
+
+Profiler::~Profiler()
+{
+	for (auto& set : m_queries)
+	{
+		if (!set.empty()) glDeleteQueries(GLsizei(set.size()), set.data());
+	}
+}
+
+Profiler* Profiler::getProfiler()
+{
+	if (m_profiler == nullptr)
+	{
+		m_profiler = unique_ptr<Profiler>(new Profiler());
+	}
+
+	return m_profiler.get();
+}
+
+double Profiler::getTime() const
+{
+	return chrono::duration<double, milli>(chrono::steady_clock::now() - m_epoch).count();
+}
+
+void Profiler::beginFrame()
+{
+	// A GPU zone left open would break every query after it
+	if (m_is_gpu_open)
+	{
+		glEndQuery(GL_TIME_ELAPSED);
+		m_is_gpu_open = false;
+	}
+
+	double now = getTime();
+	m_current.cpu_ms = now - m_current.start;
+	if (!m_current.zones.empty()) m_pending.push_back(move(m_current));
+
+	// Read back every frame whose queries are done, wait only when the next frame needs the oldest set
+	while (!m_pending.empty())
+	{
+		bool wait = int(m_pending.size()) >= QUERY_SETS;
+		if (!readQueries(m_pending.front(), wait)) break;
+
+		if (!m_is_paused)
+		{
+			m_history.push_back(move(m_pending.front()));
+			if (int(m_history.size()) > MAX_HISTORY) m_history.pop_front();
+		}
+		m_pending.pop_front();
+	}
+
+	m_current = Frame();
+	m_current.index = m_frame_index++;
+	m_current.start = now;
+	m_current.cpu_ms = 0.0;
+	m_current.num_queries = 0;
+	m_depth = 0;
+}
+
+int Profiler::beginZone(const char* name, bool is_gpu)
+{
+	Zone zone = { name, m_depth, getTime(), 0.0, -1.0, -1 };
+
+	if (is_gpu && !m_is_gpu_open)
+	{
+		vector<GLuint>& set = m_queries[m_current.index % QUERY_SETS];
+		if (m_current.num_queries == int(set.size()))
+		{
+			GLuint query;
+			glGenQueries(1, &query);
+			set.push_back(query);
+		}
+
+		zone.query = m_current.num_queries++;
+		glBeginQuery(GL_TIME_ELAPSED, set[zone.query]);
+		m_is_gpu_open = true;
+	}
+
+	m_depth++;
+	m_current.zones.push_back(zone);
+	return int(m_current.zones.size()) - 1;
+}
+
+void Profiler::endZone(int zone)
+{
+	// Zone opened before the frame was closed
+	if (zone >= int(m_current.zones.size())) return;
+
+	Zone& z = m_current.zones[zone];
+	z.cpu_ms = getTime() - z.cpu_start;
+
+	if (z.query >= 0 && m_is_gpu_open)
+	{
+		glEndQuery(GL_TIME_ELAPSED);
+		m_is_gpu_open = false;
+	}
+
+	m_depth = z.depth;
+}
+
+bool Profiler::readQueries(Frame& frame, bool wait)
+{
+	if (frame.num_queries == 0) return true;
+
+	const vector<GLuint>& set = m_queries[frame.index % QUERY_SETS];
+
+	// Queries finish in order, the last one being available means they all are
+	if (!wait)
+	{
+		GLint available = 0;
+		glGetQueryObjectiv(set[frame.num_queries - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available) return false;
+	}
+
+	for (auto& zone : frame.zones)
+	{
+		if (zone.query < 0) continue;
+
+		GLuint64 ns = 0;
+		glGetQueryObjectui64v(set[zone.query], GL_QUERY_RESULT, &ns);
+		zone.gpu_ms = double(ns) * 1e-6;
+	}
+
+	return true;
+}
+
+static void writeEvent(ofstream& file, const char* name, int tid, double start_ms, double dur_ms)
+{
+	file << ",\n{\"name\":\"" << name << "\",\"cat\":\"" << (tid == 1 ? "cpu" : "gpu")
+		<< "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+		<< ",\"ts\":" << start_ms * 1000.0 << ",\"dur\":" << dur_ms * 1000.0 << "}";
+}
+
+bool Profiler::writeTrace(const string& path) const
+{
+	error_code ec;
+	filesystem::path parent = filesystem::path(path).parent_path();
+	if (!parent.empty()) filesystem::create_directories(parent, ec);
+
+	ofstream file(path, ios::trunc);
+	if (!file)
+	{
+		cout << "Failed to write profiler trace " << path << endl;
+		return false;
+	}
+
+	file.setf(ios::fixed);
+	file.precision(3);
+
+	file << "{\"traceEvents\":[\n";
+	file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n";
+	file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+
+	double gpu_end = 0.0;
+	for (const auto& frame : m_history)
+	{
+		for (const auto& zone : frame.zones)
+		{
+			writeEvent(file, zone.name, 1, zone.cpu_start, zone.cpu_ms);
+
+			// Only the GPU durations are known, passes start with their CPU zone unless the last one is still running
+			if (zone.gpu_ms >= 0.0)
+			{
+				double start = max(zone.cpu_start, gpu_end);
+				writeEvent(file, zone.name, 2, start, zone.gpu_ms);
+				gpu_end = start + zone.gpu_ms;
+			}
+		}
+	}
+
+	file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+	cout << "Profiler trace of " << m_history.size() << " frames written to " << path << endl;
+	return true;
+}
+
+#endif // PROFILING
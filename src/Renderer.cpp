@@ -12,11 +12,15 @@
 #include "Gizmo.h"
 #include "Grid.h"
 #include "ImGuiManager.h"
+#include "Profiler.h"
 
 unique_ptr<Quad> Quad::m_quad = nullptr;
 unique_ptr<ImGuiManager> ImGuiManager::m_manager = nullptr;
 unique_ptr<ObjectManager> ObjectManager::m_object_manager = nullptr;
 unique_ptr<MapManager> MapManager::m_manager = nullptr;
+#if PROFILING
+unique_ptr<Profiler> Profiler::m_profiler = nullptr;
+#endif
 
 Renderer::Renderer() :
 	m_click_object(nullptr),
@@ -87,6 +91,9 @@ void Renderer::run()
 
 void Renderer::render()
 {
+	PROFILE_FRAME();
+	PROFILE_SCOPE("Frame");
+
 	float current_frame = (float)SDL_GetTicks() * 0.001f;
 	float last_frame = m_camera->getLastFrame();
 	m_camera->setDeltaTime(current_frame - last_frame);
@@ -95,12 +102,19 @@ void Renderer::render()
 
 	ObjectManager::getObjectManager()->resetObjects();
 
-	MapManager::getManager()->setupShadowMap();
+	{
+		PROFILE_GPU_SCOPE("Shadow Map");
+		MapManager::getManager()->setupShadowMap();
+	}
 
-	handleInput();
+	{
+		PROFILE_SCOPE("Input");
+		handleInput();
+	}
 
 	renderImGui();
 
+	PROFILE_SCOPE("Swap");
 	m_sdl_window->swapWindow();
 }
 
@@ -264,11 +278,14 @@ void Renderer::renderImGui()
 	bool demo = true;
 	ImGui::ShowDemoWindow(&demo);
 
-	ImGuiManager::getImGuiManager()->drawMainMenu(m_scene_collections, m_click_object);
+	{
+		PROFILE_SCOPE("ImGui Panels");
+		ImGuiManager::getImGuiManager()->drawMainMenu(m_scene_collections, m_click_object);
 
-	ImGuiManager::getImGuiManager()->drawButtons();
+		ImGuiManager::getImGuiManager()->drawButtons();
 
-	ImGuiManager::getImGuiManager()->drawPanels(m_scene_collections, m_click_object);
+		ImGuiManager::getImGuiManager()->drawPanels(m_scene_collections, m_click_object);
+	}
 
 	bool open = true;
 	ImGui::Begin("Scenes", &open);
@@ -299,21 +316,36 @@ void Renderer::renderImGui()
 			const glm::mat4 V = m_camera->getV();
 
 			// setup Depth map
-			MapManager::getManager()->setupDepthMap(SP, V);
+			{
+				PROFILE_GPU_SCOPE("Depth Map");
+				MapManager::getManager()->setupDepthMap(SP, V);
+			}
 
-			ObjectManager::getObjectManager()->setupFluidsFramebuffer(SP, P, V);
+			{
+				PROFILE_GPU_SCOPE("Fluid Passes");
+				ObjectManager::getObjectManager()->setupFluidsFramebuffer(SP, P, V);
+			}
 
-			if (m_click_object != nullptr) m_outline->setupBuffers(*m_click_object, V, wsize.x, wsize.y);
-			else m_outline->clearOutlineFrame();
+			{
+				PROFILE_GPU_SCOPE("Outline JFA");
+				if (m_click_object != nullptr) m_outline->setupBuffers(*m_click_object, V, wsize.x, wsize.y);
+				else m_outline->clearOutlineFrame();
+			}
 
-			m_framebuffer_multi->bind();
-			m_sdl_window->clearWindow();
-			renderScene();
+			{
+				PROFILE_GPU_SCOPE("Scene");
+				m_framebuffer_multi->bind();
+				m_sdl_window->clearWindow();
+				renderScene();
+			}
 
-			m_framebuffer_multi->bindRead();
-			m_scene->bindDraw();
-			glBlitFramebuffer(0, 0, m_framebuffer_multi->getWidth(), m_framebuffer_multi->getHeight(),
-				0, 0, m_scene->getWidth(), m_scene->getHeight(), GL_COLOR_BUFFER_BIT, GL_NEAREST);
+			{
+				PROFILE_GPU_SCOPE("MSAA Blit");
+				m_framebuffer_multi->bindRead();
+				m_scene->bindDraw();
+				glBlitFramebuffer(0, 0, m_framebuffer_multi->getWidth(), m_framebuffer_multi->getHeight(),
+					0, 0, m_scene->getWidth(), m_scene->getHeight(), GL_COLOR_BUFFER_BIT, GL_NEAREST);
+			}
 			
 			m_framebuffer_multi->unbind();
 
@@ -325,7 +357,10 @@ void Renderer::renderImGui()
 
 	// ImGui docking
 	ImGui::Render();
-	ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+	{
+		PROFILE_GPU_SCOPE("ImGui Render");
+		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+	}
 	if (ImGui::GetIO().ConfigFlags & ImGuiConfigFlags_ViewportsEnable)
 	{
 		SDL_GLContext backup_current_context = SDL_GL_GetCurrentContext();
@@ -370,15 +405,29 @@ void Renderer::renderScene()
 
 	ObjectManager::getObjectManager()->setSimulation(ImGuiManager::getImGuiManager()->getIsSimulate());
 
-	ObjectManager::getObjectManager()->drawObjects(P, V, ray_pos, *m_lights.at(0));
+	{
+		PROFILE_SCOPE("Objects");
+		ObjectManager::getObjectManager()->drawObjects(P, V, ray_pos, *m_lights.at(0));
+	}
 
-	MapManager::getManager()->drawCubeMap(P, V);
+	{
+		PROFILE_SCOPE("Cube Map");
+		MapManager::getManager()->drawCubeMap(P, V);
+	}
 
 	// Draw Grid
-	m_grid->draw(P, V, ray_pos);
+	{
+		PROFILE_SCOPE("Grid");
+		m_grid->draw(P, V, ray_pos);
+	}
 
 	// Draw Outline
-	m_outline->draw(*m_click_object);
+	{
+		PROFILE_SCOPE("Outline");
+		m_outline->draw(*m_click_object);
+	}
+
+	PROFILE_SCOPE("Gizmos");
 
 	if (!ImGuiManager::getImGuiManager()->getIsSimulate())
 	{
@@ -0,0 +1,352 @@
+#include "SDFBaker.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+#include "Parallel.h"
+
+// Reference : Real-Time Collision Detection, Christer Ericson, 5.1.5
+static glm::vec3 closestPointTriangle(
+	const glm::vec3& p, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+{
+	glm::vec3 ab = b - a;
+	glm::vec3 ac = c - a;
+	glm::vec3 ap = p - a;
+
+	float d1 = glm::dot(ab, ap);
+	float d2 = glm::dot(ac, ap);
+	if (d1 <= 0.0f && d2 <= 0.0f) return a;
+
+	glm::vec3 bp = p - b;
+	float d3 = glm::dot(ab, bp);
+	float d4 = glm::dot(ac, bp);
+	if (d3 >= 0.0f && d4 <= d3) return b;
+
+	float vc = d1 * d4 - d3 * d2;
+	if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+	{
+		float v = d1 / (d1 - d3);
+		return a + v * ab;
+	}
+
+	glm::vec3 cp = p - c;
+	float d5 = glm::dot(ab, cp);
+	float d6 = glm::dot(ac, cp);
+	if (d6 >= 0.0f && d5 <= d6) return c;
+
+	float vb = d5 * d2 - d1 * d6;
+	if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+	{
+		float w = d2 / (d2 - d6);
+		return a + w * ac;
+	}
+
+	float va = d3 * d6 - d5 * d4;
+	if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+	{
+		float w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+		return b + w * (c - b);
+	}
+
+	float denom = 1.0f / (va + vb + vc);
+	float v = vb * denom;
+	float w = vc * denom;
+	return a + ab * v + ac * w;
+}
+
+// Twice the signed area of (p, a, b) in the yz plane
+static float orientation(const glm::vec2& p, const glm::vec2& a, const glm::vec2& b)
+{
+	return (a.x - p.x) * (b.y - p.y) - (a.y - p.y) * (b.x - p.x);
+}
+
+// Top left fill rule on the edge e of a counter clockwise triangle, w is the edge function of the point
+static bool isCovered(float w, const glm::vec2& e)
+{
+	if (w != 0.0f) return w > 0.0f;
+	return e.y > 0.0f || (e.y == 0.0f && e.x < 0.0f);
+}
+
+SDFBaker::SDFBaker(const glm::vec3& origin, float dx, int ni, int nj, int nk, int exact_band) :
+	m_vertices(nullptr), m_tris(nullptr),
+	m_origin(origin), m_dx(dx), m_ni(ni), m_nj(nj), m_nk(nk), m_exact_band(exact_band)
+{}
+
+float SDFBaker::distanceToTri(const glm::vec3& p, int t) const
+{
+	const glm::ivec3& tri = (*m_tris)[t];
+	glm::vec3 q = closestPointTriangle(p, (*m_vertices)[tri.x], (*m_vertices)[tri.y], (*m_vertices)[tri.z]);
+	return glm::length(p - q);
+}
+
+void SDFBaker::bake(const vector<glm::vec3>& vertices, const vector<info::uint>& indices)
+{
+	vector<glm::ivec3> tris;
+	tris.reserve(indices.size() / 3);
+	for (int i = 0; i + 2 < indices.size(); i += 3)
+	{
+		tris.push_back(glm::ivec3(indices[i], indices[i + 1], indices[i + 2]));
+	}
+
+	bake(vertices, tris);
+}
+
+void SDFBaker::bake(const vector<glm::vec3>& vertices, const vector<glm::ivec3>& tris)
+{
+	m_vertices = &vertices;
+	m_tris = &tris;
+
+	int n = m_ni * m_nj * m_nk;
+	m_phi.assign(n, (m_ni + m_nj + m_nk) * m_dx);
+	m_closest_tri.assign(n, -1);
+	m_intersections.assign(n, 0);
+
+	// Bin the triangles by the k slices their band overlaps (CSR)
+	m_slice_start.assign(m_nk + 1, 0);
+	vector<glm::ivec2> tri_k(tris.size());
+	for (int t = 0; t < tris.size(); ++t)
+	{
+		float z_min = min((vertices[tris[t].x].z), min(vertices[tris[t].y].z, vertices[tris[t].z].z));
+		float z_max = max((vertices[tris[t].x].z), max(vertices[tris[t].y].z, vertices[tris[t].z].z));
+		int k0 = glm::clamp(int(floor((z_min - m_origin.z) / m_dx)) - m_exact_band, 0, m_nk - 1);
+		int k1 = glm::clamp(int(ceil((z_max - m_origin.z) / m_dx)) + m_exact_band, 0, m_nk - 1);
+		tri_k[t] = glm::ivec2(k0, k1);
+
+		for (int k = k0; k <= k1; ++k) m_slice_start[k + 1]++;
+	}
+
+	for (int k = 0; k < m_nk; ++k)
+	{
+		m_slice_start[k + 1] += m_slice_start[k];
+	}
+
+	m_slice_tris.resize(m_slice_start[m_nk]);
+	vector<int> fill = m_slice_start;
+	for (int t = 0; t < tris.size(); ++t)
+	{
+		for (int k = tri_k[t].x; k <= tri_k[t].y; ++k) m_slice_tris[fill[k]++] = t;
+	}
+
+	computeNarrowBand();
+
+	// Propagate the closest triangle outwards, two rounds along every axis
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			sweep(axis, 1);
+			sweep(axis, -1);
+		}
+	}
+
+	computeSign();
+
+	m_vertices = nullptr;
+	m_tris = nullptr;
+}
+
+void SDFBaker::computeNarrowBand()
+{
+	parallel::forEach(m_nk, [&](int k)
+		{
+			for (int s = m_slice_start[k]; s < m_slice_start[k + 1]; ++s)
+			{
+				int t = m_slice_tris[s];
+				const glm::ivec3& tri = (*m_tris)[t];
+				glm::vec3 a = (*m_vertices)[tri.x];
+				glm::vec3 b = (*m_vertices)[tri.y];
+				glm::vec3 c = (*m_vertices)[tri.z];
+
+				glm::vec3 f_min = (glm::min(a, glm::min(b, c)) - m_origin) / m_dx;
+				glm::vec3 f_max = (glm::max(a, glm::max(b, c)) - m_origin) / m_dx;
+				int i0 = glm::clamp(int(floor(f_min.x)) - m_exact_band, 0, m_ni - 1);
+				int i1 = glm::clamp(int(ceil(f_max.x)) + m_exact_band, 0, m_ni - 1);
+				int j0 = glm::clamp(int(floor(f_min.y)) - m_exact_band, 0, m_nj - 1);
+				int j1 = glm::clamp(int(ceil(f_max.y)) + m_exact_band, 0, m_nj - 1);
+
+				for (int j = j0; j <= j1; ++j)
+				{
+					for (int i = i0; i <= i1; ++i)
+					{
+						glm::vec3 p = m_origin + glm::vec3(i, j, k) * m_dx;
+						float d = distanceToTri(p, t);
+						int idx = getIndex(i, j, k);
+						if (d < m_phi[idx])
+						{
+							m_phi[idx] = d;
+							m_closest_tri[idx] = t;
+						}
+					}
+				}
+			}
+		});
+}
+
+void SDFBaker::sweep(int axis, int dir)
+{
+	// Every grid line along the axis is independent of the others
+	glm::ivec3 size(m_ni, m_nj, m_nk);
+	int u_axis = (axis + 1) % 3;
+	int v_axis = (axis + 2) % 3;
+	int n_lines = size[u_axis] * size[v_axis];
+	int n = size[axis];
+
+	parallel::forEach(n_lines, [&](int line)
+		{
+			glm::ivec3 cell;
+			cell[u_axis] = line % size[u_axis];
+			cell[v_axis] = line / size[u_axis];
+
+			int begin = dir > 0 ? 1 : n - 2;
+			for (int s = begin; s >= 0 && s < n; s += dir)
+			{
+				cell[axis] = s - dir;
+				int prev = getIndex(cell.x, cell.y, cell.z);
+				int t = m_closest_tri[prev];
+				if (t < 0) continue;
+
+				cell[axis] = s;
+				int idx = getIndex(cell.x, cell.y, cell.z);
+				if (m_closest_tri[idx] == t) continue;
+
+				glm::vec3 p = m_origin + glm::vec3(cell) * m_dx;
+				float d = distanceToTri(p, t);
+				if (d < m_phi[idx])
+				{
+					m_phi[idx] = d;
+					m_closest_tri[idx] = t;
+				}
+			}
+		});
+}
+
+void SDFBaker::computeSign()
+{
+	// Count crossings of the +x ray through every (j, k) grid line
+	parallel::forEach(m_nk, [&](int k)
+		{
+			float z = m_origin.z + k * m_dx;
+
+			for (int s = m_slice_start[k]; s < m_slice_start[k + 1]; ++s)
+			{
+				const glm::ivec3& tri = (*m_tris)[m_slice_tris[s]];
+				glm::vec3 a = (*m_vertices)[tri.x];
+				glm::vec3 b = (*m_vertices)[tri.y];
+				glm::vec3 c = (*m_vertices)[tri.z];
+
+				glm::vec2 a2(a.y, a.z);
+				glm::vec2 b2(b.y, b.z);
+				glm::vec2 c2(c.y, c.z);
+
+				float y_min = min(a.y, min(b.y, c.y));
+				float y_max = max(a.y, max(b.y, c.y));
+				int j0 = max(0, int(ceil((y_min - m_origin.y) / m_dx)));
+				int j1 = min(m_nj - 1, int(floor((y_max - m_origin.y) / m_dx)));
+
+				for (int j = j0; j <= j1; ++j)
+				{
+					glm::vec2 p(m_origin.y + j * m_dx, z);
+					float w_a = orientation(p, b2, c2);
+					float w_b = orientation(p, c2, a2);
+					float w_c = orientation(p, a2, b2);
+
+					float sum = w_a + w_b + w_c;
+					if (sum == 0.0f) continue;
+
+					// Grid lines through a shared edge or vertex must hit exactly one of the triangles
+					float sign = sum > 0.0f ? 1.0f : -1.0f;
+					if (!isCovered(sign * w_a, sign * (c2 - b2)) ||
+						!isCovered(sign * w_b, sign * (a2 - c2)) ||
+						!isCovered(sign * w_c, sign * (b2 - a2))) continue;
+
+					float x = (w_a * a.x + w_b * b.x + w_c * c.x) / sum;
+					int i = max(0, int(ceil((x - m_origin.x) / m_dx)));
+					if (i < m_ni)
+					{
+						m_intersections[getIndex(i, j, k)]++;
+					}
+				}
+			}
+		});
+
+	// Odd number of crossings before a cell means it is inside
+	parallel::forEach(m_nj * m_nk, [&](int line)
+		{
+			int j = line % m_nj;
+			int k = line / m_nj;
+			int count = 0;
+			for (int i = 0; i < m_ni; ++i)
+			{
+				int idx = getIndex(i, j, k);
+				count += m_intersections[idx];
+				if (count % 2 == 1) m_phi[idx] = -m_phi[idx];
+			}
+		});
+}
+
+float SDFBaker::sample(const glm::vec3& pos) const
+{
+	glm::vec3 f = (pos - m_origin) / m_dx;
+	f = glm::clamp(f, glm::vec3(0.0f), glm::vec3(m_ni - 1, m_nj - 1, m_nk - 1) - 0.0001f);
+
+	glm::ivec3 c = glm::ivec3(glm::floor(f));
+	glm::vec3 t = f - glm::vec3(c);
+	int i1 = min(c.x + 1, m_ni - 1);
+	int j1 = min(c.y + 1, m_nj - 1);
+	int k1 = min(c.z + 1, m_nk - 1);
+
+	float c00 = glm::mix(getPhi(c.x, c.y, c.z), getPhi(i1, c.y, c.z), t.x);
+	float c10 = glm::mix(getPhi(c.x, j1, c.z), getPhi(i1, j1, c.z), t.x);
+	float c01 = glm::mix(getPhi(c.x, c.y, k1), getPhi(i1, c.y, k1), t.x);
+	float c11 = glm::mix(getPhi(c.x, j1, k1), getPhi(i1, j1, k1), t.x);
+
+	return glm::mix(glm::mix(c00, c10, t.y), glm::mix(c01, c11, t.y), t.z);
+}
+
+glm::vec3 SDFBaker::gradient(const glm::vec3& pos) const
+{
+	float h = 0.5f * m_dx;
+	glm::vec3 g;
+	g.x = sample(pos + glm::vec3(h, 0.0f, 0.0f)) - sample(pos - glm::vec3(h, 0.0f, 0.0f));
+	g.y = sample(pos + glm::vec3(0.0f, h, 0.0f)) - sample(pos - glm::vec3(0.0f, h, 0.0f));
+	g.z = sample(pos + glm::vec3(0.0f, 0.0f, h)) - sample(pos - glm::vec3(0.0f, 0.0f, h));
+
+	float len = glm::length(g);
+	return len > 0.0f ? g / len : glm::vec3(0.0f);
+}
+
+void SDFBaker::benchmark(
+	const vector<glm::vec3>& vertices, const vector<info::uint>& indices,
+	const glm::vec3& b_min, const glm::vec3& b_max)
+{
+	cout << endl;
+	cout << "*************************SDF Benchmark**************************" << endl;
+	cout << "Triangles : " << indices.size() / 3 << endl;
+
+	glm::vec3 size = b_max - b_min;
+	float extent = max(size.x, max(size.y, size.z));
+
+	for (int res : { 32, 64, 128, 256 })
+	{
+		float dx = extent / res;
+		glm::vec3 origin = b_min - glm::vec3(2.0f * dx);
+		int ni = int(ceil(size.x / dx)) + 5;
+		int nj = int(ceil(size.y / dx)) + 5;
+		int nk = int(ceil(size.z / dx)) + 5;
+
+		SDFBaker baker(origin, dx, ni, nj, nk);
+
+		auto start = chrono::high_resolution_clock::now();
+		baker.bake(vertices, indices);
+		auto end = chrono::high_resolution_clock::now();
+
+		double ms = chrono::duration<double, milli>(end - start).count();
+		cout << "Grid " << ni << "x" << nj << "x" << nk << " : " << ms << " ms, "
+			 << (double(ni) * nj * nk / ms / 1000.0) << " M cells/s" << endl;
+	}
+
+	cout << "********************************end*********************************" << endl;
+	cout << endl;
+}
@@ -2,6 +2,7 @@
 
 int n_blocks;
 int n_threads;
+int n_terrain = 0;
 
 __device__ glm::ivec3 getHashPos_kernel(const glm::vec3& pos)
 {
@@ -79,6 +80,34 @@ cudaError_t setHash(vector<int>& hash, vector<int>& neighbors)
 	return cuda_status;
 }
 
+cudaError_t setTerrain(const vector<glm::vec4>& samples)
+{
+	cudaError_t cuda_status = cudaSuccess;
+	if (n_terrain != int(samples.size()))
+	{
+		cudaFree(d_terrain);
+		n_terrain = 0;
+
+		cuda_status = cudaMalloc((void**)&d_terrain, sizeof(glm::vec4) * samples.size());
+		if (cuda_status != cudaSuccess)
+		{
+			cout << "cudaMalloc failed in setTerrain" << endl;
+			return cuda_status;
+		}
+
+		n_terrain = int(samples.size());
+	}
+
+	cuda_status = cudaMemcpy(d_terrain, &samples[0], sizeof(glm::vec4) * samples.size(), cudaMemcpyHostToDevice);
+	if (cuda_status != cudaSuccess)
+	{
+		cout << "cudaMemcpy failed in setTerrain" << endl;
+		return cuda_status;
+	}
+
+	return cuda_status;
+}
+
 cudaError_t copyToCuda(
 	int n,
 	vector<glm::vec3>& pos, 
@@ -213,7 +242,7 @@ cudaError_t simulateCuda(int n, float t, vector<glm::vec3>& pos)
 		return cuda_status;
 	}
 
-	updatePosition_kernel << <n_blocks, n_threads >> > (n, d_pos, d_velocity, d_force, d_density);
+	updatePosition_kernel << <n_blocks, n_threads >> > (n, d_pos, d_velocity, d_force, d_density, d_terrain);
 	cuda_status = cudaDeviceSynchronize();
 	if (cuda_status != cudaSuccess) {
 		cout << "cudaDeviceSynchronize returned error code after udpate position!: " << cuda_status << endl;
@@ -234,6 +263,20 @@ cudaError_t simulateCuda(int n, float t, vector<glm::vec3>& pos)
 	return cuda_status;
 }
 
+cudaError_t copyVelocityFromCuda(int n, vector<glm::vec3>& h_vel)
+{
+	cudaError_t cuda_status;
+
+	cuda_status = cudaMemcpy(&h_vel[0], d_velocity, n * sizeof(glm::vec3), cudaMemcpyDeviceToHost);
+	if (cuda_status != cudaSuccess)
+	{
+		cout << "cudaMemcpy failed in copyVelocityFromCuda " << cuda_status << endl;
+		return cuda_status;
+	}
+
+	return cuda_status;
+}
+
 cudaError_t freeResources()
 {
 	//cudaFree(&d_params);
@@ -244,6 +287,8 @@ cudaError_t freeResources()
 	cudaFree(d_force);
 	cudaFree(d_density);
 	cudaFree(d_pressure);
+	cudaFree(d_terrain);
+	n_terrain = 0;
 
 	cudaError_t cuda_status;
 	cuda_status = cudaDeviceSynchronize();
@@ -363,7 +408,8 @@ __global__ void updatePosition_kernel(
 	glm::vec3* pos,
 	glm::vec3* vel,
 	glm::vec3* force,
-	float* density)
+	float* density,
+	glm::vec4* terrain)
 {
 	int i = blockIdx.x * blockDim.x + threadIdx.x;
 	if (i >= n) return;
@@ -403,6 +449,34 @@ __global__ void updatePosition_kernel(
 		vel[i].z *= d_params.WALL;
 		pos[i].z = d_params.H + d_params.min_box.z;
 	}
+
+	if (d_params.terrain_res > 0)
+	{
+		// Bilinear over the sampled terrain, particles bounce off it like off the walls along its normal
+		int res = d_params.terrain_res;
+		glm::vec2 g = (glm::vec2(pos[i].x, pos[i].z) - d_params.terrain_min) / d_params.terrain_cell;
+		g = glm::clamp(g, glm::vec2(0.0f), glm::vec2(float(res - 1)));
+		int x = min(int(g.x), res - 2);
+		int z = min(int(g.y), res - 2);
+		float u = g.x - float(x);
+		float v = g.y - float(z);
+
+		glm::vec4* s = terrain + x + res * z;
+		glm::vec4 sample = glm::mix(glm::mix(s[0], s[1], u), glm::mix(s[res], s[res + 1], u), v);
+		glm::vec3 normal = glm::normalize(glm::vec3(sample));
+
+		float d = (pos[i].y - sample.w) * normal.y;
+		if (d < d_params.H)
+		{
+			pos[i] += normal * (d_params.H - d);
+
+			// Never out of the box the walls clamped to
+			pos[i] = glm::clamp(pos[i], d_params.min_box + d_params.H, d_params.max_box - d_params.H);
+
+			float v_n = glm::dot(vel[i], normal);
+			if (v_n < 0.0f) vel[i] -= (1.0f - d_params.WALL) * v_n * normal;
+		}
+	}
 }
 
 __global__ void fillHash_kernel(
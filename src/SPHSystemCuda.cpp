@@ -6,6 +6,14 @@
 #include "ShaderManager.h"
 #include "Particle.h"
 #include "Quad.h"
+#include "SimValidator.h"
+#include "Terrain.h"
+
+namespace
+{
+	// Terrain samples along each side of the box
+	const int TERRAIN_RES = 64;
+}
 
 SPHSystemCuda::SPHSystemCuda(float width, float height, float depth) : Object("FluidGPU")
 {
@@ -24,6 +32,7 @@ SPHSystemCuda::SPHSystemCuda(float width, float height, float depth) : Object("F
 	m_params.WALL = -0.5f;
 	m_params.SCALE = 1.1f;
 	m_params.max_num_neighbors = 5;
+	m_params.terrain_res = 0;
 
 	m_simulation = false;
 	m_grid_width = width;
@@ -36,6 +45,10 @@ SPHSystemCuda::SPHSystemCuda(float width, float height, float depth) : Object("F
 	render_type = 1;
 	iteration = 1;
 
+	m_validator = make_unique<SimValidator>("fluid");
+	m_validator->watch("positions", &m_validation_pos);
+	m_validator->watch("velocities", &m_validation_vel);
+
 	initFramebuffer();
 	initShader();
 	initParticle();
@@ -303,11 +316,16 @@ void SPHSystemCuda::simulate()
 
 	m_params.t = t;
 
+	updateTerrain();
 	setParams(&m_params);
 
 	vector<glm::vec3> new_pos(m_particles.size());
 	simulateCuda(m_particles.size(), t, new_pos);
 
+#if SIM_VALIDATION
+	validate(new_pos);
+#endif
+
 	// Update positions in a vertex buffer
 	vector<info::VertexLayout> layouts = m_point->getMesh().getBuffer().getLayouts();
 	for (int i = 0; i < m_particles.size(); ++i)
@@ -326,6 +344,88 @@ void SPHSystemCuda::simulate()
 	setHash(m_hash, m_neighbors);
 }
 
+void SPHSystemCuda::updateTerrain()
+{
+	m_params.terrain_res = 0;
+	if (m_terrains.empty()) return;
+
+	// Grid over the box at its top, samples without terrain rest on the floor of the box
+	int res = TERRAIN_RES;
+	glm::vec2 b_min(m_params.min_box.x, m_params.min_box.z);
+	glm::vec2 cell = (glm::vec2(m_params.max_box.x, m_params.max_box.z) - b_min) / float(res - 1);
+
+	m_terrain_pos.resize(res * res);
+	for (int z = 0; z < res; ++z)
+	{
+		for (int x = 0; x < res; ++x)
+		{
+			m_terrain_pos[x + res * z] = glm::vec3(b_min.x + x * cell.x, m_params.max_box.y, b_min.y + z * cell.y);
+		}
+	}
+
+	m_terrain_samples.assign(res * res, glm::vec4(0.0f, 1.0f, 0.0f, m_params.min_box.y));
+	for (auto& terrain : m_terrains)
+	{
+		terrain->getSurfaces(m_terrain_pos, m_terrain_heights, m_terrain_normals);
+		for (int i = 0; i < res * res; ++i)
+		{
+			if (m_terrain_heights[i] > m_terrain_samples[i].w)
+				m_terrain_samples[i] = glm::vec4(m_terrain_normals[i], m_terrain_heights[i]);
+		}
+	}
+
+	// Terrain above the box would lift particles out of its top, particles rest H above a sample
+	float max_height = m_params.max_box.y - 2.0f * m_params.H;
+	for (auto& sample : m_terrain_samples)
+	{
+		sample.w = min(sample.w, max_height);
+	}
+
+	if (setTerrain(m_terrain_samples) != cudaSuccess) return;
+
+	m_params.terrain_min = b_min;
+	m_params.terrain_cell = cell;
+	m_params.terrain_res = res;
+}
+
+void SPHSystemCuda::validate(const vector<glm::vec3>& new_pos)
+{
+	int n = int(new_pos.size());
+	m_validation_pos = new_pos;
+
+	// The solver's own velocities, positions jump on Reset and when the walls move with the box
+	m_validation_vel.resize(n);
+	if (n > 0 && copyVelocityFromCuda(n, m_validation_vel) != cudaSuccess) return;
+
+	float energy = 0.0f;
+	for (int i = 0; i < n; ++i)
+	{
+		energy += 0.5f * glm::dot(m_validation_vel[i], m_validation_vel[i]);
+	}
+
+	m_validator->beginStep();
+	m_validator->setParam("t", t);
+	m_validator->setParam("H", m_params.H);
+	m_validator->setParam("K", m_params.K);
+	m_validator->setParam("rDENSITY", m_params.rDENSITY);
+	m_validator->setParam("VISC", m_params.VISC);
+
+	m_validator->checkFinite(m_validation_pos, "position");
+	m_validator->checkFinite(m_validation_vel, "velocity");
+	m_validator->checkEnergy(energy / max(1, n));
+
+	// The kernel clamps particles to the box shrunk by H, anything further out escaped the boundary
+	float outside = 0.0f;
+	for (int i = 0; i < n; ++i)
+	{
+		glm::vec3 below = m_params.min_box - new_pos[i];
+		glm::vec3 above = new_pos[i] - m_params.max_box;
+		outside = max(outside, max(max(below.x, below.y), below.z));
+		outside = max(outside, max(max(above.x, above.y), above.z));
+	}
+	m_validator->checkConstraint(outside, m_params.H, "Box boundary");
+}
+
 void SPHSystemCuda::draw(
 	const glm::mat4& P,
 	const glm::mat4& V,
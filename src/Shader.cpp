@@ -40,6 +40,11 @@ void Shader::setVec3(const string& name, float x, float y, float z) const
 	glUniform3f(glGetUniformLocation(m_shader_ID, name.c_str()), x, y, z);
 }
 
+void Shader::setVec4(const string& name, const glm::vec4& vector) const
+{
+	glUniform4fv(glGetUniformLocation(m_shader_ID, name.c_str()), 1, &vector[0]);
+}
+
 void Shader::setMat4(const string& name, const glm::mat4& matrix) const
 {
 	glUniformMatrix4fv(glGetUniformLocation(m_shader_ID, name.c_str()), 1, GL_FALSE, value_ptr(matrix));
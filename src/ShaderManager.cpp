@@ -7,7 +7,7 @@ unordered_map<string, shared_ptr <Shader>> ShaderManager::shader_cache;
 
 void ShaderManager::createShader(const string& name, const vector<string>& paths)
 {
-	shared_ptr<Shader> shader = compileShader(name, paths);
+	shared_ptr<Shader> shader = compileShader(name, paths, types);
 	if (shader == nullptr)
 	{
 		cout << "Failed to compile shader: " << name << endl;
@@ -21,7 +21,20 @@ void ShaderManager::createShader(const string& name, const vector<string>& paths
 	if (name == "Point") cout << shader_cache[name]->getShaderId() << endl;
 }
 
-shared_ptr<Shader> ShaderManager::compileShader(const string& name, const vector<string>& paths)
+void ShaderManager::createComputeShader(const string& name, const string& path)
+{
+	shared_ptr<Shader> shader = compileShader(name, { path }, { GL_COMPUTE_SHADER });
+	if (shader == nullptr)
+	{
+		cout << "Failed to compile shader: " << name << endl;
+		assert(0);
+	}
+
+	if (shader_cache.find(name) == shader_cache.end())
+		shader_cache[name] = shader;
+}
+
+shared_ptr<Shader> ShaderManager::compileShader(const string& name, const vector<string>& paths, const vector<GLenum>& shader_types)
 {
 	cout << "Load shader file: " << name << endl;
 
@@ -31,7 +44,7 @@ shared_ptr<Shader> ShaderManager::compileShader(const string& name, const vector
 
 	for (int i = 0; i < paths.size(); ++i)
 	{
-		if (!readShader(paths.at(i), types[i], shaders[i]))
+		if (!readShader(paths.at(i), shader_types[i], shaders[i]))
 			assert(0);
 	}
 
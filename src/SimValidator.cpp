@@ -0,0 +1,128 @@
+#include "SimValidator.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+SimValidator::SimValidator(const string& name) :
+	m_name(name), m_energy_avg(0.0f), m_step(0), m_has_failed(false)
+{
+}
+
+void SimValidator::watch(const string& name, const vector<glm::vec3>* values)
+{
+	m_watched.push_back({ name, values });
+}
+
+void SimValidator::setParam(const string& name, float value)
+{
+	for (auto& it : m_params)
+	{
+		if (it.first == name)
+		{
+			it.second = value;
+			return;
+		}
+	}
+
+	m_params.push_back({ name, value });
+}
+
+void SimValidator::beginStep()
+{
+	m_step++;
+}
+
+bool SimValidator::checkFinite(const vector<glm::vec3>& values, const string& what)
+{
+	if (m_has_failed) return false;
+
+	for (int i = 0; i < values.size(); ++i)
+	{
+		const glm::vec3& v = values[i];
+		if (!isfinite(v.x) || !isfinite(v.y) || !isfinite(v.z))
+		{
+			stringstream ss;
+			ss << "Non finite " << what << " at " << i;
+			fail(ss.str());
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool SimValidator::checkEnergy(float energy)
+{
+	if (m_has_failed) return false;
+
+	// Falling from rest is a legit jump from zero, so small energies are never a blow up
+	const float min_energy = 1000.0f;
+	if (!isfinite(energy) || energy > max(100.0f * m_energy_avg, min_energy))
+	{
+		stringstream ss;
+		ss << "Energy blow up " << energy << ", running average " << m_energy_avg;
+		fail(ss.str());
+		return false;
+	}
+
+	m_energy_avg = m_step <= 1 ? energy : 0.9f * m_energy_avg + 0.1f * energy;
+	return true;
+}
+
+bool SimValidator::checkConstraint(float violation, float tolerance, const string& what)
+{
+	if (m_has_failed) return false;
+
+	if (!isfinite(violation) || violation > tolerance)
+	{
+		stringstream ss;
+		ss << what << " violated by " << violation << ", tolerance " << tolerance;
+		fail(ss.str());
+		return false;
+	}
+
+	return true;
+}
+
+void SimValidator::fail(const string& reason)
+{
+	m_has_failed = true;
+
+	error_code ec;
+	filesystem::create_directories("assets/repro", ec);
+
+	stringstream path;
+	path << "assets/repro/" << m_name << "_" << m_step << ".txt";
+
+	ofstream file(path.str(), ios::trunc);
+	file << "system " << m_name << "\n";
+	file << "step " << m_step << "\n";
+	file << "reason " << reason << "\n";
+
+	for (const auto& it : m_params)
+	{
+		file << "param " << it.first << " " << it.second << "\n";
+	}
+
+	file.precision(9);
+	for (const auto& it : m_watched)
+	{
+		file << "array " << it.first << " " << it.second->size() << "\n";
+		for (const auto& v : *it.second)
+		{
+			file << v.x << " " << v.y << " " << v.z << "\n";
+		}
+	}
+
+	cout << "********************Simulation validation failed********************" << endl;
+	cout << m_name << " step " << m_step << ": " << reason << endl;
+	cout << "Reproducer written to " << path.str() << endl;
+	cout << "********************end********************\n" << endl;
+
+	assert(0);
+}
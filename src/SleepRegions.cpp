@@ -0,0 +1,43 @@
+#include "SleepRegions.h"
+
+SleepRegions::SleepRegions(int num_regions) :
+	m_threshold(0.0005f), m_sleep_frames(30), m_num_asleep(0)
+{
+	resize(num_regions);
+}
+
+void SleepRegions::resize(int num_regions)
+{
+	m_frames.assign(num_regions, 0);
+	m_num_asleep = 0;
+}
+
+void SleepRegions::update(int region, float energy)
+{
+	if (isAsleep(region)) return;
+
+	if (energy < m_threshold)
+	{
+		m_frames[region]++;
+		if (isAsleep(region)) m_num_asleep++;
+	}
+	else
+	{
+		m_frames[region] = 0;
+	}
+}
+
+void SleepRegions::wake(int region)
+{
+	if (isAsleep(region)) m_num_asleep--;
+	m_frames[region] = 0;
+}
+
+void SleepRegions::wakeAll()
+{
+	for (int i = 0; i < m_frames.size(); ++i)
+	{
+		m_frames[i] = 0;
+	}
+	m_num_asleep = 0;
+}
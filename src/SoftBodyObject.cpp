@@ -4,11 +4,21 @@
 
 #include "SoftBodyObject.h"
 
+#include <algorithm>
+#include <cfloat>
+#include <thread>
+
+#include "ConstraintColoring.h"
+#include "DeformableNormals.h"
 #include "Mesh.h"
-#include "Particle.h"
+#include "Parallel.h"
 #include "Shader.h"
 #include "ShaderManager.h"
+#include "SDFBaker.h"
+#include "SoftBodyWorld.h"
+#include "SpatialHash.h"
 #include "MapManager.h"
+#include "ObjectManager.h"
 
 SoftBodyObject::SoftBodyObject(
 	const vector<info::VertexLayout>& vertices,
@@ -27,12 +37,20 @@ SoftBodyObject::SoftBodyObject(
 	m_dx = 0.1;
 
 	vector<glm::vec3> transformed_vertices = transformVertices(vertices);
-	getTet(transformed_vertices, indices, b_min, b_max);
+	setupPlaceholder(vertices, transformed_vertices, indices);
+
+	// Tetrahedralize on a worker, the job is shared so deleting the object never waits for it
+	m_is_ready = false;
+	m_job = make_shared<TetJob>();
+	float dx = m_dx;
+	shared_ptr<TetJob> job = m_job;
+	thread([transformed_vertices, indices, dx, b_min, b_max, job]()
+		{
+			getTet(transformed_vertices, indices, dx, b_min, b_max, *job);
+			job->is_done = true;
+		}).detach();
 
 	m_simulate = false;
-	t = 0.06f;
-	n_sub_steps = 2;
-	t_sub = t / n_sub_steps;
 
 	cout << "********************end********************\n" << endl;
 }
@@ -57,379 +75,494 @@ vector<glm::vec3> SoftBodyObject::transformVertices(
 	return new_positions;
 }
 
+void SoftBodyObject::setupPlaceholder(
+	const vector<info::VertexLayout>& vertices,
+	const vector<glm::vec3>& transformed_vertices,
+	const vector<info::uint>& indices)
+{
+	// Soft bodies live in world space, so the surface is shown already transformed
+	glm::mat3 N = glm::mat3(glm::transpose(glm::inverse(getModelTransform())));
+	vector<info::VertexLayout> layouts = vertices;
+	for (int i = 0; i < layouts.size(); ++i)
+	{
+		layouts[i].position = transformed_vertices[i];
+		layouts[i].normal = glm::normalize(N * vertices[i].normal);
+	}
+
+	// The surface stays the rendered mesh, once the tets are ready it is skinned to them
+	m_surface_vertices = layouts;
+	m_surface_indices = indices;
+
+	shared_ptr<Mesh> mesh = make_shared<Mesh>("SoftBody");
+	mesh->setupBuffer(layouts, indices);
+	addMesh(mesh);
+}
+
+bool SoftBodyObject::updateJob()
+{
+	if (m_is_ready) return true;
+	if (!m_job->is_done) return false;
+
+	// Buffers can only be created on the render thread
+	getTetVertices(m_job->data);
+	m_job.reset();
+	m_is_ready = true;
+
+	return true;
+}
+
 void SoftBodyObject::draw(
 	const glm::mat4& P, 
 	const glm::mat4& V, 
 	const glm::vec3& view_pos, 
 	const Light& light)
 {
-	simulate();
+	if (!updateJob())
+	{
+		Object::draw(P, V, view_pos, light);
+		return;
+	}
+
+	// Stopping the simulation puts the body back to rest
+	if (m_simulate) m_reset = true;
+	else if (m_reset)
+	{
+		m_body->reset = true;
+		m_reset = false;
+		cout << "Reset" << endl;
+	}
+
+	if (m_body->moved)
+	{
+		updateSurface();
+		m_body->moved = false;
+	}
 
-	glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 	Object::draw(P, V, view_pos, light);
-	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 }
 
 void SoftBodyObject::getTet(
 	const vector<glm::vec3>& vertices,
 	const vector<info::uint>& indices,
+	float dx,
 	const glm::vec3& b_min,
-	const glm::vec3& b_max)
+	const glm::vec3& b_max,
+	TetJob& job)
 {
 	cout << "Get tet" << endl;
-	vector<Vec3f> surf_x;
-	vector<Vec3i> surf_f;
 
-	for (int i = 0; i < vertices.size(); ++i)
-	{
-		Vec3f p(vertices[i].x, vertices[i].y, vertices[i].z);
-		surf_x.push_back(p);
-	}
-
-	for (int i = 0; i < indices.size() - 2; i += 3)
+	// Same surface, resolution and bounds always give the same tet mesh
+	job.stage = TetJob::LOAD_CACHE;
+	uint64_t key = TetCache::computeKey(vertices, indices, dx, b_min, b_max);
+	TetData& data = job.data;
+	if (TetCache::load(key, data))
 	{
-		Vec3i index(indices[i], indices[i + 1], indices[i + 2]);
-		surf_f.push_back(index);
+		cout << "Load tet mesh from " << TetCache::getPath(key) << endl;
+		colorTetData(data);
+		computeSkinning(vertices, data);
+		return;
 	}
 
-	cout << "Surf vertices: " << surf_x.size() << endl;
-	cout << "Surf Faces: " << surf_f.size() << endl;
+	cout << "Surf vertices: " << vertices.size() << endl;
+	cout << "Surf Faces: " << indices.size() / 3 << endl;
 
 	Vec3f xmin(b_min.x, b_min.y, b_min.z);
 	Vec3f xmax(b_max.x, b_max.y, b_max.z);
 
-	Vec3f origin = xmin - Vec3f(2 * m_dx);
-	int ni = (int)std::ceil((xmax[0] - xmin[0]) / m_dx) + 5,
-		nj = (int)std::ceil((xmax[1] - xmin[1]) / m_dx) + 5,
-		nk = (int)std::ceil((xmax[2] - xmin[2]) / m_dx) + 5;
+	Vec3f origin = xmin - Vec3f(2 * dx);
+	int ni = (int)std::ceil((xmax[0] - xmin[0]) / dx) + 5,
+		nj = (int)std::ceil((xmax[1] - xmin[1]) / dx) + 5,
+		nk = (int)std::ceil((xmax[2] - xmin[2]) / dx) + 5;
+
+	// Bake in parallel, then hand the field over to quartet
+	job.stage = TetJob::SIGNED_DISTANCE;
+	SDFBaker baker(glm::vec3(origin[0], origin[1], origin[2]), dx, ni, nj, nk);
+	baker.bake(vertices, indices);
 
-	SDF sdf(origin, m_dx, ni, nj, nk); // Initialize signed distance field.
-	make_signed_distance(surf_f, surf_x, sdf);
+	SDF sdf(origin, dx, ni, nj, nk); // Initialize signed distance field.
+	for (int k = 0; k < nk; ++k)
+	{
+		for (int j = 0; j < nj; ++j)
+		{
+			for (int i = 0; i < ni; ++i)
+			{
+				sdf.phi(i, j, k) = baker.getPhi(i, j, k);
+			}
+		}
+	}
 
 	// Make tet mesh without features
 	cout << "*Making tet mesh*" << endl;
+	job.stage = TetJob::TET_MESH;
 	TetMesh tet_mesh;
 	make_tet_mesh(tet_mesh, sdf, false, false, false);
 	cout << "*Done tet mesh*" << endl;
 
-	getTetVertices(tet_mesh);
+	job.stage = TetJob::SAVE_CACHE;
+	computeTetData(tet_mesh, data);
+	colorTetData(data);
+	if (!data.tets.empty() && TetCache::save(key, data))
+	{
+		cout << "Save tet mesh to " << TetCache::getPath(key) << endl;
+	}
+
+	computeSkinning(vertices, data);
 }
 
-void SoftBodyObject::getTetVertices(const TetMesh& tet_mesh)
+void SoftBodyObject::computeTetData(const TetMesh& tet_mesh, TetData& data)
 {
 	vector<Vec3f> tet_vertices = tet_mesh.verts();
+	data.vertices.resize(tet_mesh.vSize());
 	for (int i = 0; i < tet_mesh.vSize(); ++i)
 	{
-		glm::vec3 pos;
-		pos.x = tet_vertices[i][0];
-		pos.y = tet_vertices[i][1];
-		pos.z = tet_vertices[i][2];
-
-		shared_ptr<SoftParticle> p = make_shared<SoftParticle>(pos);
-		m_tets.emplace_back(p);
-	
-		info::VertexLayout v;
-		v.position = pos;
-		m_tet_vertices.emplace_back(v);
-		m_tet_vertices_og.emplace_back(v);
+		data.vertices[i] = glm::vec3(tet_vertices[i][0], tet_vertices[i][1], tet_vertices[i][2]);
 	}
 
-	// Get rest volume for each tetradehral
 	vector<Vec4i> tet_indices = tet_mesh.tets();
+	data.tets.resize(tet_mesh.tSize());
 	for (int i = 0; i < tet_mesh.tSize(); ++i)
 	{
 		int idx0 = tet_indices[i][0];
 		int idx1 = tet_indices[i][1];
 		int idx2 = tet_indices[i][2];
 		int idx3 = tet_indices[i][3];
+		data.tets[i] = glm::ivec4(idx0, idx1, idx2, idx3);
 
-		m_faces.push_back(idx0);
-		m_faces.push_back(idx1);
-		m_faces.push_back(idx2);
-		m_faces.push_back(idx3);
-
-		// 0, 2, 1
-		m_tet_indices.push_back(idx0);
-		m_tet_indices.push_back(idx2);
-		m_tet_indices.push_back(idx1);
-
-		// 2, 3, 1
-		m_tet_indices.push_back(idx2);
-		m_tet_indices.push_back(idx3);
-		m_tet_indices.push_back(idx1);
-
-		glm::vec3 p0 = m_tets[idx0]->m_position;
-		glm::vec3 p1 = m_tets[idx1]->m_position;
-		glm::vec3 p2 = m_tets[idx2]->m_position;
-		glm::vec3 p3 = m_tets[idx3]->m_position;
+		glm::vec3 p0 = data.vertices[idx0];
+		glm::vec3 p1 = data.vertices[idx1];
+		glm::vec3 p2 = data.vertices[idx2];
+		glm::vec3 p3 = data.vertices[idx3];
 
+		// Get rest volume for each tetradehral
 		glm::vec3 e0 = p1 - p0;
 		glm::vec3 e1 = p2 - p0;
 		glm::vec3 e2 = p3 - p0;
 
 		float v = glm::dot(glm::cross(e0, e1), e2) / 6.0f;
-		m_rest_v.push_back(v);
+		data.rest_v.push_back(v);
+
+		// 6 edges for each tetrahedral, interior edges are shared by several tets
+		static const int tet_edges[6][2] = { {0, 1}, {0, 2}, {0, 3}, {1, 2}, {1, 3}, {2, 3} };
+		for (int k = 0; k < 6; ++k)
+		{
+			int a = data.tets[i][tet_edges[k][0]];
+			int b = data.tets[i][tet_edges[k][1]];
+			data.edges.push_back(glm::ivec2(min(a, b), max(a, b)));
+		}
 	}
 
-	cout << " -tet vertice size: " << m_tet_vertices.size() << ", tet indices size: " << m_tet_indices.size() << endl;
-	
-	if (m_tet_vertices.empty() || m_tet_indices.empty())
+	// Keep each edge once
+	sort(data.edges.begin(), data.edges.end(), [](const glm::ivec2& a, const glm::ivec2& b)
+		{
+			return a.x < b.x || (a.x == b.x && a.y < b.y);
+		});
+	data.edges.erase(unique(data.edges.begin(), data.edges.end()), data.edges.end());
+
+	// Get rest distance for each edge
+	data.rest_d.resize(data.edges.size());
+	for (int i = 0; i < data.edges.size(); ++i)
 	{
-		cout << "Something wrong with the tet mesh" << endl;
-		assert(0);
+		data.rest_d[i] = glm::length(data.vertices[data.edges[i].y] - data.vertices[data.edges[i].x]);
 	}
-	
-	shared_ptr<Mesh> mesh = make_unique<Mesh>("SoftBody");
-	mesh->setupBuffer(m_tet_vertices, m_tet_indices);
-	addMesh(mesh);
+}
 
-	// Get rest distance for each edge of each tetrahedral
-	// 6 edges for each tetrahedral	
-	for (int i = 0; i < tet_mesh.tSize(); ++i)
+void SoftBodyObject::colorTetData(TetData& data)
+{
+	int num_vertices = int(data.vertices.size());
+
+	// Sort edges by colour
+	vector<int> ids(data.edges.size() * 2);
+	for (int i = 0; i < data.edges.size(); ++i)
 	{
-		int idx0 = tet_indices[i][0];
-		int idx1 = tet_indices[i][1];
-		int idx2 = tet_indices[i][2];
-		int idx3 = tet_indices[i][3];
+		ids[i * 2] = data.edges[i].x;
+		ids[i * 2 + 1] = data.edges[i].y;
+	}
+
+	ConstraintColoring edge_coloring;
+	edge_coloring.build(ids, 2, num_vertices);
+
+	vector<glm::ivec2> edges(data.edges.size());
+	vector<float> rest_d(data.rest_d.size());
+	for (int i = 0; i < edges.size(); ++i)
+	{
+		int e = edge_coloring.getOrder()[i];
+		edges[i] = data.edges[e];
+		rest_d[i] = data.rest_d[e];
+	}
+	data.edges = edges;
+	data.rest_d = rest_d;
+	data.edge_colors = edge_coloring.getColorStart();
 
-		glm::vec3 p0 = m_tets[idx0]->m_position;
-		glm::vec3 p1 = m_tets[idx1]->m_position;
-		glm::vec3 p2 = m_tets[idx2]->m_position;
-		glm::vec3 p3 = m_tets[idx3]->m_position;
-
-		glm::vec3 e01 = p1 - p0;
-		glm::vec3 e02 = p2 - p0;
-		glm::vec3 e03 = p3 - p0;
-		glm::vec3 e12 = p2 - p1;
-		glm::vec3 e13 = p3 - p1;
-		glm::vec3 e23 = p3 - p2;
-
-		float d0 = glm::length(e01);
-		float d1 = glm::length(e02);
-		float d2 = glm::length(e03);
-		float d3 = glm::length(e12);
-		float d4 = glm::length(e13);
-		float d5 = glm::length(e23);
-
-		m_rest_d.push_back(d0);
-		m_rest_d.push_back(d1);
-		m_rest_d.push_back(d2);
-		m_rest_d.push_back(d3);
-		m_rest_d.push_back(d4);
-		m_rest_d.push_back(d5);
+	// Sort tets by colour
+	ids.resize(data.tets.size() * 4);
+	for (int i = 0; i < data.tets.size(); ++i)
+	{
+		for (int k = 0; k < 4; ++k) ids[i * 4 + k] = data.tets[i][k];
 	}
 
-	cout << "Size of m_rest_v: " << m_rest_v.size() << " size of m_rest_d: " << m_rest_d.size() << endl;
+	ConstraintColoring tet_coloring;
+	tet_coloring.build(ids, 4, num_vertices);
+
+	vector<glm::ivec4> tets(data.tets.size());
+	vector<float> rest_v(data.rest_v.size());
+	for (int i = 0; i < tets.size(); ++i)
+	{
+		int t = tet_coloring.getOrder()[i];
+		tets[i] = data.tets[t];
+		rest_v[i] = data.rest_v[t];
+	}
+	data.tets = tets;
+	data.rest_v = rest_v;
+	data.tet_colors = tet_coloring.getColorStart();
+
+	cout << "Edges: " << data.edges.size() << " in " << edge_coloring.getNumColors() << " colors, ";
+	cout << "Tets: " << data.tets.size() << " in " << tet_coloring.getNumColors() << " colors" << endl;
 }
 
-void SoftBodyObject::simulate()
+void SoftBodyObject::computeSkinning(const vector<glm::vec3>& surface, TetData& data)
 {
-	if (m_simulate == false)
+	int n_tets = int(data.tets.size());
+	data.skin_tets.assign(surface.size(), -1);
+	data.skin_weights.assign(surface.size(), glm::vec3(0.0f));
+	if (n_tets == 0) return;
+
+	// A tet containing a point has its center closer than its radius
+	vector<glm::vec3> centers(n_tets);
+	float max_radius = 0.0f;
+	for (int i = 0; i < n_tets; ++i)
 	{
-		if (m_reset)
-		{
-			reset();
-			cout << "Reset" << endl;
-			m_reset = false;
-		}
-		return;
-	}
+		glm::vec3 c = glm::vec3(0.0f);
+		for (int k = 0; k < 4; ++k) c += data.vertices[data.tets[i][k]];
+		c /= 4.0f;
+		centers[i] = c;
 
-	m_reset = true;
+		for (int k = 0; k < 4; ++k) max_radius = max(max_radius, glm::length(data.vertices[data.tets[i][k]] - c));
+	}
 
-	vector<glm::vec3> predict2(m_tets.size());
+	SpatialHash hash(max(max_radius, 1e-4f), n_tets);
+	hash.create(centers);
 
-	for (int sub = 0; sub < n_sub_steps; ++sub)
+	// Barycentric weights of p1, p2, p3, the weight of p0 is one minus their sum
+	auto barycentric = [&](const glm::vec3& pos, int t, glm::vec3& w)
 	{
-		for (int i = 0; i < predict2.size(); ++i)
-		{
-			SoftParticle* p = m_tets[i].get();
-			glm::vec3 v = p->m_velocity + p->m_gravity * t_sub;
-			predict2[i] = p->m_position + v * t_sub;
-		}
+		glm::vec3 p0 = data.vertices[data.tets[t][0]];
+		glm::vec3 e0 = data.vertices[data.tets[t][1]] - p0;
+		glm::vec3 e1 = data.vertices[data.tets[t][2]] - p0;
+		glm::vec3 e2 = data.vertices[data.tets[t][3]] - p0;
+		glm::vec3 d = pos - p0;
 
-		for (int iter = 0; iter < 4; ++iter)
-		{
-			solveDistance(predict2);
-			solveVolume(predict2);
-		}
+		float det = glm::dot(e0, glm::cross(e1, e2));
+		if (abs(det) < 1e-12f) return -FLT_MAX;
+
+		w.x = glm::dot(d, glm::cross(e1, e2)) / det;
+		w.y = glm::dot(e0, glm::cross(d, e2)) / det;
+		w.z = glm::dot(e0, glm::cross(e1, d)) / det;
 
-		for (int i = 0; i < m_tets.size(); ++i)
+		// Smallest weight, non negative inside the tet
+		return min(min(w.x, w.y), min(w.z, 1.0f - w.x - w.y - w.z));
+	};
+
+	// Surface points outside the tet mesh are attached to the tet they are least outside of
+	parallel::forEach(int(surface.size()), [&](int i)
 		{
-			// Update positions
-			SoftParticle* p = m_tets[i].get();
-			if (p->m_pinned)
-			{
-				p->m_velocity = glm::vec3(0.0f);
-			}
-			else
+			const glm::vec3& pos = surface[i];
+			float best = -FLT_MAX;
+			glm::vec3 w;
+
+			hash.query(pos, max_radius, [&](int t)
+				{
+					float inside = barycentric(pos, t, w);
+					if (inside > best)
+					{
+						best = inside;
+						data.skin_tets[i] = t;
+						data.skin_weights[i] = w;
+					}
+				});
+
+			if (data.skin_tets[i] >= 0) return;
+
+			// Nothing close, use the nearest tet
+			float min_dist = FLT_MAX;
+			int nearest = 0;
+			for (int t = 0; t < n_tets; ++t)
 			{
-				p->m_velocity = (predict2[i] - p->m_position) / t_sub;
-				p->m_position = predict2[i];
+				float dist = glm::length(centers[t] - pos);
+				if (dist < min_dist)
+				{
+					min_dist = dist;
+					nearest = t;
+				}
 			}
 
-			if (p->m_position.y < -5.0f)
-			{
-				p->m_velocity  *= -0.8f;
-				p->m_position.y = -5.0f;
-			}
-		}
-	}
+			barycentric(pos, nearest, w);
+			data.skin_tets[i] = nearest;
+			data.skin_weights[i] = w;
+		}, 64);
+}
+
+void SoftBodyObject::getTetVertices(const TetData& data)
+{
+	m_skin_tets = data.skin_tets;
+	m_skin_weights = data.skin_weights;
+
+	cout << " -tet vertice size: " << data.vertices.size() << ", tet size: " << data.tets.size() << endl;
 	
-	for (int i = 0; i < m_tets.size(); ++i)
+	if (data.vertices.empty() || data.tets.empty() || m_skin_tets.size() != m_surface_vertices.size())
 	{
-		m_tets[i]->m_velocity *= 0.50f;
+		cout << "Something wrong with the tet mesh" << endl;
+		assert(0);
 	}
+	
+	m_normals = make_unique<DeformableNormals>(m_surface_indices, int(m_surface_vertices.size()));
 
-	// update layouts
-	for (int i = 0; i < m_tets.size(); ++i)
-	{
-		SoftParticle* p = m_tets[i].get();
-		m_tet_vertices[i].position = p->m_position;
-	}
+	// Particles and constraints move to the body, the world packs it on its next step
+	m_body = make_shared<SoftBody>(data);
+	m_body->simulate = m_simulate;
 
-	updateBuffer(m_tet_vertices);
+	cout << "Size of rest_v: " << data.rest_v.size() << " size of rest_d: " << data.rest_d.size() << endl;
 }
 
-void SoftBodyObject::solveDistance(vector<glm::vec3>& predict)
+void SoftBodyObject::updateSurface()
 {
-	int edge_idx = 0;
-	for (int i = 0; i < m_faces.size() - 3; i += 4)
+	// Only the embedded surface is deformed and uploaded, the tets themselves are never drawn
+	const vector<glm::vec3>& positions = m_body->positions;
+	parallel::forEach(int(m_surface_vertices.size()), [&](int i)
+		{
+			const glm::ivec4& tet = m_body->tets[m_skin_tets[i]];
+			glm::vec3 w = m_skin_weights[i];
+
+			glm::vec3 p0 = positions[tet[0]];
+			glm::vec3 p1 = positions[tet[1]];
+			glm::vec3 p2 = positions[tet[2]];
+			glm::vec3 p3 = positions[tet[3]];
+
+			m_surface_vertices[i].position = p0 * (1.0f - w.x - w.y - w.z) + p1 * w.x + p2 * w.y + p3 * w.z;
+		});
+
+	m_normals->compute(m_surface_vertices);
+	updateBuffer(m_surface_vertices);
+}
+
+void SoftBodyObject::renderExtraProperty()
+{
+	if (ImGui::CollapsingHeader("Soft Body"))
 	{
-		int idx0 = m_faces[i];
-		int idx1 = m_faces[i + 1];
-		int idx2 = m_faces[i + 2];
-		int idx3 = m_faces[i + 3];
-		//cout << "solving distance at " << edge_idx << endl;
-
-		glm::vec3 p0 = predict[idx0];
-		glm::vec3 p1 = predict[idx1];
-		glm::vec3 p2 = predict[idx2];
-		glm::vec3 p3 = predict[idx3];
-
-		if (glm::any(glm::isnan(p0)))
+		if (!m_is_ready)
 		{
-			cout << "Nan detected p0 " << edge_idx << endl;
-			assert(0);
+			// Stages of the worker, the last one is only reached on a cache miss
+			static const char* stages[] = { "Loading cache", "Signed distance", "Tetrahedralizing", "Saving cache" };
+			int stage = m_job->stage;
+			float progress = float(stage + 1) / float(TetJob::SAVE_CACHE + 2);
+
+			ImGui::Text("%s ...", stages[stage]);
+			ImGui::ProgressBar(progress, ImVec2(-1.0f, 0.0f));
+			return;
 		}
 
-		if (glm::any(glm::isnan(p1)))
+		ImGui::Text("Vertices : %d", int(m_body->rest_positions.size()));
+		ImGui::Text("Tetrahedrons : %d", int(m_body->tets.size()));
+		ImGui::Text("Edges : %d", int(m_body->edges.size()));
+		ImGui::Text("Colors : %d edge, %d tet", max(0, int(m_body->edge_colors.size()) - 1), max(0, int(m_body->tet_colors.size()) - 1));
+
+		SoftBodyWorld* world = ObjectManager::getObjectManager()->getSoftBodyWorld();
+		ImGui::Text("World : %d bodies, %d particles", world->getNumBodies(), world->getNumParticles());
+
+		// Per body parameters, all bodies are still solved in the same passes
+		ImVec2 cell_padding(0.0f, 2.0f);
+		ImGui::PushStyleVar(ImGuiStyleVar_CellPadding, cell_padding);
+		ImGui::BeginTable("Soft Body", 2);
+
+		ImGui::TableNextRow();
+		ImGui::TableNextColumn();
+		ImGui::AlignTextToFramePadding();
+		ImGui::Text("Model");
+		ImGui::TableNextColumn();
+		string id = "##model";
+		if (ImGui::Combo(id.c_str(), &m_body->model, "Edge + Volume\0Neo-Hookean\0"))
 		{
-			cout << "Nan detected p0" << endl;
-			assert(0);
+			wake();
 		}
 
-		if (glm::any(glm::isnan(p2)))
+		if (m_body->model == SoftBody::EDGE_VOLUME)
 		{
-			cout << "Nan detected p0" << endl;
-			assert(0);
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::AlignTextToFramePadding();
+			ImGui::Text("Edge Compliance");
+			ImGui::TableNextColumn();
+			id = "##edge_compliance";
+			if (ImGui::SliderFloat(id.c_str(), &m_body->edge_compliance, 0.0f, 1.0f, "%.3f", 0))
+			{
+				wake();
+			}
+
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::AlignTextToFramePadding();
+			ImGui::Text("Volume Compliance");
+			ImGui::TableNextColumn();
+			id = "##volume_compliance";
+			if (ImGui::SliderFloat(id.c_str(), &m_body->volume_compliance, 0.0f, 20.0f, "%.2f", 0))
+			{
+				wake();
+			}
 		}
-		
-		if (glm::any(glm::isnan(p3)))
+		else
 		{
-			cout << "Nan detected p0" << endl;
-			assert(0);
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::AlignTextToFramePadding();
+			ImGui::Text("Young's Modulus");
+			ImGui::TableNextColumn();
+			id = "##youngs_modulus";
+			if (ImGui::SliderFloat(id.c_str(), &m_body->youngs_modulus, 1000.0f, 10000000.0f, "%.0f", ImGuiSliderFlags_Logarithmic))
+			{
+				wake();
+			}
+
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::AlignTextToFramePadding();
+			ImGui::Text("Poisson Ratio");
+			ImGui::TableNextColumn();
+			id = "##poisson_ratio";
+			if (ImGui::SliderFloat(id.c_str(), &m_body->poisson_ratio, 0.0f, 0.49f, "%.2f", 0))
+			{
+				wake();
+			}
 		}
 
-		float w0 = 1.0f / m_tets[idx0]->m_mass;
-		float w1 = 1.0f / m_tets[idx1]->m_mass;
-		float w2 = 1.0f / m_tets[idx2]->m_mass;
-		float w3 = 1.0f / m_tets[idx3]->m_mass;
-
-		glm::vec3 e01 = p1 - p0;
-		glm::vec3 e02 = p2 - p0;
-		glm::vec3 e03 = p3 - p0;
-		glm::vec3 e12 = p2 - p1;
-		glm::vec3 e13 = p3 - p1;
-		glm::vec3 e23 = p3 - p2;
-
-		float d0 = glm::length(e01);
-		float d1 = glm::length(e02);
-		float d2 = glm::length(e03);
-		float d3 = glm::length(e12);
-		float d4 = glm::length(e13);
-		float d5 = glm::length(e23);
-
-		float a = 0.0f / (t_sub * t_sub);
-
-		float lambda = (d0 - m_rest_d[edge_idx]) / (w0 + w1 + a);
-		glm::vec3 n = e01 / d0;
-		predict[idx0] += w0 * lambda * n;
-		predict[idx1] -= w1 * lambda * n;
-
-		lambda = (d1 - m_rest_d[edge_idx + 1]) / (w2 + w0 + a);
-		n = e02 / d1;
-		predict[idx0] += w0 * lambda * n;
-		predict[idx2] -= w2 * lambda * n;
-
-		lambda = (d2 - m_rest_d[edge_idx + 2]) / (w3 + w0 + a);
-		n = e03 / d2;
-		predict[idx0] += w0 * lambda * n;
-		predict[idx3] -= w3 * lambda * n;
-
-		lambda = (d3 - m_rest_d[edge_idx + 3]) / (w1 + w2 + a);
-		n = e12 / d3;
-		predict[idx1] += w1 * lambda * n;
-		predict[idx2] -= w2 * lambda * n;
-
-		lambda = (d4 - m_rest_d[edge_idx + 4]) / (w1 + w3 + a);
-		n = e13 / d4;
-		predict[idx1] += w1 * lambda * n;
-		predict[idx3] -= w3 * lambda * n;
-
-		lambda = (d5 - m_rest_d[edge_idx + 5]) / (w2 + w3 + a);
-		n = e23 / d5;
-		predict[idx2] += w2 * lambda * n;
-		predict[idx3] -= w3 * lambda * n;
-
-		edge_idx += 6;
+		// Shared by every body of the world
+		ImGui::TableNextRow();
+		ImGui::TableNextColumn();
+		ImGui::AlignTextToFramePadding();
+		ImGui::Text("Iterations");
+		ImGui::TableNextColumn();
+		id = "##iterations";
+		ImGui::SliderInt(id.c_str(), &world->getIterations(), 1, 8, "%d", 0);
+
+		ImGui::TableNextRow();
+		ImGui::TableNextColumn();
+		ImGui::AlignTextToFramePadding();
+		ImGui::Text("Damping");
+		ImGui::TableNextColumn();
+		id = "##damping";
+		ImGui::SliderFloat(id.c_str(), &m_body->damping, 0.0f, 1.0f, "%.2f", 0);
+
+		ImGui::EndTable();
+		ImGui::PopStyleVar();
 	}
 }
 
-void SoftBodyObject::solveVolume(vector<glm::vec3>& predict)
+void SoftBodyObject::setSimulate(bool simulate)
 {
-	for (int i = 0; i < m_faces.size() - 3; i += 4)
-	{
-		int idx0 = m_faces[i];
-		int idx1 = m_faces[i + 1];
-		int idx2 = m_faces[i + 2];
-		int idx3 = m_faces[i + 3];
-
-		glm::vec3 p0 = predict[idx0];
-		glm::vec3 p1 = predict[idx1];
-		glm::vec3 p2 = predict[idx2];
-		glm::vec3 p3 = predict[idx3];
-
-		glm::vec3 e0 = p1 - p0;
-		glm::vec3 e1 = p2 - p0;
-		glm::vec3 e2 = p3 - p0;
-
-		float v = glm::dot(glm::cross(e0, e1), e2) / 6.0f;
-
-		glm::vec3 u1 = glm::cross(p3 - p1, p2 - p1);
-		glm::vec3 u2 = glm::cross(p3 - p0, p2 - p0);
-		glm::vec3 u3 = glm::cross(p3 - p0, p1 - p0);
-		glm::vec3 u4 = glm::cross(p2 - p0, p1 - p0);
-
-		float a = 10.0f / (t_sub * t_sub);
-		float lambda = a + glm::dot(u1, u1) + glm::dot(u2, u2) + glm::dot(u3, u3) + glm::dot(u4, u4);
-		if (lambda != 0.0f)
-		{
-			lambda = (v - m_rest_v[i/4]) / lambda;
-			predict[idx0] -= u1 * lambda;
-			predict[idx1] -= u2 * lambda;
-			predict[idx2] -= u3 * lambda;
-			predict[idx3] -= u4 * lambda;
-		}
-	}
+	if (simulate && !m_simulate) wake();
+	m_simulate = simulate;
+	if (m_body) m_body->simulate = simulate;
 }
 
-void SoftBodyObject::reset()
+void SoftBodyObject::wake()
 {
-	updateBuffer(m_tet_vertices_og);
-
-	for (int i = 0; i < m_tets.size(); ++i)
-	{
-		m_tets.at(i)->m_position = m_tet_vertices_og.at(i).position;
-	}
+	if (m_body) m_body->wake = true;
 }
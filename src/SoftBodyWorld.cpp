@@ -0,0 +1,674 @@
+#include "SoftBodyWorld.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "Parallel.h"
+#include "SimValidator.h"
+#include "SleepRegions.h"
+#include "SpatialHash.h"
+#include "Terrain.h"
+
+// Tets solved together by one task, every lane loop below is a plain loop over LANES the compiler can vectorize
+static const int LANES = 4;
+
+SoftBody::SoftBody(const TetData& data) :
+	rest_positions(data.vertices), edges(data.edges), rest_d(data.rest_d), edge_colors(data.edge_colors),
+	tets(data.tets), rest_v(data.rest_v), tet_colors(data.tet_colors), positions(data.vertices),
+	model(NEO_HOOKEAN), edge_compliance(0.0f), volume_compliance(10.0f),
+	youngs_modulus(200000.0f), poisson_ratio(0.3f), damping(0.5f),
+	simulate(false), reset(false), wake(false), moved(false), slot(-1), particle_begin(-1)
+{
+}
+
+SoftBodyWorld::SoftBodyWorld() :
+	m_radius(0.05f)
+{
+	m_sleep = make_unique<SleepRegions>(0);
+	m_validator = make_unique<SimValidator>("softbody");
+	m_validator->watch("positions", &m_positions);
+	m_validator->watch("velocities", &m_velocities);
+	m_edge_colors.push_back(0);
+	m_tet_colors.push_back(0);
+
+	t = 0.06f;
+	n_sub_steps = 2;
+	t_sub = t / n_sub_steps;
+	n_iterations = 4;
+}
+
+SoftBodyWorld::~SoftBodyWorld()
+{
+}
+
+void SoftBodyWorld::addBody(const shared_ptr<SoftBody>& body)
+{
+	if (body->slot >= 0) return;
+
+	for (const auto& it : m_pending)
+	{
+		if (it.lock() == body) return;
+	}
+
+	m_pending.push_back(body);
+}
+
+bool SoftBodyWorld::lockBodies()
+{
+	bool changed = !m_pending.empty();
+
+	m_live.clear();
+	for (const auto& it : m_bodies)
+	{
+		shared_ptr<SoftBody> body = it.lock();
+		if (body) m_live.push_back(body);
+		else changed = true;
+	}
+
+	for (const auto& it : m_pending)
+	{
+		shared_ptr<SoftBody> body = it.lock();
+		if (body && body->slot < 0) m_live.push_back(body);
+	}
+	m_pending.clear();
+
+	return changed;
+}
+
+void SoftBodyWorld::pack()
+{
+	int n_particles = 0;
+	int n_edges = 0;
+	int n_tets = 0;
+	int n_edge_colors = 0;
+	int n_tet_colors = 0;
+	for (const auto& body : m_live)
+	{
+		n_particles += int(body->rest_positions.size());
+		n_edges += int(body->edges.size());
+		n_tets += int(body->tets.size());
+		n_edge_colors = max(n_edge_colors, int(body->edge_colors.size()) - 1);
+		n_tet_colors = max(n_tet_colors, int(body->tet_colors.size()) - 1);
+	}
+
+	// Velocities survive the repack, positions are always kept on the bodies
+	vector<glm::vec3> velocities(n_particles, glm::vec3(0.0f));
+	m_positions.resize(n_particles);
+	m_predict.resize(n_particles);
+	m_inv_mass.assign(n_particles, 1.0f);
+	m_particle_body.resize(n_particles);
+
+	int begin = 0;
+	for (int b = 0; b < m_live.size(); ++b)
+	{
+		SoftBody* body = m_live[b].get();
+		int n = int(body->rest_positions.size());
+		for (int i = 0; i < n; ++i)
+		{
+			m_positions[begin + i] = body->positions[i];
+			m_particle_body[begin + i] = b;
+			if (body->slot >= 0) velocities[begin + i] = m_velocities[body->particle_begin + i];
+		}
+
+		body->slot = b;
+		body->particle_begin = begin;
+		begin += n;
+	}
+	m_velocities = velocities;
+
+	// Colour c of the world is colour c of every body, bodies never share particles
+	m_edges.clear();
+	m_rest_d.clear();
+	m_edge_colors.assign(1, 0);
+	m_edges.reserve(n_edges);
+	m_rest_d.reserve(n_edges);
+	for (int c = 0; c < n_edge_colors; ++c)
+	{
+		for (const auto& body : m_live)
+		{
+			if (c + 1 >= body->edge_colors.size()) continue;
+
+			glm::ivec2 offset = glm::ivec2(body->particle_begin);
+			for (int i = body->edge_colors[c]; i < body->edge_colors[c + 1]; ++i)
+			{
+				m_edges.push_back(body->edges[i] + offset);
+				m_rest_d.push_back(body->rest_d[i]);
+			}
+		}
+		m_edge_colors.push_back(int(m_edges.size()));
+	}
+
+	m_tets.clear();
+	m_rest_v.clear();
+	m_tet_colors.assign(1, 0);
+	m_tets.reserve(n_tets);
+	m_rest_v.reserve(n_tets);
+	for (int c = 0; c < n_tet_colors; ++c)
+	{
+		for (const auto& body : m_live)
+		{
+			if (c + 1 >= body->tet_colors.size()) continue;
+
+			glm::ivec4 offset = glm::ivec4(body->particle_begin);
+			for (int i = body->tet_colors[c]; i < body->tet_colors[c + 1]; ++i)
+			{
+				m_tets.push_back(body->tets[i] + offset);
+				m_rest_v.push_back(body->rest_v[i]);
+			}
+		}
+		m_tet_colors.push_back(int(m_tets.size()));
+	}
+
+	m_tet_lambda_d.resize(m_tets.size());
+	m_tet_lambda_h.resize(m_tets.size());
+
+	// Dm = [X1 - X0, X2 - X0, X3 - X0] at rest, degenerate tets get a zero inverse and are never corrected
+	for (int k = 0; k < 9; ++k) m_inv_rest[k].resize(m_tets.size());
+	parallel::forEach(int(m_tets.size()), [&](int i)
+		{
+			const glm::ivec4& tet = m_tets[i];
+			SoftBody* body = m_live[m_particle_body[tet[0]]].get();
+			int begin = body->particle_begin;
+			glm::vec3 X0 = body->rest_positions[tet[0] - begin];
+			glm::mat3 Dm = glm::mat3(
+				body->rest_positions[tet[1] - begin] - X0,
+				body->rest_positions[tet[2] - begin] - X0,
+				body->rest_positions[tet[3] - begin] - X0);
+
+			glm::mat3 Dm_inv = glm::mat3(0.0f);
+			if (abs(glm::determinant(Dm)) > 1e-12f) Dm_inv = glm::inverse(Dm);
+
+			for (int r = 0; r < 3; ++r)
+			{
+				for (int c = 0; c < 3; ++c)
+				{
+					m_inv_rest[r * 3 + c][i] = Dm_inv[c][r];
+				}
+			}
+		});
+
+	m_bodies.assign(m_live.begin(), m_live.end());
+	m_active.assign(m_live.size(), 0);
+	m_model.assign(m_live.size(), SoftBody::EDGE_VOLUME);
+	m_edge_alpha.assign(m_live.size(), 0.0f);
+	m_volume_alpha.assign(m_live.size(), 0.0f);
+	m_mu.assign(m_live.size(), 0.0f);
+	m_lambda.assign(m_live.size(), 0.0f);
+	m_sleep->resize(int(m_live.size()));
+
+	m_hash = make_unique<SpatialHash>(2.0f * m_radius, max(1, n_particles));
+	m_collision_delta.resize(n_particles);
+	m_contact_body.resize(n_particles);
+
+	cout << "Soft body world: " << m_live.size() << " bodies, " << n_particles << " particles, ";
+	cout << n_edges << " edges in " << n_edge_colors << " colors, " << n_tets << " tets in " << n_tet_colors << " colors" << endl;
+}
+
+void SoftBodyWorld::step()
+{
+	if (lockBodies()) pack();
+	if (m_live.empty()) return;
+
+	bool any_active = false;
+	for (int b = 0; b < m_live.size(); ++b)
+	{
+		SoftBody* body = m_live[b].get();
+		int begin = body->particle_begin;
+		int n = int(body->rest_positions.size());
+
+		if (body->reset)
+		{
+			for (int i = 0; i < n; ++i)
+			{
+				m_positions[begin + i] = body->rest_positions[i];
+				m_velocities[begin + i] = glm::vec3(0.0f);
+			}
+			body->positions = body->rest_positions;
+			body->moved = true;
+			body->reset = false;
+			body->wake = true;
+		}
+
+		if (body->wake)
+		{
+			m_sleep->wake(b);
+			body->wake = false;
+		}
+
+		// Settled bodies skip the solver and keep the last uploaded buffer
+		m_active[b] = body->simulate && !m_sleep->isAsleep(b);
+		m_model[b] = body->model;
+		m_edge_alpha[b] = body->edge_compliance / (t_sub * t_sub);
+		m_volume_alpha[b] = body->volume_compliance / (t_sub * t_sub);
+
+		// Lame parameters
+		float E = body->youngs_modulus;
+		float nu = body->poisson_ratio;
+		m_mu[b] = E / (2.0f * (1.0f + nu));
+		m_lambda[b] = E * nu / ((1.0f + nu) * (1.0f - 2.0f * nu));
+		any_active |= m_active[b] != 0;
+	}
+
+	if (!any_active)
+	{
+		m_live.clear();
+		return;
+	}
+
+	int n_particles = getNumParticles();
+	for (int sub = 0; sub < n_sub_steps; ++sub)
+	{
+		parallel::forEach(n_particles, [&](int i)
+			{
+				if (!m_active[m_particle_body[i]])
+				{
+					m_predict[i] = m_positions[i];
+					return;
+				}
+
+				glm::vec3 v = m_velocities[i] + glm::vec3(0.0f, -9.8f, 0.0f) * t_sub;
+				m_predict[i] = m_positions[i] + v * t_sub;
+			});
+
+		fill(m_tet_lambda_d.begin(), m_tet_lambda_d.end(), 0.0f);
+		fill(m_tet_lambda_h.begin(), m_tet_lambda_h.end(), 0.0f);
+
+		for (int iter = 0; iter < n_iterations; ++iter)
+		{
+			solveDistance();
+			solveVolume();
+			solveNeoHookean();
+		}
+
+		if (m_live.size() > 1) solveCollision();
+		solveTerrain();
+
+		parallel::forEach(n_particles, [&](int i)
+			{
+				if (!m_active[m_particle_body[i]]) return;
+
+				m_velocities[i] = (m_predict[i] - m_positions[i]) / t_sub;
+				m_positions[i] = m_predict[i];
+
+				if (m_positions[i].y < -5.0f)
+				{
+					m_velocities[i] *= -0.8f;
+					m_positions[i].y = -5.0f;
+				}
+			});
+	}
+
+	// Damping, sleeping and write back are per body
+	vector<float> energy(m_live.size(), 0.0f);
+	parallel::forEach(int(m_live.size()), [&](int b)
+		{
+			if (!m_active[b]) return;
+
+			SoftBody* body = m_live[b].get();
+			int begin = body->particle_begin;
+			int n = int(body->rest_positions.size());
+
+			float e = 0.0f;
+			for (int i = begin; i < begin + n; ++i)
+			{
+				m_velocities[i] *= body->damping;
+				e += 0.5f * glm::dot(m_velocities[i], m_velocities[i]);
+			}
+			energy[b] = e / max(1, n);
+
+			copy(m_positions.begin() + begin, m_positions.begin() + begin + n, body->positions.begin());
+			body->moved = true;
+		}, 1);
+
+	for (int b = 0; b < m_live.size(); ++b)
+	{
+		if (m_active[b]) m_sleep->update(b, energy[b]);
+	}
+
+#if SIM_VALIDATION
+	validate();
+#endif
+
+	m_live.clear();
+}
+
+void SoftBodyWorld::validate()
+{
+	m_validator->beginStep();
+	m_validator->setParam("t_sub", t_sub);
+	m_validator->setParam("iterations", float(n_iterations));
+	m_validator->setParam("bodies", float(m_live.size()));
+
+	m_validator->checkFinite(m_positions, "position");
+	m_validator->checkFinite(m_velocities, "velocity");
+
+	float energy = 0.0f;
+	int n_active = 0;
+	for (int i = 0; i < m_positions.size(); ++i)
+	{
+		if (!m_active[m_particle_body[i]]) continue;
+
+		energy += 0.5f * glm::dot(m_velocities[i], m_velocities[i]);
+		n_active++;
+	}
+	m_validator->checkEnergy(energy / max(1, n_active));
+
+	// Relative stretch of the worst edge, an edge twice its rest length or collapsed to a point means the solve broke down
+	float strain = 0.0f;
+	for (int i = 0; i < m_edges.size(); ++i)
+	{
+		if (!m_active[m_particle_body[m_edges[i].x]] || m_rest_d[i] <= 0.0f) continue;
+
+		float d = glm::length(m_positions[m_edges[i].y] - m_positions[m_edges[i].x]);
+		strain = max(strain, abs(d - m_rest_d[i]) / m_rest_d[i]);
+	}
+	// Both cases are a strain of exactly 1, checkConstraint only fails above the tolerance
+	m_validator->checkConstraint(strain, 0.99f, "Edge strain");
+}
+
+void SoftBodyWorld::solveDistance()
+{
+	// Edges of one colour share no particle, across all bodies
+	for (int c = 0; c + 1 < m_edge_colors.size(); ++c)
+	{
+		int begin = m_edge_colors[c];
+		parallel::forEach(m_edge_colors[c + 1] - begin, [&](int k)
+			{
+				int i = begin + k;
+				int idx0 = m_edges[i].x;
+				int idx1 = m_edges[i].y;
+
+				int b = m_particle_body[idx0];
+				if (!m_active[b] || m_model[b] != SoftBody::EDGE_VOLUME) return;
+
+				glm::vec3 p0 = m_predict[idx0];
+				glm::vec3 p1 = m_predict[idx1];
+
+				float w0 = m_inv_mass[idx0];
+				float w1 = m_inv_mass[idx1];
+
+				glm::vec3 e01 = p1 - p0;
+				float d = glm::length(e01);
+				if (d == 0.0f) return;
+
+				float lambda = (d - m_rest_d[i]) / (w0 + w1 + m_edge_alpha[b]);
+				glm::vec3 n = e01 / d;
+				m_predict[idx0] += w0 * lambda * n;
+				m_predict[idx1] -= w1 * lambda * n;
+			});
+	}
+}
+
+void SoftBodyWorld::solveVolume()
+{
+	// Tets of one colour share no particle, across all bodies
+	for (int c = 0; c + 1 < m_tet_colors.size(); ++c)
+	{
+		int begin = m_tet_colors[c];
+		parallel::forEach(m_tet_colors[c + 1] - begin, [&](int k)
+			{
+				int i = begin + k;
+				int idx0 = m_tets[i][0];
+				int idx1 = m_tets[i][1];
+				int idx2 = m_tets[i][2];
+				int idx3 = m_tets[i][3];
+
+				int b = m_particle_body[idx0];
+				if (!m_active[b] || m_model[b] != SoftBody::EDGE_VOLUME) return;
+
+				glm::vec3 p0 = m_predict[idx0];
+				glm::vec3 p1 = m_predict[idx1];
+				glm::vec3 p2 = m_predict[idx2];
+				glm::vec3 p3 = m_predict[idx3];
+
+				glm::vec3 e0 = p1 - p0;
+				glm::vec3 e1 = p2 - p0;
+				glm::vec3 e2 = p3 - p0;
+
+				float v = glm::dot(glm::cross(e0, e1), e2) / 6.0f;
+
+				glm::vec3 u1 = glm::cross(p3 - p1, p2 - p1);
+				glm::vec3 u2 = glm::cross(p3 - p0, p2 - p0);
+				glm::vec3 u3 = glm::cross(p3 - p0, p1 - p0);
+				glm::vec3 u4 = glm::cross(p2 - p0, p1 - p0);
+
+				float lambda = m_volume_alpha[b] + glm::dot(u1, u1) + glm::dot(u2, u2) + glm::dot(u3, u3) + glm::dot(u4, u4);
+				if (lambda != 0.0f)
+				{
+					lambda = (v - m_rest_v[i]) / lambda;
+					m_predict[idx0] -= u1 * lambda;
+					m_predict[idx1] -= u2 * lambda;
+					m_predict[idx2] -= u3 * lambda;
+					m_predict[idx3] -= u4 * lambda;
+				}
+			}, 64);
+	}
+}
+
+void SoftBodyWorld::solveNeoHookean()
+{
+	// Tets of one colour share no particle, so blocks of one colour are independent
+	for (int c = 0; c + 1 < m_tet_colors.size(); ++c)
+	{
+		int begin = m_tet_colors[c];
+		int n = m_tet_colors[c + 1] - begin;
+		parallel::forEach((n + LANES - 1) / LANES, [&](int block)
+			{
+				int first = begin + block * LANES;
+				solveNeoHookeanBlock(first, min(LANES, begin + n - first));
+			}, 16);
+	}
+}
+
+// Reference : Macklin and Muller, "A Constraint-based Formulation of Stable Neo-Hookean Materials"
+// Deviatoric C_D = |F| - sqrt(3) with compliance 1 / mu, hydrostatic C_H = det(F) - 1 with compliance 1 / lambda
+// Both are zero at rest, so a single iteration per substep does not drift towards a collapsed tet
+void SoftBodyWorld::solveNeoHookeanBlock(int first, int count)
+{
+	// Lanes past count or of other bodies keep a zero weight and get no correction
+	float x[4][3][LANES];
+	float Dm_inv[9][LANES];
+	float w[4][LANES];
+	bool solve[LANES];
+	float alpha_d[LANES];
+	float alpha_h[LANES];
+
+	for (int l = 0; l < LANES; ++l)
+	{
+		int i = first + min(l, count - 1);
+		const glm::ivec4& tet = m_tets[i];
+		int b = m_particle_body[tet[0]];
+		solve[l] = l < count && m_active[b] && m_model[b] == SoftBody::NEO_HOOKEAN && m_rest_v[i] > 0.0f;
+
+		for (int v = 0; v < 4; ++v)
+		{
+			glm::vec3 p = m_predict[tet[v]];
+			x[v][0][l] = p.x;
+			x[v][1][l] = p.y;
+			x[v][2][l] = p.z;
+			w[v][l] = solve[l] ? m_inv_mass[tet[v]] : 0.0f;
+		}
+
+		for (int k = 0; k < 9; ++k) Dm_inv[k][l] = m_inv_rest[k][i];
+
+		float dt2 = t_sub * t_sub;
+		float V = max(m_rest_v[i], 1e-12f);
+		alpha_d[l] = 1.0f / (m_mu[b] * V * dt2);
+		alpha_h[l] = 1.0f / (m_lambda[b] * V * dt2);
+	}
+
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		// F = Ds * Dm^-1, Ds = [x1 - x0, x2 - x0, x3 - x0]
+		float F[3][3][LANES];
+		for (int r = 0; r < 3; ++r)
+		{
+			for (int c = 0; c < 3; ++c)
+			{
+				for (int l = 0; l < LANES; ++l)
+				{
+					float d0 = x[1][r][l] - x[0][r][l];
+					float d1 = x[2][r][l] - x[0][r][l];
+					float d2 = x[3][r][l] - x[0][r][l];
+					F[r][c][l] = d0 * Dm_inv[c][l] + d1 * Dm_inv[3 + c][l] + d2 * Dm_inv[6 + c][l];
+				}
+			}
+		}
+
+		// dC/dF and C
+		float P[3][3][LANES];
+		float C[LANES];
+		float* alpha = pass == 0 ? alpha_d : alpha_h;
+		if (pass == 0)
+		{
+			for (int l = 0; l < LANES; ++l)
+			{
+				float sum = 0.0f;
+				for (int r = 0; r < 3; ++r)
+				{
+					for (int c = 0; c < 3; ++c) sum += F[r][c][l] * F[r][c][l];
+				}
+				float norm = sqrt(sum);
+				C[l] = norm - sqrt(3.0f);
+
+				float inv = norm > 1e-9f ? 1.0f / norm : 0.0f;
+				for (int r = 0; r < 3; ++r)
+				{
+					for (int c = 0; c < 3; ++c) P[r][c][l] = F[r][c][l] * inv;
+				}
+			}
+		}
+		else
+		{
+			// Columns of the cofactor matrix of F are f1 x f2, f2 x f0 and f0 x f1
+			for (int l = 0; l < LANES; ++l)
+			{
+				glm::vec3 f0 = glm::vec3(F[0][0][l], F[1][0][l], F[2][0][l]);
+				glm::vec3 f1 = glm::vec3(F[0][1][l], F[1][1][l], F[2][1][l]);
+				glm::vec3 f2 = glm::vec3(F[0][2][l], F[1][2][l], F[2][2][l]);
+				glm::vec3 cof[3] = { glm::cross(f1, f2), glm::cross(f2, f0), glm::cross(f0, f1) };
+
+				C[l] = glm::dot(f0, cof[0]) - 1.0f;
+				for (int r = 0; r < 3; ++r)
+				{
+					for (int c = 0; c < 3; ++c) P[r][c][l] = cof[c][r];
+				}
+			}
+		}
+
+		// Gradient of x1, x2, x3 is dC/dF * Dm^-T, gradient of x0 is minus their sum
+		float g[4][3][LANES];
+		for (int v = 0; v < 3; ++v)
+		{
+			for (int r = 0; r < 3; ++r)
+			{
+				for (int l = 0; l < LANES; ++l)
+				{
+					g[v + 1][r][l] = P[r][0][l] * Dm_inv[v * 3][l] + P[r][1][l] * Dm_inv[v * 3 + 1][l] + P[r][2][l] * Dm_inv[v * 3 + 2][l];
+				}
+			}
+		}
+
+		for (int r = 0; r < 3; ++r)
+		{
+			for (int l = 0; l < LANES; ++l) g[0][r][l] = -(g[1][r][l] + g[2][r][l] + g[3][r][l]);
+		}
+
+		for (int l = 0; l < LANES; ++l)
+		{
+			float sum = 0.0f;
+			for (int v = 0; v < 4; ++v)
+			{
+				sum += w[v][l] * (g[v][0][l] * g[v][0][l] + g[v][1][l] * g[v][1][l] + g[v][2][l] * g[v][2][l]);
+			}
+
+			float d_lambda = 0.0f;
+			if (l < count && sum > 0.0f)
+			{
+				float* multiplier = pass == 0 ? &m_tet_lambda_d[first + l] : &m_tet_lambda_h[first + l];
+				d_lambda = (-C[l] - alpha[l] * *multiplier) / (sum + alpha[l]);
+				*multiplier += d_lambda;
+			}
+			for (int v = 0; v < 4; ++v)
+			{
+				for (int r = 0; r < 3; ++r) x[v][r][l] += w[v][l] * d_lambda * g[v][r][l];
+			}
+		}
+	}
+
+	for (int l = 0; l < count; ++l)
+	{
+		if (!solve[l]) continue;
+
+		const glm::ivec4& tet = m_tets[first + l];
+		for (int v = 0; v < 4; ++v)
+		{
+			m_predict[tet[v]] = glm::vec3(x[v][0][l], x[v][1][l], x[v][2][l]);
+		}
+	}
+}
+
+void SoftBodyWorld::solveCollision()
+{
+	int n_particles = getNumParticles();
+	float min_dist = 2.0f * m_radius;
+
+	m_hash->create(m_predict);
+
+	// Jacobi step, every particle only writes its own correction
+	parallel::forEach(n_particles, [&](int i)
+		{
+			m_collision_delta[i] = glm::vec3(0.0f);
+			m_contact_body[i] = -1;
+
+			int b = m_particle_body[i];
+			if (!m_active[b]) return;
+
+			glm::vec3 p = m_predict[i];
+			m_hash->query(p, min_dist, [&](int j)
+				{
+					int other = m_particle_body[j];
+					if (other == b) return;
+
+					glm::vec3 d = p - m_predict[j];
+					float dist = glm::length(d);
+					if (dist >= min_dist || dist == 0.0f) return;
+
+					// Both sides move half way when both bodies are simulated, a resting body is pushed away from instead
+					float share = m_active[other] ? 0.5f : 1.0f;
+					m_collision_delta[i] += share * (min_dist - dist) * d / dist;
+					m_contact_body[i] = other;
+				});
+		});
+
+	parallel::forEach(n_particles, [&](int i)
+		{
+			m_predict[i] += m_collision_delta[i];
+		});
+
+	// Sleeping bodies that were hit wake up on the next step
+	for (int i = 0; i < n_particles; ++i)
+	{
+		int other = m_contact_body[i];
+		if (other >= 0 && m_sleep->isAsleep(other)) m_live[other]->wake = true;
+	}
+}
+
+void SoftBodyWorld::solveTerrain()
+{
+	for (auto& terrain : m_terrains)
+	{
+		terrain->getSurfaces(m_predict, m_terrain_heights, m_terrain_normals);
+
+		// Particles below the tangent plane of the surface are projected back onto it, the velocity update
+		// that follows removes what they moved into the ground
+		parallel::forEach(getNumParticles(), [&](int i)
+			{
+				if (!m_active[m_particle_body[i]]) return;
+
+				glm::vec3 normal = m_terrain_normals[i];
+				float d = (m_predict[i].y - m_terrain_heights[i]) * normal.y;
+				if (d < m_radius) m_predict[i] += normal * (m_radius - d);
+			});
+	}
+}
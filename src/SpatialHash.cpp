@@ -0,0 +1,57 @@
+#include "SpatialHash.h"
+
+#include "Parallel.h"
+
+SpatialHash::SpatialHash(float spacing, int max_num) :
+	m_spacing(spacing), m_table_size(2 * max(max_num, 1))
+{
+	m_cell_start.resize(m_table_size + 1, 0);
+	m_cell_entries.resize(max_num, 0);
+	m_hashes.resize(max_num, 0);
+}
+
+glm::ivec3 SpatialHash::getCell(const glm::vec3& pos) const
+{
+	return glm::ivec3(glm::floor(pos / m_spacing));
+}
+
+info::uint SpatialHash::getHashIndex(const glm::ivec3& cell) const
+{
+	return ((info::uint)(cell.x * 73856093) ^
+			(info::uint)(cell.y * 19349663) ^
+			(info::uint)(cell.z * 83492791)) % m_table_size;
+}
+
+void SpatialHash::create(const vector<glm::vec3>& positions)
+{
+	int n = int(min(positions.size(), m_cell_entries.size()));
+
+	parallel::forEach(n, [&](int i)
+		{
+			m_hashes[i] = getHashIndex(getCell(positions[i]));
+		});
+
+	// Count the entries of each cell
+	fill(m_cell_start.begin(), m_cell_start.end(), 0);
+	for (int i = 0; i < n; ++i)
+	{
+		m_cell_start[m_hashes[i]]++;
+	}
+
+	// Partial sums give the end of each cell
+	int start = 0;
+	for (int i = 0; i < m_table_size; ++i)
+	{
+		start += m_cell_start[i];
+		m_cell_start[i] = start;
+	}
+	m_cell_start[m_table_size] = start;
+
+	// Fill backwards so that every cell ends up sorted by id
+	for (int i = n - 1; i >= 0; --i)
+	{
+		info::uint h = m_hashes[i];
+		m_cell_start[h]--;
+		m_cell_entries[m_cell_start[h]] = i;
+	}
+}
@@ -1,16 +1,73 @@
 #include "Terrain.h"
 
+#include <algorithm>
+#include <cfloat>
+#include <thread>
+
+#include "HeightMap.h"
+#include "HeightPyramid.h"
 #include "MapManager.h"
+#include "Parallel.h"
 #include "Shader.h"
 #include "ShaderManager.h"
+#include "TerrainFile.h"
+#include "TerrainHistory.h"
+#include "TerrainScatter.h"
+#include "TerrainStreamer.h"
+
+namespace
+{
+	// Terrain files in use, two streamers appending to one file would overwrite each other's records
+	vector<bool> terrain_files;
+
+	// Planes of the view frustum from the rows of PVM, pointing inside
+	array<glm::vec4, 6> getFrustumPlanes(const glm::mat4& PVM)
+	{
+		glm::vec4 row0(PVM[0][0], PVM[1][0], PVM[2][0], PVM[3][0]);
+		glm::vec4 row1(PVM[0][1], PVM[1][1], PVM[2][1], PVM[3][1]);
+		glm::vec4 row2(PVM[0][2], PVM[1][2], PVM[2][2], PVM[3][2]);
+		glm::vec4 row3(PVM[0][3], PVM[1][3], PVM[2][3], PVM[3][3]);
+
+		return { row3 + row0, row3 - row0, row3 + row1, row3 - row1, row3 + row2, row3 - row2 };
+	}
+
+	bool isBoxVisible(const array<glm::vec4, 6>& planes, const glm::vec3& b_min, const glm::vec3& b_max)
+	{
+		for (const auto& plane : planes)
+		{
+			// Corner furthest along the plane normal
+			glm::vec3 p(
+				plane.x > 0.0f ? b_max.x : b_min.x,
+				plane.y > 0.0f ? b_max.y : b_min.y,
+				plane.z > 0.0f ? b_max.z : b_min.z);
+
+			if (glm::dot(glm::vec3(plane), p) + plane.w < 0.0f) return false;
+		}
+
+		return true;
+	}
+
+	float getBoxDistance(const glm::vec3& p, const glm::vec3& b_min, const glm::vec3& b_max)
+	{
+		return glm::length(p - glm::clamp(p, b_min, b_max));
+	}
+}
 
 Terrain::Terrain(float res) : Object("Terrain")
 {
 	cout << "*************************Terrain Constructor*************************" << endl;
 
-	m_res = 64.0;
-	m_width = 10.0f;
-	m_height = 10.0f;
+	// 32 x 32 tiles of 64 x 64 cells, raise the tile count or the cell size for larger worlds
+	m_num_tiles = 32;
+	m_tile_cells = 64;
+	m_cell_size = 10.0f / 64.0f;
+	m_width = m_num_tiles * m_tile_cells * m_cell_size;
+	m_height = m_width;
+
+	// Each node is drawn as 8 x 8 patches tessellated down to one vertex per sample
+	m_patches = 8;
+	m_lod_distance = 5.0f;
+	m_triangle_size = 16.0f;
 
 	m_noise_scale = 1;
 	m_octaves = 8;
@@ -21,6 +78,47 @@ Terrain::Terrain(float res) : Object("Terrain")
 	m_strength = 0.05f;
 
 	m_hit = glm::vec3(-1.0f);
+	m_view_pos = glm::vec3(0.0f);
+
+	m_brush = BRUSH_SCULPT;
+	m_erosion_tiles = 8;
+
+	// Lowest file no other terrain has open, a single terrain always reopens default.terrain
+	m_file_slot = 0;
+	while (m_file_slot < terrain_files.size() && terrain_files[m_file_slot]) m_file_slot++;
+	if (m_file_slot == terrain_files.size()) terrain_files.push_back(true);
+	terrain_files[m_file_slot] = true;
+
+	string path = "assets/terrain/default.terrain";
+	if (m_file_slot > 0) path = "assets/terrain/default_" + to_string(m_file_slot) + ".terrain";
+
+	int max_resident = 256;
+	m_streamer = make_unique<TerrainStreamer>(path, m_num_tiles, m_tile_cells, max_resident);
+	m_height_map = make_unique<HeightMap>(m_streamer->getTileRes(), max_resident);
+	for (int i = max_resident - 1; i >= 0; --i)
+	{
+		m_free_slots.push_back(i);
+	}
+
+	int num_entries = 0;
+	for (int level = 0; level < m_streamer->getNumLevels(); ++level)
+	{
+		m_resident_start.push_back(num_entries);
+		num_entries += m_streamer->getNumTiles(level) * m_streamer->getNumTiles(level);
+	}
+	m_resident.assign(num_entries, nullptr);
+
+	m_streamer->getGenerator().setNoise(getNoise());
+
+	// Strokes keep only the tiles they changed, 64 MB holds a long session of brush work
+	m_history = make_unique<TerrainHistory>(m_streamer->getTileRes(), size_t(64) << 20);
+	m_history_step = 0;
+	m_is_stroke = false;
+
+	// Vegetation on the level 0 tiles, in the space of the terrain like the nodes it is drawn on
+	m_scatter = make_unique<TerrainScatter>(m_num_tiles, getNodeSize(0), getOrigin());
+	m_scatter_layer = 0;
+	m_is_scatter = true;
 
 	createVertex();
 
@@ -41,209 +139,784 @@ Terrain::Terrain(float res) : Object("Terrain")
 
 Terrain::~Terrain()
 {
-}
+	// The worker owns its share of the job and finishes on its own
+	if (m_erosion != nullptr) m_erosion->progress.cancel = true;
 
-int Terrain::getIndex(const glm::vec2& uv)
-{
-	return uv.x + m_res * uv.y;
+	// The streamer closes its file with the members, before anything else can open a terrain
+	terrain_files[m_file_slot] = false;
 }
 
 void Terrain::createVertex()
 {
-	vector<info::VertexLayout> layouts;
-	info::VertexLayout layout;
-	m_vertices = vector<shared_ptr<TerrainVertex>>(m_res * m_res);
-	for (float x = 0.0f; x < m_res-1; ++x)
+	// One patch grid shared by every node, only indices into its (patches + 1)^2 corners are stored.
+	// Terrain.vert turns the index back into a corner, heights come from the tile layer of the node.
+	vector<info::uint> indices;
+	indices.reserve(4 * m_patches * m_patches);
+	info::uint row = info::uint(m_patches + 1);
+	for (info::uint z = 0; z < info::uint(m_patches); ++z)
 	{
-		for (float z = 0.0f; z < m_res-1; ++z)
+		for (info::uint x = 0; x < info::uint(m_patches); ++x)
 		{
-			layout.position.x = -m_width / 2.0f + m_width * x / m_res;
-			layout.position.y = 0.0f;
-			layout.position.z = -m_height / 2.0f + m_height * z / m_res;
-			layout.texCoord.x = x / m_res;
-			layout.texCoord.y = z / m_res;
-			glm::vec3 p1 = layout.position;
-			glm::vec2 uv1 = glm::vec2(x, z);
-			layouts.push_back(layout);
-
-			layout.position.x = -m_width / 2.0f + m_width * (x + 1) / m_res;
-			layout.position.y = 0.0f;
-			layout.position.z = -m_height / 2.0f + m_height * z / m_res;
-			layout.texCoord.x = (x + 1) / m_res;
-			layout.texCoord.y = z / m_res;
-			glm::vec3 p2 = layout.position;
-			glm::vec2 uv2 = glm::vec2(x+1, z);
-			layouts.push_back(layout);
-
-			layout.position.x = -m_width / 2.0f + m_width * x / m_res;
-			layout.position.y = 0.0f;
-			layout.position.z = -m_height / 2.0f + m_height * (z + 1) / m_res;
-			layout.texCoord.x = x / m_res;
-			layout.texCoord.y = (z + 1) / m_res;
-			glm::vec3 p3 = layout.position;
-			glm::vec2 uv3 = glm::vec2(x, z+1);
-			layouts.push_back(layout);
-
-			layout.position.x = -m_width / 2.0f + m_width * (x + 1) / m_res;
-			layout.position.y = 0.0f;
-			layout.position.z = -m_height / 2.0f + m_height * (z + 1) / m_res;
-			layout.texCoord.x = (x + 1) / m_res;
-			layout.texCoord.y = (z + 1) / m_res;
-			glm::vec3 p4 = layout.position;
-			glm::vec2 uv4 = glm::vec2(x+1, z+1);
-			layouts.push_back(layout);
-
-			shared_ptr<Tri> t1 = make_shared<Tri>(p1, p2, p4, uv1, uv2, uv4);
-			shared_ptr<Tri> t2 = make_shared<Tri>(p1, p3, p4, uv1, uv3, uv4);
-			m_trimeshes.push_back(t1);
-			m_trimeshes.push_back(t2);
-
-			shared_ptr<TerrainVertex> tv1 = make_shared<TerrainVertex>(p1, glm::vec3(1.0));
-			if(m_vertices[getIndex(uv1)] == nullptr)
-				m_vertices[getIndex(uv1)] = tv1;
-
-			shared_ptr<TerrainVertex> tv2 = make_shared<TerrainVertex>(p2, glm::vec3(1.0));
-			if(m_vertices[getIndex(uv2)] == nullptr)
-				m_vertices[getIndex(uv2)] = tv2;
-
-			shared_ptr<TerrainVertex> tv3 = make_shared<TerrainVertex>(p3, glm::vec3(1.0));
-			if(m_vertices[getIndex(uv3)] == nullptr)
-				m_vertices[getIndex(uv3)] = tv3;
-
-			shared_ptr<TerrainVertex> tv4 = make_shared<TerrainVertex>(p4, glm::vec3(1.0));
-			if(m_vertices[getIndex(uv4)] == nullptr)
-				m_vertices[getIndex(uv4)] = tv4;
+			info::uint corner = x + row * z;
+			indices.push_back(corner);
+			indices.push_back(corner + 1);
+			indices.push_back(corner + row);
+			indices.push_back(corner + row + 1);
 		}
 	}
 
 	glPatchParameteri(GL_PATCH_VERTICES, 4);
 
-	// color
-	vector<glm::vec3> colors(layouts.size(), glm::vec3(1.0f));
-
 	shared_ptr<Mesh> mesh = make_shared<Mesh>("Terrain");
-	mesh->setupBuffer(layouts);
+	mesh->setupBuffer(indices);
 	addMesh(mesh);
 }
 
-void Terrain::editTerrain(glm::vec3 ray_dir, glm::vec3 ray_pos, bool mouse_down)
+bool Terrain::getHeight(int level, int gx, int gz, float& h) const
 {
-	m_hit = glm::vec3(-1000.0f);
-	if (!m_is_edit) return;
+	int n = m_streamer->getNumTiles(level);
+	if (gx < 0 || gz < 0 || gx > n * m_tile_cells || gz > n * m_tile_cells) return false;
+
+	int tx = min(gx / m_tile_cells, n - 1);
+	int tz = min(gz / m_tile_cells, n - 1);
+	shared_ptr<TerrainTile> tile = m_streamer->find(level, tx, tz);
+	if (tile == nullptr) return false;
 
-	float t = 0.0f;
+	int res = m_streamer->getTileRes();
+	h = tile->heights[(gx - tx * m_tile_cells) + res * (gz - tz * m_tile_cells)];
+	return true;
+}
+
+bool Terrain::getSurface(const glm::vec3& p, float& height, glm::vec3& normal)
+{
+	glm::mat4 M = getModelTransform();
+	glm::mat3 N = glm::transpose(glm::inverse(glm::mat3(M)));
+	return sampleSurface(p, M, glm::inverse(M), N, height, normal);
+}
+
+void Terrain::getSurfaces(const vector<glm::vec3>& points, vector<float>& heights, vector<glm::vec3>& normals)
+{
+	glm::mat4 M = getModelTransform();
+	glm::mat4 M_inv = glm::inverse(M);
+	glm::mat3 N = glm::transpose(glm::inverse(glm::mat3(M)));
 
-	std::sort(m_trimeshes.begin(), m_trimeshes.end(),
-		[ray_pos](const shared_ptr<Tri>& lhs, const shared_ptr<Tri>& rhs)
+	heights.resize(points.size());
+	normals.resize(points.size());
+	parallel::forEach(int(points.size()), [&](int i)
 		{
-			float d1 = glm::length(ray_pos - (lhs->getClosest(ray_pos)));
-			float d2 = glm::length(ray_pos - (rhs->getClosest(ray_pos)));
-			return d1 < d2;
-		});
-
-	float gap_w = m_width / m_res / 16.0f;
-	float gap_h = m_height / m_res / 16.0f;
-	int index = -1;
-	vector<glm::vec3> offset = {{-gap_w, 0.0f, -gap_h}, 
-								{-gap_w, 0.0f, 0.0f},
-								{0.0f, 0.0f, -gap_h},
-								{0.0f, 0.0f, 0.0f},
-								{gap_w, 0.0f, 0.0f},
-								{0.0f, 0.0f, gap_h},
-								{gap_w, 0.0f, gap_h} };
-
-	for (int i = 0; i < m_trimeshes.size(); ++i)
-	{
-		for (int j = 0; j < offset.size(); ++j)
+			if (!sampleSurface(points[i], M, M_inv, N, heights[i], normals[i]))
+			{
+				heights[i] = -FLT_MAX;
+				normals[i] = glm::vec3(0.0f, 1.0f, 0.0f);
+			}
+		}, 1024);
+}
+
+bool Terrain::sampleSurface(const glm::vec3& p, const glm::mat4& M, const glm::mat4& M_inv, const glm::mat3& N,
+	float& height, glm::vec3& normal) const
+{
+	glm::vec3 local = glm::vec3(M_inv * glm::vec4(p, 1.0f));
+	glm::vec2 origin = getOrigin();
+	int res = m_streamer->getTileRes();
+
+	// Coarser levels stand in until the finer tiles under p are streamed in, the root is always resident
+	for (int level = 0; level < m_streamer->getNumLevels(); ++level)
+	{
+		int n = m_streamer->getNumTiles(level);
+		int max_sample = n * m_tile_cells;
+		float cell = m_cell_size * float(1 << level);
+		float gx = (local.x - origin.x) / cell;
+		float gz = (local.z - origin.y) / cell;
+		if (!(gx >= 0.0f && gz >= 0.0f && gx <= float(max_sample) && gz <= float(max_sample))) return false;
+
+		// Tiles share their border samples, so all four corners of a cell are in one tile
+		int x = min(int(gx), max_sample - 1);
+		int z = min(int(gz), max_sample - 1);
+		int tx = x / m_tile_cells;
+		int tz = z / m_tile_cells;
+		const TerrainTile* tile = m_resident[m_resident_start[level] + tx + n * tz];
+		if (tile == nullptr) continue;
+
+		float u = gx - float(x);
+		float v = gz - float(z);
+		int i = (x - tx * m_tile_cells) + res * (z - tz * m_tile_cells);
+		const float* h = tile->heights.data() + i;
+		const glm::vec3* nr = tile->normals.data() + i;
+		float h_local = glm::mix(glm::mix(h[0], h[1], u), glm::mix(h[res], h[res + 1], u), v);
+		glm::vec3 n_local = glm::mix(glm::mix(nr[0], nr[1], u), glm::mix(nr[res], nr[res + 1], u), v);
+
+		height = (M * glm::vec4(local.x, h_local, local.z, 1.0f)).y;
+		normal = glm::normalize(N * n_local);
+		return true;
+	}
+
+	return false;
+}
+
+void Terrain::getNodeBox(const TerrainTile& tile, glm::vec3& b_min, glm::vec3& b_max) const
+{
+	float size = getNodeSize(tile.level);
+	glm::vec2 origin = getOrigin();
+
+	b_min = glm::vec3(origin.x + tile.x * size, tile.pyramid.getMin(), origin.y + tile.z * size);
+	b_max = glm::vec3(b_min.x + size, tile.pyramid.getMax(), b_min.z + size);
+}
+
+void Terrain::computeNormals(TerrainTile& tile, int x0, int z0, int x1, int z1)
+{
+	int res = m_streamer->getTileRes();
+	x0 = glm::max(x0, 0);
+	z0 = glm::max(z0, 0);
+	x1 = glm::min(x1, res - 1);
+	z1 = glm::min(z1, res - 1);
+
+	// Central differences, samples across the border come from the neighbour tiles when they are resident
+	float d = m_cell_size * float(1 << tile.level);
+	auto sample = [&](int x, int z, float& h)
 		{
-			if (m_trimeshes[i]->intersectWithRay(ray_dir+offset[j], ray_pos, t))
+			if (x >= 0 && z >= 0 && x < res && z < res)
 			{
-				m_hit = ray_pos + ray_dir * t;
-				//m_hit = hit_pos;
-				index = i;
-				break;
-			}		
+				h = tile.heights[x + res * z];
+				return true;
+			}
+
+			return getHeight(tile.level, tile.x * m_tile_cells + x, tile.z * m_tile_cells + z, h);
+		};
+
+	for (int z = z0; z <= z1; ++z)
+	{
+		for (int x = x0; x <= x1; ++x)
+		{
+			float h = tile.heights[x + res * z];
+			float h_l = h, h_r = h, h_d = h, h_u = h;
+			float dx = 0.0f, dz = 0.0f;
+
+			if (sample(x - 1, z, h_l)) dx += d;
+			if (sample(x + 1, z, h_r)) dx += d;
+			if (sample(x, z - 1, h_d)) dz += d;
+			if (sample(x, z + 1, h_u)) dz += d;
+
+			float slope_x = dx > 0.0f ? (h_r - h_l) / dx : 0.0f;
+			float slope_z = dz > 0.0f ? (h_u - h_d) / dz : 0.0f;
+			tile.normals[x + res * z] = glm::normalize(glm::vec3(-slope_x, 1.0f, -slope_z));
+		}
+	}
+}
+
+bool Terrain::uploadTile(TerrainTile& tile)
+{
+	if (m_free_slots.empty()) return false;
+
+	tile.slot = m_free_slots.back();
+	m_free_slots.pop_back();
+	tile.state = TerrainTile::READY;
+
+	int res = m_streamer->getTileRes();
+	computeNormals(tile, 0, 0, res - 1, res - 1);
+	m_height_map->upload(tile.slot, tile.heights, tile.normals);
+
+	refreshBorders(tile);
+
+	return true;
+}
+
+void Terrain::refreshBorders(const TerrainTile& tile)
+{
+	// Border normals of the neighbours were computed with the old heights of this tile, or without it
+	int res = m_streamer->getTileRes();
+	// Corner samples read across the diagonal, so all eight neighbours are touched
+	for (int oz = -1; oz <= 1; ++oz)
+	{
+		for (int ox = -1; ox <= 1; ++ox)
+		{
+			if (ox == 0 && oz == 0) continue;
+
+			shared_ptr<TerrainTile> neighbour = m_streamer->find(tile.level, tile.x + ox, tile.z + oz);
+			if (neighbour == nullptr) continue;
+
+			int x0 = ox == -1 ? res - 1 : 0;
+			int x1 = ox == 1 ? 0 : res - 1;
+			int z0 = oz == -1 ? res - 1 : 0;
+			int z1 = oz == 1 ? 0 : res - 1;
+
+			computeNormals(*neighbour, x0, z0, x1, z1);
+			m_height_map->updateNormals(neighbour->slot, neighbour->normals, x0, z0, x1, z1);
+		}
+	}
+}
+
+void Terrain::updateTiles()
+{
+	vector<shared_ptr<TerrainTile>> loaded;
+	vector<shared_ptr<TerrainTile>> evicted;
+	m_streamer->update(loaded, evicted);
+
+	for (const auto& tile : evicted)
+	{
+		if (tile->slot >= 0) m_free_slots.push_back(tile->slot);
+		tile->slot = -1;
+	}
+
+	// Tiles without a free layer stay loaded and are picked up again next frame
+	TerrainGenerator& generator = m_streamer->getGenerator();
+	int version = generator.getVersion();
+	for (const auto& tile : loaded)
+	{
+		// The noise changed while the tile was generated
+		if (tile->generated && tile->noise_version != version)
+		{
+			generator.generateTile(tile->level, tile->x, tile->z, tile->heights, tile->noise_version);
+			tile->pyramid.build(tile->heights, m_streamer->getTileRes());
 		}
+
+		if (!uploadTile(*tile)) break;
 	}
 
-	if (index != -1)
+	if (!loaded.empty() || !evicted.empty()) updateResident();
+
+	computeBBox();
+}
+
+void Terrain::updateResident()
+{
+	// Evicted tiles are only freed by the streamer, so no query sees one once this is done
+	vector<shared_ptr<TerrainTile>> tiles;
+	m_streamer->getTiles(tiles);
+
+	fill(m_resident.begin(), m_resident.end(), nullptr);
+	for (const auto& tile : tiles)
 	{
-		glm::vec2 uv1 = m_trimeshes[index]->getUV1();
-		glm::vec2 uv2 = m_trimeshes[index]->getUV2();
-		glm::vec2 uv3 = m_trimeshes[index]->getUV3();
+		int n = m_streamer->getNumTiles(tile->level);
+		m_resident[m_resident_start[tile->level] + tile->x + n * tile->z] = tile.get();
+	}
+}
+
+void Terrain::selectNode(int level, int x, int z, const glm::vec3& view_pos, const array<glm::vec4, 6>& planes)
+{
+	shared_ptr<TerrainTile> tile = m_streamer->request(level, x, z);
+	if (tile == nullptr) return;
+
+	glm::vec3 b_min, b_max;
+	getNodeBox(*tile, b_min, b_max);
+	if (!isBoxVisible(planes, b_min, b_max)) return;
+
+	if (level == 0 || getBoxDistance(view_pos, b_min, b_max) > m_lod_ranges[level - 1])
+	{
+		m_selected.push_back(tile);
+		return;
+	}
+
+	// Children take over once all four are resident, until then the node covers them
+	bool is_ready = true;
+	for (int i = 0; i < 4; ++i)
+	{
+		if (m_streamer->request(level - 1, 2 * x + (i & 1), 2 * z + (i >> 1)) == nullptr)
+			is_ready = false;
+	}
+
+	if (!is_ready)
+	{
+		m_selected.push_back(tile);
+		return;
+	}
+
+	for (int i = 0; i < 4; ++i)
+	{
+		selectNode(level - 1, 2 * x + (i & 1), 2 * z + (i >> 1), view_pos, planes);
+	}
+}
+
+void Terrain::pickNode(int level, int x, int z, const glm::vec3& ray_dir, const glm::vec3& ray_pos, float& t)
+{
+	shared_ptr<TerrainTile> tile = m_streamer->find(level, x, z);
+	if (tile == nullptr) return;
+
+	glm::vec3 b_min, b_max;
+	getNodeBox(*tile, b_min, b_max);
+
+	float t_near, t_far;
+	if (!HeightPyramid::intersectBox(ray_dir, ray_pos, b_min, b_max, t_near, t_far)) return;
+	if (t_near >= t) return;
+
+	if (level == 0)
+	{
+		float t_hit = 0.0f;
+		glm::ivec2 cell;
+		glm::vec2 spacing(m_cell_size);
+		if (tile->pyramid.intersect(ray_dir, ray_pos, glm::vec2(b_min.x, b_min.z), spacing, t_hit, cell))
+		{
+			t = min(t, t_hit);
+		}
+		return;
+	}
+
+	for (int i = 0; i < 4; ++i)
+	{
+		pickNode(level - 1, 2 * x + (i & 1), 2 * z + (i >> 1), ray_dir, ray_pos, t);
+	}
+}
+
+bool Terrain::pick(const glm::vec3& ray_dir, const glm::vec3& ray_pos)
+{
+	// Only resident level 0 tiles can be hit, which covers everything drawn at full detail
+	float t = FLT_MAX;
+	pickNode(m_streamer->getNumLevels() - 1, 0, 0, ray_dir, ray_pos, t);
+	if (t >= FLT_MAX) return false;
+
+	m_hit = ray_pos + ray_dir * t;
+	return true;
+}
+
+void Terrain::refreshRect(int x0, int z0, int x1, int z1)
+{
+	int res = m_streamer->getTileRes();
+	for (int level = 0; level < m_streamer->getNumLevels(); ++level)
+	{
+		// Samples of this level sitting on a changed level 0 sample, and one more around them for the normals
+		int step = 1 << level;
+		int lx0 = (x0 + step - 1) / step;
+		int lz0 = (z0 + step - 1) / step;
+		int lx1 = x1 / step;
+		int lz1 = z1 / step;
+		if (lx1 < lx0 || lz1 < lz0) break;
+
+		int n = m_streamer->getNumTiles(level);
+		int tx0 = max((lx0 - 2) / m_tile_cells, 0);
+		int tz0 = max((lz0 - 2) / m_tile_cells, 0);
+		int tx1 = min((lx1 + 1) / m_tile_cells, n - 1);
+		int tz1 = min((lz1 + 1) / m_tile_cells, n - 1);
+
+		vector<shared_ptr<TerrainTile>> tiles;
+		for (int tz = tz0; tz <= tz1; ++tz)
+		{
+			for (int tx = tx0; tx <= tx1; ++tx)
+			{
+				shared_ptr<TerrainTile> tile = m_streamer->find(level, tx, tz);
+				if (tile != nullptr) tiles.push_back(tile);
+			}
+		}
 
-		glm::vec3 v1 = m_trimeshes[index]->getV1();
-		glm::vec3 v2 = m_trimeshes[index]->getV2();
-		glm::vec3 v3 = m_trimeshes[index]->getV3();
-		
-		glm::vec3 center = (v1 + v2 + v3) / 3.0f;
-		
-		for (int i = -1; i <= 1; ++i)
+		for (const auto& tile : tiles)
 		{
-			for (int j = -1; j <= 1; ++j)
+			int ox = tile->x * m_tile_cells;
+			int oz = tile->z * m_tile_cells;
+			int hx0 = max(lx0 - ox, 0), hz0 = max(lz0 - oz, 0);
+			int hx1 = min(lx1 - ox, res - 1), hz1 = min(lz1 - oz, res - 1);
+			if (hx0 > hx1 || hz0 > hz1) continue;
+
+			// Edits snap to the grid of the terrain file so a tile read back equals the copies its neighbours hold,
+			// coarse tiles take every step-th level 0 sample
+			if (level == 0)
 			{
-				glm::vec2 near1 = uv1 + glm::vec2(i, j);
-				int idx1 = getIndex(near1);
-				if (idx1 >= 0 && idx1 < m_res * m_res)
+				for (int z = hz0; z <= hz1; ++z)
 				{
-					float r = glm::length(center - m_vertices[idx1]->pos);
-					if (r <= m_brush_size && mouse_down)
+					for (int x = hx0; x <= hx1; ++x)
 					{
-						m_vertices[idx1]->pos.y += (1.0 - r) * m_strength;
+						float& h = tile->heights[x + res * z];
+						h = TerrainFile::quantize(h);
 					}
 				}
-
-				glm::vec2 near2 = uv2 + glm::vec2(i, j);
-				int idx2 = getIndex(near2);
-				if (idx2 >= 0 && idx2 < m_res * m_res)
+			}
+			else
+			{
+				for (int z = hz0; z <= hz1; ++z)
 				{
-					float r = glm::length(center - m_vertices[idx2]->pos);
-					if (r <= m_brush_size && mouse_down)
+					for (int x = hx0; x <= hx1; ++x)
 					{
-						m_vertices[idx2]->pos.y += (1.0 - r) * m_strength;
+						getHeight(0, (ox + x) * step, (oz + z) * step, tile->heights[x + res * z]);
 					}
 				}
-				
-				glm::vec2 near3 = uv3 + glm::vec2(i, j);
-				int idx3 = getIndex(near3);
-				if (idx3 >= 0 && idx3 < m_res * m_res)
+			}
+
+			tile->pyramid.update(tile->heights, hx0, hz0, hx1, hz1);
+			m_height_map->updateHeights(tile->slot, tile->heights, hx0, hz0, hx1, hz1);
+			tile->dirty = true;
+		}
+
+		// Normals at tile borders read the neighbours, so only once every height of the level is in
+		for (const auto& tile : tiles)
+		{
+			int ox = tile->x * m_tile_cells;
+			int oz = tile->z * m_tile_cells;
+			int nx0 = max(lx0 - 1 - ox, 0), nz0 = max(lz0 - 1 - oz, 0);
+			int nx1 = min(lx1 + 1 - ox, res - 1), nz1 = min(lz1 + 1 - oz, res - 1);
+			if (nx0 > nx1 || nz0 > nz1) continue;
+
+			computeNormals(*tile, nx0, nz0, nx1, nz1);
+			m_height_map->updateNormals(tile->slot, tile->normals, nx0, nz0, nx1, nz1);
+		}
+	}
+}
+
+TerrainNoise Terrain::getNoise() const
+{
+	TerrainNoise noise;
+	noise.frequency = m_frequency;
+	noise.octaves = m_octaves;
+	noise.amplitude = float(m_noise_scale);
+	return noise;
+}
+
+void Terrain::regenerate()
+{
+	TerrainGenerator& generator = m_streamer->getGenerator();
+	int version = generator.setNoise(getNoise());
+
+	// Sculpted tiles keep their heights, everything else follows the noise
+	vector<shared_ptr<TerrainTile>> tiles;
+	m_streamer->getTiles(tiles);
+	tiles.erase(remove_if(tiles.begin(), tiles.end(),
+		[version](const shared_ptr<TerrainTile>& tile)
+		{
+			return !tile->generated || tile->dirty || tile->noise_version == version;
+		}), tiles.end());
+
+	int res = m_streamer->getTileRes();
+	for (const auto& tile : tiles)
+	{
+		generator.generateTile(tile->level, tile->x, tile->z, tile->heights, tile->noise_version);
+		tile->pyramid.build(tile->heights, res);
+	}
+
+	// Normals need the new heights of the neighbours
+	for (const auto& tile : tiles)
+	{
+		computeNormals(*tile, 0, 0, res - 1, res - 1);
+		m_height_map->upload(tile->slot, tile->heights, tile->normals);
+		refreshBorders(*tile);
+	}
+
+	computeBBox();
+}
+
+void Terrain::computeBBox()
+{
+	// World extent in x and z, heights from the root tile, so edits never rescan the grid
+	glm::vec3 b_min(-m_width / 2.0f, 0.0f, -m_height / 2.0f);
+	glm::vec3 b_max(m_width / 2.0f, 0.0f, m_height / 2.0f);
+
+	shared_ptr<TerrainTile> root = m_streamer ? m_streamer->find(m_streamer->getNumLevels() - 1, 0, 0) : nullptr;
+	if (root != nullptr)
+	{
+		b_min.y = root->pyramid.getMin();
+		b_max.y = root->pyramid.getMax();
+	}
+
+	glm::mat4 M = getModelTransform();
+	glm::vec3 t_min = glm::vec3(FLT_MAX);
+	glm::vec3 t_max = glm::vec3(-FLT_MAX);
+	for (int i = 0; i < 8; ++i)
+	{
+		glm::vec3 corner(
+			(i & 1) ? b_max.x : b_min.x,
+			(i & 2) ? b_max.y : b_min.y,
+			(i & 4) ? b_max.z : b_min.z);
+
+		glm::vec3 p = glm::vec3(M * glm::vec4(corner, 1.0f));
+		t_min = glm::min(t_min, p);
+		t_max = glm::max(t_max, p);
+	}
+
+	setBBoxMinMax(t_min, t_max);
+}
+
+void Terrain::editTerrain(glm::vec3 ray_dir, glm::vec3 ray_pos, bool mouse_down)
+{
+	m_hit = glm::vec3(-1000.0f);
+	if (!mouse_down) m_history->end();
+	if (!m_is_edit || m_erosion != nullptr || m_history_step != 0) return;
+
+	if (!pick(ray_dir, ray_pos)) return;
+	if (!mouse_down || m_brush_size <= 0.0f) return;
+
+	// Density is not part of the heights, it stays out of the history
+	if (m_brush == BRUSH_SCATTER)
+	{
+		m_scatter->paint(m_scatter_layer, glm::vec2(m_hit.x, m_hit.z), m_brush_size, m_strength);
+		return;
+	}
+
+	// A stroke lasts as long as edits come in every frame
+	m_history->begin();
+	m_is_stroke = true;
+
+	// Dirty rectangle of the level 0 samples under the brush
+	glm::vec2 origin = getOrigin();
+	int max_sample = m_num_tiles * m_tile_cells;
+	int x0 = glm::clamp(int(glm::floor((m_hit.x - m_brush_size - origin.x) / m_cell_size)), 0, max_sample);
+	int z0 = glm::clamp(int(glm::floor((m_hit.z - m_brush_size - origin.y) / m_cell_size)), 0, max_sample);
+	int x1 = glm::clamp(int(glm::ceil((m_hit.x + m_brush_size - origin.x) / m_cell_size)), 0, max_sample);
+	int z1 = glm::clamp(int(glm::ceil((m_hit.z + m_brush_size - origin.y) / m_cell_size)), 0, max_sample);
+
+	if (m_brush != BRUSH_SCULPT)
+	{
+		erodeBrush(x0, z0, x1, z1);
+		return;
+	}
+
+	// Border samples live in every tile around them, each copy gets the same edit
+	int res = m_streamer->getTileRes();
+	int tx0 = max((x0 - 1) / m_tile_cells, 0);
+	int tz0 = max((z0 - 1) / m_tile_cells, 0);
+	int tx1 = min(x1 / m_tile_cells, m_num_tiles - 1);
+	int tz1 = min(z1 / m_tile_cells, m_num_tiles - 1);
+	for (int tz = tz0; tz <= tz1; ++tz)
+	{
+		for (int tx = tx0; tx <= tx1; ++tx)
+		{
+			shared_ptr<TerrainTile> tile = m_streamer->find(0, tx, tz);
+			if (tile == nullptr) continue;
+
+			m_history->touch(tile);
+			int ox = tx * m_tile_cells;
+			int oz = tz * m_tile_cells;
+			for (int z = max(z0 - oz, 0); z <= min(z1 - oz, res - 1); ++z)
+			{
+				for (int x = max(x0 - ox, 0); x <= min(x1 - ox, res - 1); ++x)
 				{
-					float r = glm::length(center - m_vertices[idx3]->pos);
-					if (r <= m_brush_size && mouse_down)
+					float& h = tile->heights[x + res * z];
+					glm::vec3 p(origin.x + (ox + x) * m_cell_size, h, origin.y + (oz + z) * m_cell_size);
+					float r = glm::length(m_hit - p);
+					if (r <= m_brush_size)
 					{
-						m_vertices[idx3]->pos.y += (1.0 - r) * m_strength;
+						h += (1.0f - r / m_brush_size) * m_strength;
 					}
 				}
 			}
 		}
 	}
 
-	vector<info::VertexLayout> layouts = getVertices();
-	for (int i = 0; i < layouts.size(); ++i)
+	refreshRect(x0, z0, x1, z1);
+	computeBBox();
+}
+
+void Terrain::readHeights(int x0, int z0, int x1, int z1, vector<float>& heights) const
+{
+	int width = x1 - x0 + 1;
+	heights.assign(width * (z1 - z0 + 1), 0.0f);
+	for (int z = z0; z <= z1; ++z)
+	{
+		for (int x = x0; x <= x1; ++x)
+		{
+			getHeight(0, x, z, heights[(x - x0) + width * (z - z0)]);
+		}
+	}
+}
+
+void Terrain::writeHeights(int x0, int z0, int x1, int z1, const vector<float>& heights)
+{
+	// Border samples live in every tile around them, each copy gets the same value
+	int res = m_streamer->getTileRes();
+	int width = x1 - x0 + 1;
+	int tx0 = max((x0 - 1) / m_tile_cells, 0);
+	int tz0 = max((z0 - 1) / m_tile_cells, 0);
+	int tx1 = min(x1 / m_tile_cells, m_num_tiles - 1);
+	int tz1 = min(z1 / m_tile_cells, m_num_tiles - 1);
+	for (int tz = tz0; tz <= tz1; ++tz)
+	{
+		for (int tx = tx0; tx <= tx1; ++tx)
+		{
+			shared_ptr<TerrainTile> tile = m_streamer->find(0, tx, tz);
+			if (tile == nullptr) continue;
+
+			m_history->touch(tile);
+			int ox = tx * m_tile_cells;
+			int oz = tz * m_tile_cells;
+			for (int z = max(z0 - oz, 0); z <= min(z1 - oz, res - 1); ++z)
+			{
+				for (int x = max(x0 - ox, 0); x <= min(x1 - ox, res - 1); ++x)
+				{
+					tile->heights[x + res * z] = heights[(ox + x - x0) + width * (oz + z - z0)];
+				}
+			}
+		}
+	}
+}
+
+void Terrain::erodeBrush(int x0, int z0, int x1, int z1)
+{
+	// Droplets may run past the brush, so they get room around it, only the brush blends the result in
+	int max_sample = m_num_tiles * m_tile_cells;
+	int margin = m_brush == BRUSH_HYDRAULIC ? m_erosion_settings.lifetime + m_erosion_settings.radius + 2 : 1;
+	int rx0 = max(x0 - margin, 0);
+	int rz0 = max(z0 - margin, 0);
+	int rx1 = min(x1 + margin, max_sample);
+	int rz1 = min(z1 + margin, max_sample);
+
+	vector<float> before;
+	readHeights(rx0, rz0, rx1, rz1, before);
+
+	int width = rx1 - rx0 + 1;
+	int depth = rz1 - rz0 + 1;
+	vector<float> after = before;
+	m_erosion_settings.relief = getRelief();
+	TerrainErosion erosion(after, width, depth, m_cell_size);
+	if (m_brush == BRUSH_HYDRAULIC)
+	{
+		int droplets = (x1 - x0 + 1) * (z1 - z0 + 1);
+		erosion.hydraulic(m_erosion_settings, droplets, x0 - rx0, z0 - rz0, x1 - rx0 + 1, z1 - rz0 + 1, uint32_t(m_streamer->getFrame()));
+	}
+	else
+	{
+		erosion.thermal(m_erosion_settings, 8);
+	}
+
+	glm::vec2 origin = getOrigin();
+	int brush_width = x1 - x0 + 1;
+	vector<float> heights((z1 - z0 + 1) * brush_width);
+	for (int z = z0; z <= z1; ++z)
+	{
+		for (int x = x0; x <= x1; ++x)
+		{
+			int i = (x - rx0) + width * (z - rz0);
+			glm::vec2 p(origin.x + x * m_cell_size, origin.y + z * m_cell_size);
+			float r = glm::length(glm::vec2(m_hit.x, m_hit.z) - p);
+			float w = glm::clamp(1.0f - r / m_brush_size, 0.0f, 1.0f);
+			heights[(x - x0) + brush_width * (z - z0)] = before[i] + (after[i] - before[i]) * w;
+		}
+	}
+
+	writeHeights(x0, z0, x1, z1, heights);
+	refreshRect(x0, z0, x1, z1);
+	computeBBox();
+}
+
+float Terrain::getRelief() const
+{
+	// Height range of the whole terrain, so brushes and passes erode alike wherever they run
+	shared_ptr<TerrainTile> root = m_streamer->find(m_streamer->getNumLevels() - 1, 0, 0);
+	if (root == nullptr) return 1.0f;
+
+	return max(root->pyramid.getMax() - root->pyramid.getMin(), 1.0e-3f);
+}
+
+void Terrain::startErosion()
+{
+	if (m_erosion != nullptr) return;
+
+	// Block of level 0 tiles centred on the tile under the camera
+	float tile_size = getNodeSize(0);
+	glm::vec2 origin = getOrigin();
+	int n = min(m_erosion_tiles, m_num_tiles);
+	int cx = int(glm::floor((m_view_pos.x - origin.x) / tile_size));
+	int cz = int(glm::floor((m_view_pos.z - origin.y) / tile_size));
+	int tx0 = glm::clamp(cx - n / 2, 0, m_num_tiles - n);
+	int tz0 = glm::clamp(cz - n / 2, 0, m_num_tiles - n);
+
+	m_erosion = make_shared<ErosionJob>();
+	m_erosion->x0 = tx0 * m_tile_cells;
+	m_erosion->z0 = tz0 * m_tile_cells;
+	m_erosion->width = n * m_tile_cells + 1;
+	m_erosion->depth = n * m_tile_cells + 1;
+}
+
+void Terrain::updateErosion()
+{
+	if (m_erosion == nullptr) return;
+
+	// Requesting every tile each frame loads the missing ones and keeps all of them from being evicted
+	int tx0 = m_erosion->x0 / m_tile_cells;
+	int tz0 = m_erosion->z0 / m_tile_cells;
+	int n = (m_erosion->width - 1) / m_tile_cells;
+	m_erosion->tiles.clear();
+	for (int tz = tz0; tz < tz0 + n; ++tz)
+	{
+		for (int tx = tx0; tx < tx0 + n; ++tx)
+		{
+			shared_ptr<TerrainTile> tile = m_streamer->request(0, tx, tz);
+			if (tile != nullptr) m_erosion->tiles.push_back(tile);
+		}
+	}
+
+	if (!m_erosion->is_started)
 	{
-		glm::vec2 uv = layouts[i].texCoord;
-		int idx = getIndex(uv*m_res);
-		if (idx >= 0 && idx < m_res * m_res)
+		if (m_erosion->progress.cancel)
 		{
-			layouts[i].position = m_vertices[idx]->pos;
+			m_erosion.reset();
+			return;
 		}
+
+		if (int(m_erosion->tiles.size()) < n * n) return;
+
+		int x1 = m_erosion->x0 + m_erosion->width - 1;
+		int z1 = m_erosion->z0 + m_erosion->depth - 1;
+		readHeights(m_erosion->x0, m_erosion->z0, x1, z1, m_erosion->heights);
+
+		// One droplet per sample, then the slopes the droplets left behind settle
+		m_erosion->is_started = true;
+		m_erosion_settings.relief = getRelief();
+		shared_ptr<ErosionJob> job = m_erosion;
+		ErosionSettings settings = m_erosion_settings;
+		float spacing = m_cell_size;
+		thread([job, settings, spacing]()
+			{
+				TerrainErosion erosion(job->heights, job->width, job->depth, spacing);
+				if (erosion.hydraulic(settings, job->width * job->depth, 0, 0, job->width, job->depth, 1337u, &job->progress, 0.0f, 0.8f))
+				{
+					erosion.thermal(settings, 50, &job->progress, 0.8f, 1.0f);
+				}
+				job->is_done = true;
+			}).detach();
+		return;
 	}
 
-	updateBuffer(layouts);
+	if (!m_erosion->is_done) return;
+
+	// A cancelled job still hands back the passes it finished
+	int x1 = m_erosion->x0 + m_erosion->width - 1;
+	int z1 = m_erosion->z0 + m_erosion->depth - 1;
+	// The whole pass is one stroke
+	m_history->end();
+	m_history->begin();
+	writeHeights(m_erosion->x0, m_erosion->z0, x1, z1, m_erosion->heights);
+	m_history->end();
+	refreshRect(m_erosion->x0, m_erosion->z0, x1, z1);
 	computeBBox();
 
-	for (int i = 0; i < m_trimeshes.size(); ++i)
+	m_erosion.reset();
+}
+
+void Terrain::updateHistory()
+{
+	// No edit came in since the last frame, the mouse was released
+	if (!m_is_stroke) m_history->end();
+	m_is_stroke = false;
+
+	if (m_history_step == 0) return;
+
+	const TerrainStroke* stroke = m_history_step < 0 ? m_history->getUndo() : m_history->getRedo();
+	if (stroke == nullptr || m_erosion != nullptr)
+	{
+		m_history_step = 0;
+		return;
+	}
+
+	// Requesting loads evicted tiles back and keeps them until the stroke is applied
+	bool is_ready = true;
+	for (const TileDelta& delta : stroke->tiles)
 	{
-		glm::vec2 uv1 = m_trimeshes[i]->getUV1();
-		glm::vec2 uv2 = m_trimeshes[i]->getUV2();
-		glm::vec2 uv3 = m_trimeshes[i]->getUV3();
+		if (m_streamer->request(0, delta.x, delta.z) == nullptr) is_ready = false;
+	}
+	if (!is_ready) return;
 
-		glm::vec3 a = m_vertices[getIndex(uv1)]->pos;
-		glm::vec3 b = m_vertices[getIndex(uv2)]->pos;
-		glm::vec3 c = m_vertices[getIndex(uv3)]->pos;
+	for (const TileDelta& delta : stroke->tiles)
+	{
+		shared_ptr<TerrainTile> tile = m_streamer->find(0, delta.x, delta.z);
+		m_history->apply(delta, tile->heights);
+	}
 
-		m_trimeshes[i]->updateVertices(a, b, c);
+	// Only the changed rectangles are resampled and uploaded
+	for (const TileDelta& delta : stroke->tiles)
+	{
+		int ox = delta.x * m_tile_cells;
+		int oz = delta.z * m_tile_cells;
+		refreshRect(ox + delta.x0, oz + delta.z0, ox + delta.x1, oz + delta.z1);
 	}
+	computeBBox();
+
+	if (m_history_step < 0) m_history->popUndo();
+	else m_history->popRedo();
+	m_history_step = 0;
 }
 
 void Terrain::draw(const glm::mat4& P,
@@ -251,6 +924,26 @@ void Terrain::draw(const glm::mat4& P,
 	const glm::vec3& view_pos,
 	const Light& light)
 {
+	updateTiles();
+
+	// Selection runs in the space of the terrain
+	glm::mat4 M = getModelTransform();
+	glm::vec3 local_view_pos = glm::vec3(glm::inverse(M) * glm::vec4(view_pos, 1.0f));
+	m_view_pos = local_view_pos;
+	array<glm::vec4, 6> planes = getFrustumPlanes(P * V * M);
+
+	int num_levels = m_streamer->getNumLevels();
+	m_lod_ranges.resize(num_levels);
+	for (int level = 0; level < num_levels; ++level)
+	{
+		m_lod_ranges[level] = m_lod_distance * getNodeSize(level);
+	}
+
+	m_selected.clear();
+	selectNode(num_levels - 1, 0, 0, local_view_pos, planes);
+	updateErosion();
+	updateHistory();
+
 	shared_ptr<Shader> shader = ShaderManager::getShader("Terrain");
 
 	shader->load();
@@ -267,7 +960,44 @@ void Terrain::draw(const glm::mat4& P,
 	glActiveTexture(GL_TEXTURE0);
 	MapManager::getManager()->bindShadowMap();
 
-	drawTessMesh(P, V, *shader, m_res);
+	shader->setInt("height_map", 1);
+	shader->setInt("normal_map", 2);
+	m_height_map->bind(1, 2);
+
+	shader->setInt("grid_cells", m_tile_cells);
+	shader->setInt("patches", m_patches);
+	shader->setFloat("tess_level", float(m_tile_cells / m_patches));
+	shader->setFloat("triangle_size", m_triangle_size);
+	shader->setVec3("local_view_pos", local_view_pos);
+	shader->setVec2("world_min", getOrigin());
+	shader->setVec2("world_size", glm::vec2(m_width, m_height));
+
+	// Patches size their triangles in pixels of the current target
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	shader->setVec2("viewport", glm::vec2(float(viewport[2]), float(viewport[3])));
+
+	glm::vec2 origin = getOrigin();
+	for (const auto& tile : m_selected)
+	{
+		// Vertices finish morphing into the parent grid where the parent takes over, the root never morphs
+		float size = getNodeSize(tile->level);
+		float morph_end = tile->level + 1 < num_levels ? m_lod_ranges[tile->level] : FLT_MAX;
+		float morph_start = tile->level + 1 < num_levels ? 0.85f * morph_end : FLT_MAX * 0.5f;
+
+		shader->setVec2("node_origin", origin + glm::vec2(tile->x, tile->z) * size);
+		shader->setFloat("node_size", size);
+		shader->setInt("node_layer", tile->slot);
+		shader->setVec2("node_height", glm::vec2(tile->pyramid.getMin(), tile->pyramid.getMax()));
+		shader->setVec2("morph", glm::vec2(morph_start, morph_end));
+
+		drawTessMesh(P, V, *shader, float(m_patches));
+	}
+
+	if (m_is_scatter)
+	{
+		m_scatter->draw(P, V, M, view_pos, local_view_pos, planes, light, m_selected, *m_height_map, m_tile_cells);
+	}
 }
 
 void Terrain::renderExtraProperty()
@@ -298,6 +1028,157 @@ void Terrain::renderExtraProperty()
 		id_size = "##strength";
 		ImGui::SliderFloat(id_size.c_str(), &m_strength, 0.0f, 5.0f, "%.1f", 0);
 
+		// Sliders report every change while dragging, cached octaves keep that cheap
+		bool noise_changed = false;
+
+		ImGui::TableNextRow();
+		ImGui::TableNextColumn();
+		ImGui::AlignTextToFramePadding();
+		ImGui::Text("Height");
+		ImGui::TableNextColumn();
+		id_size = "##height";
+		noise_changed |= ImGui::SliderInt(id_size.c_str(), &m_noise_scale, 0, 20, "%d", 0);
+
+		ImGui::TableNextRow();
+		ImGui::TableNextColumn();
+		ImGui::AlignTextToFramePadding();
+		ImGui::Text("Frequency");
+		ImGui::TableNextColumn();
+		id_size = "##frequency";
+		noise_changed |= ImGui::SliderFloat(id_size.c_str(), &m_frequency, 0.001f, 0.1f, "%.3f", ImGuiSliderFlags_Logarithmic);
+
+		ImGui::TableNextRow();
+		ImGui::TableNextColumn();
+		ImGui::AlignTextToFramePadding();
+		ImGui::Text("Octaves");
+		ImGui::TableNextColumn();
+		id_size = "##octaves";
+		noise_changed |= ImGui::SliderInt(id_size.c_str(), &m_octaves, 1, 12, "%d", 0);
+
+		ImGui::TableNextRow();
+		ImGui::TableNextColumn();
+		ImGui::TableNextColumn();
+		if (ImGui::Button("Benchmark Noise"))
+		{
+			m_streamer->getGenerator().benchmark();
+		}
+
+		if (noise_changed)
+		{
+			regenerate();
+		}
+
+		ImGui::TableNextRow();
+		ImGui::TableNextColumn();
+		ImGui::AlignTextToFramePadding();
+		ImGui::Text("LOD Distance");
+		ImGui::TableNextColumn();
+		id_size = "##lod";
+		ImGui::SliderFloat(id_size.c_str(), &m_lod_distance, 5.0f, 20.0f, "%.1f", 0);
+
+		ImGui::TableNextRow();
+		ImGui::TableNextColumn();
+		ImGui::AlignTextToFramePadding();
+		ImGui::Text("Triangle Size");
+		ImGui::TableNextColumn();
+		id_size = "##triangle";
+		ImGui::SliderFloat(id_size.c_str(), &m_triangle_size, 4.0f, 64.0f, "%.0f px", 0);
+
+		ImGui::TableNextRow();
+		ImGui::TableNextColumn();
+		ImGui::AlignTextToFramePadding();
+		ImGui::Text("Tiles");
+		ImGui::TableNextColumn();
+		ImGui::Text("%d resident, %d drawn, %d loading",
+			m_streamer->getNumResident(), int(m_selected.size()), m_streamer->getNumPending());
+
+		ImGui::TableNextRow();
+		ImGui::TableNextColumn();
+		ImGui::AlignTextToFramePadding();
+		ImGui::Text("Brush");
+		ImGui::TableNextColumn();
+		id_size = "##brush";
+		ImGui::Combo(id_size.c_str(), &m_brush, "Sculpt\0Hydraulic\0Thermal\0Vegetation\0");
+
+		ImGui::TableNextRow();
+		ImGui::TableNextColumn();
+		ImGui::AlignTextToFramePadding();
+		ImGui::Text("Vegetation");
+		ImGui::TableNextColumn();
+		ImGui::Checkbox("##scatter", &m_is_scatter);
+		ImGui::SameLine();
+		id_size = "##scatter_layer";
+		string layers;
+		for (int i = 0; i < m_scatter->getNumLayers(); ++i)
+		{
+			layers += m_scatter->getLayerName(i) + '\0';
+		}
+		ImGui::Combo(id_size.c_str(), &m_scatter_layer, layers.c_str());
+
+		ImGui::TableNextRow();
+		ImGui::TableNextColumn();
+		ImGui::AlignTextToFramePadding();
+		ImGui::Text("Instances");
+		ImGui::TableNextColumn();
+		ImGui::Text("%d scattered, %d cells drawn", m_scatter->getNumInstances(), m_scatter->getNumCells());
+
+		ImGui::TableNextRow();
+		ImGui::TableNextColumn();
+		ImGui::AlignTextToFramePadding();
+		ImGui::Text("Talus");
+		ImGui::TableNextColumn();
+		id_size = "##talus";
+		ImGui::SliderFloat(id_size.c_str(), &m_erosion_settings.talus, 0.1f, 2.0f, "%.2f", 0);
+
+		ImGui::TableNextRow();
+		ImGui::TableNextColumn();
+		ImGui::AlignTextToFramePadding();
+		ImGui::Text("Erosion");
+		ImGui::TableNextColumn();
+		if (m_erosion == nullptr)
+		{
+			if (ImGui::Button("Erode"))
+			{
+				startErosion();
+			}
+		}
+		else
+		{
+			// Waiting for tiles shows as no progress
+			float progress = m_erosion->progress.value;
+			ImGui::ProgressBar(progress, ImVec2(-1.0f, 0.0f));
+			if (ImGui::Button("Cancel"))
+			{
+				m_erosion->progress.cancel = true;
+			}
+		}
+
+		ImGui::TableNextRow();
+		ImGui::TableNextColumn();
+		ImGui::AlignTextToFramePadding();
+		ImGui::Text("History");
+		ImGui::TableNextColumn();
+		if (ImGui::Button("Undo") && m_history->getNumUndo() > 0)
+		{
+			m_history_step = -1;
+		}
+		ImGui::SameLine();
+		if (ImGui::Button("Redo") && m_history->getNumRedo() > 0)
+		{
+			m_history_step = 1;
+		}
+		ImGui::SameLine();
+		ImGui::Text("%d / %d, %.1f MB", m_history->getNumUndo(), m_history->getNumRedo(),
+			float(m_history->getBytes()) / float(1 << 20));
+
+		ImGui::TableNextRow();
+		ImGui::TableNextColumn();
+		ImGui::TableNextColumn();
+		if (ImGui::Button("Save"))
+		{
+			m_streamer->flush();
+		}
+
 		ImGui::Dummy(ImVec2(0.0f, 5.0f));
 
 		ImGui::TableNextRow();
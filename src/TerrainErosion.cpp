@@ -0,0 +1,286 @@
+#include "TerrainErosion.h"
+
+#include <algorithm>
+#include <random>
+
+#include "Parallel.h"
+
+namespace
+{
+	// Blocks of the hydraulic pass and the halo their droplets may reach, two halos fit between blocks of one color
+	const int BLOCK = 64;
+	const int HALO = BLOCK / 2;
+
+	// Rounds of the hydraulic pass, progress and cancellation are checked between them
+	const int ROUNDS = 32;
+}
+
+TerrainErosion::TerrainErosion(vector<float>& heights, int width, int depth, float spacing) :
+	m_heights(heights), m_brush_radius(-1), m_width(width), m_depth(depth), m_spacing(spacing)
+{
+}
+
+float TerrainErosion::sample(const glm::vec2& pos, glm::vec2& gradient) const
+{
+	int x = int(pos.x);
+	int z = int(pos.y);
+	float u = pos.x - x;
+	float v = pos.y - z;
+
+	int i = x + m_width * z;
+	float h00 = m_heights[i];
+	float h10 = m_heights[i + 1];
+	float h01 = m_heights[i + m_width];
+	float h11 = m_heights[i + m_width + 1];
+
+	gradient.x = (h10 - h00) * (1.0f - v) + (h11 - h01) * v;
+	gradient.y = (h01 - h00) * (1.0f - u) + (h11 - h10) * u;
+
+	return h00 * (1.0f - u) * (1.0f - v) + h10 * u * (1.0f - v) + h01 * (1.0f - u) * v + h11 * u * v;
+}
+
+void TerrainErosion::runDroplet(const ErosionSettings& settings, glm::vec2 pos, const Bounds& bounds)
+{
+	// Sediment and height differences are in units of the relief, written back in heights
+	float relief = max(settings.relief, 1.0e-6f);
+	float inv_relief = 1.0f / relief;
+
+	glm::vec2 dir(0.0f);
+	float speed = 1.0f;
+	float water = 1.0f;
+	float sediment = 0.0f;
+
+	// The brush and the bilinear cell must stay inside the bounds
+	int r = m_brush_radius;
+	float lo_x = float(bounds.x0 + r);
+	float lo_z = float(bounds.z0 + r);
+	float hi_x = float(bounds.x1 - r - 1);
+	float hi_z = float(bounds.z1 - r - 1);
+	if (pos.x < lo_x || pos.y < lo_z || pos.x >= hi_x || pos.y >= hi_z) return;
+
+	// Whatever a droplet still carries settles where it stops, so a pass moves material instead of losing it
+	int x = int(pos.x);
+	int z = int(pos.y);
+	glm::vec2 cell = pos - glm::vec2(x, z);
+	auto deposit = [&](float amount)
+		{
+			int i = x + m_width * z;
+			float h = amount * relief;
+			m_heights[i] += h * (1.0f - cell.x) * (1.0f - cell.y);
+			m_heights[i + 1] += h * cell.x * (1.0f - cell.y);
+			m_heights[i + m_width] += h * (1.0f - cell.x) * cell.y;
+			m_heights[i + m_width + 1] += h * cell.x * cell.y;
+		};
+
+	for (int step = 0; step < settings.lifetime; ++step)
+	{
+		x = int(pos.x);
+		z = int(pos.y);
+		cell = pos - glm::vec2(x, z);
+
+		glm::vec2 gradient;
+		float h = sample(pos, gradient) * inv_relief;
+		gradient *= inv_relief;
+
+		dir = dir * settings.inertia - gradient * (1.0f - settings.inertia);
+		float len = glm::length(dir);
+		if (len < 1.0e-6f) break;
+
+		dir /= len;
+		pos += dir;
+		if (pos.x < lo_x || pos.y < lo_z || pos.x >= hi_x || pos.y >= hi_z) break;
+
+		glm::vec2 unused;
+		float dh = sample(pos, unused) * inv_relief - h;
+
+		// Faster and fuller droplets going downhill carry more
+		float capacity = max(-dh * speed * water * settings.capacity, settings.min_capacity);
+		if (sediment > capacity || dh > 0.0f)
+		{
+			// Uphill the droplet fills the pit behind it, otherwise it drops its excess
+			float amount = dh > 0.0f ? min(dh, sediment) : (sediment - capacity) * settings.deposit_rate;
+			sediment -= amount;
+			deposit(amount);
+		}
+		else
+		{
+			// Never dig deeper than the height just lost, or the droplet carves holes
+			float amount = min((capacity - sediment) * settings.erode_rate, -dh);
+			for (int k = 0; k < m_brush_offsets.size(); ++k)
+			{
+				int j = (x + m_brush_offsets[k].x) + m_width * (z + m_brush_offsets[k].y);
+				float eroded = amount * m_brush_weights[k];
+				m_heights[j] -= eroded * relief;
+				sediment += eroded;
+			}
+		}
+
+		speed = glm::sqrt(max(speed * speed - dh * settings.gravity, 0.0f));
+		water *= 1.0f - settings.evaporate_rate;
+	}
+
+	deposit(sediment);
+}
+
+bool TerrainErosion::hydraulic(const ErosionSettings& settings, int droplets, int x0, int z0, int x1, int z1, uint32_t seed,
+	ErosionProgress* progress, float begin, float end)
+{
+	x0 = max(x0, 0);
+	z0 = max(z0, 0);
+	x1 = min(x1, m_width - 1);
+	z1 = min(z1, m_depth - 1);
+	if (x1 <= x0 || z1 <= z0 || droplets <= 0) return true;
+
+	// Weights fall off linearly from the droplet
+	if (m_brush_radius != settings.radius)
+	{
+		m_brush_radius = max(settings.radius, 0);
+		m_brush_offsets.clear();
+		m_brush_weights.clear();
+
+		float total = 0.0f;
+		for (int z = -m_brush_radius; z <= m_brush_radius; ++z)
+		{
+			for (int x = -m_brush_radius; x <= m_brush_radius; ++x)
+			{
+				float w = float(m_brush_radius) + 1.0f - glm::sqrt(float(x * x + z * z));
+				if (w <= 0.0f) continue;
+
+				m_brush_offsets.push_back(glm::ivec2(x, z));
+				m_brush_weights.push_back(w);
+				total += w;
+			}
+		}
+
+		for (float& w : m_brush_weights) w /= total;
+	}
+
+	int blocks_x = (x1 - x0 + BLOCK - 1) / BLOCK;
+	int blocks_z = (z1 - z0 + BLOCK - 1) / BLOCK;
+	float area = float((x1 - x0) * (z1 - z0));
+
+	// Blocks of one color are two blocks apart
+	vector<vector<int>> colors(4);
+	for (int bz = 0; bz < blocks_z; ++bz)
+	{
+		for (int bx = 0; bx < blocks_x; ++bx)
+		{
+			colors[(bx & 1) + 2 * (bz & 1)].push_back(bx + blocks_x * bz);
+		}
+	}
+
+	for (int round = 0; round < ROUNDS; ++round)
+	{
+		if (progress != nullptr && progress->cancel) return false;
+
+		for (const vector<int>& blocks : colors)
+		{
+			parallel::forEach(int(blocks.size()),
+				[&](int i)
+				{
+					int b = blocks[i];
+					Bounds spawn;
+					spawn.x0 = x0 + (b % blocks_x) * BLOCK;
+					spawn.z0 = z0 + (b / blocks_x) * BLOCK;
+					spawn.x1 = min(spawn.x0 + BLOCK, x1);
+					spawn.z1 = min(spawn.z0 + BLOCK, z1);
+
+					// The border samples of the grid stay out of reach
+					Bounds bounds;
+					bounds.x0 = max(spawn.x0 - HALO, 1);
+					bounds.z0 = max(spawn.z0 - HALO, 1);
+					bounds.x1 = min(spawn.x1 + HALO, m_width - 1);
+					bounds.z1 = min(spawn.z1 + HALO, m_depth - 1);
+
+					// Droplets of a round are shared by area, the last round takes the remainder
+					float share = float((spawn.x1 - spawn.x0) * (spawn.z1 - spawn.z0)) / area;
+					int count = int(float(droplets) * share / float(ROUNDS));
+					if (round == ROUNDS - 1) count = int(float(droplets) * share) - count * (ROUNDS - 1);
+
+					mt19937 rng(seed ^ (uint32_t(b) * 2654435761u) ^ (uint32_t(round) * 40503u));
+					uniform_real_distribution<float> rx(float(spawn.x0), float(spawn.x1));
+					uniform_real_distribution<float> rz(float(spawn.z0), float(spawn.z1));
+					for (int d = 0; d < count; ++d)
+					{
+						runDroplet(settings, glm::vec2(rx(rng), rz(rng)), bounds);
+					}
+				}, 1);
+		}
+
+		if (progress != nullptr) progress->value = begin + (end - begin) * float(round + 1) / float(ROUNDS);
+	}
+
+	return true;
+}
+
+bool TerrainErosion::thermal(const ErosionSettings& settings, int iterations,
+	ErosionProgress* progress, float begin, float end)
+{
+	if (m_width < 3 || m_depth < 3) return true;
+
+	const int dx[4] = { -1, 1, 0, 0 };
+	const int dz[4] = { 0, 0, -1, 1 };
+	float talus = settings.talus * m_spacing;
+
+	m_outflow.assign(m_heights.size(), glm::vec4(0.0f));
+	for (int it = 0; it < iterations; ++it)
+	{
+		if (progress != nullptr && progress->cancel) return false;
+
+		// Every sample decides what it sends to its lower neighbours, border samples neither send nor receive
+		parallel::forEach(m_depth - 2,
+			[&](int row)
+			{
+				int z = row + 1;
+				for (int x = 1; x < m_width - 1; ++x)
+				{
+					int i = x + m_width * z;
+					float h = m_heights[i];
+
+					glm::vec4 excess(0.0f);
+					float total = 0.0f;
+					float steepest = 0.0f;
+					for (int k = 0; k < 4; ++k)
+					{
+						int nx = x + dx[k];
+						int nz = z + dz[k];
+						if (nx <= 0 || nz <= 0 || nx >= m_width - 1 || nz >= m_depth - 1) continue;
+
+						float d = h - m_heights[nx + m_width * nz];
+						if (d <= talus) continue;
+
+						excess[k] = d - talus;
+						total += excess[k];
+						steepest = max(steepest, d);
+					}
+
+					// Half the excess at most, so the sample never ends up below the neighbour it fed
+					float moved = total > 0.0f ? settings.thermal_rate * 0.5f * (steepest - talus) : 0.0f;
+					m_outflow[i] = total > 0.0f ? excess * (moved / total) : glm::vec4(0.0f);
+				}
+			}, 16);
+
+		// Then gathers what its neighbours sent it, this pass is the exchange across block borders
+		parallel::forEach(m_depth - 2,
+			[&](int row)
+			{
+				int z = row + 1;
+				for (int x = 1; x < m_width - 1; ++x)
+				{
+					int i = x + m_width * z;
+					const glm::vec4& out = m_outflow[i];
+					float h = m_heights[i] - (out.x + out.y + out.z + out.w);
+
+					h += m_outflow[i - 1][1];
+					h += m_outflow[i + 1][0];
+					h += m_outflow[i - m_width][3];
+					h += m_outflow[i + m_width][2];
+					m_heights[i] = h;
+				}
+			}, 16);
+
+		if (progress != nullptr) progress->value = begin + (end - begin) * float(it + 1) / float(iterations);
+	}
+
+	return true;
+}
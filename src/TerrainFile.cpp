@@ -0,0 +1,290 @@
+#include "TerrainFile.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+	const uint32_t TERRAIN_FILE_MAGIC = 0x54455252; // "TERR"
+	const uint32_t TERRAIN_FILE_VERSION = 1;
+
+	// Height precision, a power of two so snapped heights and their steps convert exactly
+	const float STEP = 1.0f / 1024.0f;
+	const float INV_STEP = 1024.0f;
+
+	// Steps stay exact floats below 2^24
+	const float MAX_HEIGHT = 16384.0f;
+
+	// Records get some room to grow, a tile edited again usually compresses a little worse
+	const uint32_t RECORD_ALIGN = 256;
+}
+
+TerrainFile::TerrainFile(const string& path, int num_tiles, int num_levels, int tile_res) :
+	m_path(path), m_tile_res(tile_res), m_num_written(0), m_is_valid(false)
+{
+	int num_entries = 0;
+	for (int level = 0; level < num_levels; ++level)
+	{
+		int n = max(num_tiles >> level, 1);
+		m_level_start.push_back(num_entries);
+		num_entries += n * n;
+	}
+
+	m_header.magic = TERRAIN_FILE_MAGIC;
+	m_header.version = TERRAIN_FILE_VERSION;
+	m_header.num_tiles = num_tiles;
+	m_header.num_levels = num_levels;
+	m_header.tile_res = tile_res;
+	m_header.step = STEP;
+	m_header.end = sizeof(Header) + num_entries * sizeof(Entry);
+
+	Entry empty;
+	memset(&empty, 0, sizeof(Entry));
+	m_entries.assign(num_entries, empty);
+
+	m_map = make_unique<MappedFile>(m_path);
+	if (m_map->getData() == nullptr) return;
+
+	Header header;
+	if (m_map->getSize() >= m_header.end) memcpy(&header, m_map->getData(), sizeof(Header));
+	if (m_map->getSize() < m_header.end ||
+		header.magic != m_header.magic || header.version != m_header.version ||
+		header.num_tiles != m_header.num_tiles || header.num_levels != m_header.num_levels ||
+		header.tile_res != m_header.tile_res || header.step != m_header.step)
+	{
+		cout << "Ignore stale terrain file " << m_path << endl;
+		return;
+	}
+
+	memcpy(m_entries.data(), m_map->getData() + sizeof(Header), num_entries * sizeof(Entry));
+	m_header.end = header.end;
+	m_is_valid = true;
+}
+
+float TerrainFile::quantize(float h)
+{
+	if (!(fabs(h) < MAX_HEIGHT)) return h;
+	return float(llround(h * INV_STEP)) * STEP;
+}
+
+int TerrainFile::getIndex(int level, int x, int z) const
+{
+	if (level < 0 || level >= int(m_level_start.size())) return -1;
+
+	int n = max(m_header.num_tiles >> level, 1);
+	if (x < 0 || z < 0 || x >= n || z >= n) return -1;
+
+	return m_level_start[level] + x + n * z;
+}
+
+bool TerrainFile::create()
+{
+	error_code ec;
+	filesystem::path parent = filesystem::path(m_path).parent_path();
+	if (!parent.empty()) filesystem::create_directories(parent, ec);
+
+	ofstream file(m_path, ios::binary | ios::trunc);
+	if (!file) return false;
+
+	Entry empty;
+	memset(&empty, 0, sizeof(Entry));
+	m_entries.assign(m_entries.size(), empty);
+	m_header.end = sizeof(Header) + m_entries.size() * sizeof(Entry);
+
+	file.write((const char*)&m_header, sizeof(Header));
+	file.write((const char*)m_entries.data(), m_entries.size() * sizeof(Entry));
+
+	m_is_valid = bool(file);
+	return m_is_valid;
+}
+
+void TerrainFile::encode(const vector<float>& heights, vector<uint8_t>& record, Entry& entry) const
+{
+	float lo = FLT_MAX;
+	float hi = -FLT_MAX;
+	for (float h : heights)
+	{
+		lo = min(lo, h);
+		hi = max(hi, h);
+	}
+
+	record.clear();
+
+	// NaN fails both comparisons and ends up raw as well
+	bool is_exact = fabs(lo) < MAX_HEIGHT && fabs(hi) < MAX_HEIGHT;
+	if (!is_exact || llround(hi * INV_STEP) - llround(lo * INV_STEP) > 0xFFFF)
+	{
+		entry.encoding = ENCODING_RAW;
+		entry.min = lo;
+		entry.max = hi;
+		record.resize(heights.size() * sizeof(float));
+		memcpy(record.data(), heights.data(), record.size());
+		return;
+	}
+
+	long long k_lo = llround(lo * INV_STEP);
+	entry.encoding = ENCODING_DELTA;
+	entry.min = float(k_lo) * STEP;
+	entry.max = float(llround(hi * INV_STEP)) * STEP;
+
+	int res = m_tile_res;
+	vector<int32_t> q(heights.size());
+	for (size_t i = 0; i < heights.size(); ++i)
+	{
+		q[i] = int32_t(llround(heights[i] * INV_STEP) - k_lo);
+	}
+
+	// Planar prediction from the left, upper and upper left samples, residuals zigzagged into 7 bit groups
+	record.reserve(heights.size() + heights.size() / 4);
+	for (int z = 0; z < res; ++z)
+	{
+		for (int x = 0; x < res; ++x)
+		{
+			int i = x + res * z;
+			int32_t predicted = 0;
+			if (x > 0 && z > 0) predicted = q[i - 1] + q[i - res] - q[i - res - 1];
+			else if (x > 0) predicted = q[i - 1];
+			else if (z > 0) predicted = q[i - res];
+
+			int32_t r = q[i] - predicted;
+			uint32_t u = (uint32_t(r) << 1) ^ uint32_t(r >> 31);
+			while (u >= 0x80)
+			{
+				record.push_back(uint8_t(u | 0x80));
+				u >>= 7;
+			}
+			record.push_back(uint8_t(u));
+		}
+	}
+}
+
+bool TerrainFile::decode(const uint8_t* record, const Entry& entry, vector<float>& heights) const
+{
+	int res = m_tile_res;
+	heights.resize(res * res);
+
+	if (entry.encoding == ENCODING_RAW)
+	{
+		if (entry.size != heights.size() * sizeof(float)) return false;
+		memcpy(heights.data(), record, entry.size);
+		return true;
+	}
+
+	if (entry.encoding != ENCODING_DELTA) return false;
+
+	long long k_lo = llround(entry.min * INV_STEP);
+	vector<int32_t> q(heights.size());
+	uint32_t pos = 0;
+	for (int z = 0; z < res; ++z)
+	{
+		for (int x = 0; x < res; ++x)
+		{
+			uint32_t u = 0;
+			for (int shift = 0; ; shift += 7)
+			{
+				if (pos >= entry.size || shift > 28) return false;
+
+				uint8_t byte = record[pos++];
+				u |= uint32_t(byte & 0x7F) << shift;
+				if ((byte & 0x80) == 0) break;
+			}
+
+			int i = x + res * z;
+			int32_t predicted = 0;
+			if (x > 0 && z > 0) predicted = q[i - 1] + q[i - res] - q[i - res - 1];
+			else if (x > 0) predicted = q[i - 1];
+			else if (z > 0) predicted = q[i - res];
+
+			q[i] = predicted + (int32_t(u >> 1) ^ -int32_t(u & 1));
+			if (q[i] < 0 || q[i] > 0xFFFF) return false;
+
+			heights[i] = float(k_lo + q[i]) * STEP;
+		}
+	}
+
+	return pos == entry.size;
+}
+
+bool TerrainFile::read(int level, int x, int z, vector<float>& heights)
+{
+	int i = getIndex(level, x, z);
+	if (i < 0 || !m_is_valid) return false;
+
+	const Entry& entry = m_entries[i];
+	if (entry.encoding == ENCODING_NONE) return false;
+
+	if (m_map == nullptr) m_map = make_unique<MappedFile>(m_path);
+	if (m_map->getData() == nullptr || entry.offset + entry.size > m_map->getSize())
+	{
+		cout << "Terrain tile " << level << " " << x << " " << z << " is past the end of " << m_path << endl;
+		return false;
+	}
+
+	vector<float> decoded;
+	if (!decode((const uint8_t*)m_map->getData() + entry.offset, entry, decoded))
+	{
+		cout << "Terrain tile " << level << " " << x << " " << z << " is corrupt in " << m_path << endl;
+		return false;
+	}
+
+	heights = move(decoded);
+	return true;
+}
+
+void TerrainFile::write(int level, int x, int z, const vector<float>& heights)
+{
+	int i = getIndex(level, x, z);
+	if (i < 0 || heights.size() != size_t(m_tile_res * m_tile_res)) return;
+
+	// The mapping would keep the file from being written on Windows
+	m_map.reset();
+
+	if (!m_is_valid && !create())
+	{
+		cout << "Failed to create terrain file " << m_path << endl;
+		return;
+	}
+
+	Entry entry = m_entries[i];
+	vector<uint8_t> record;
+	encode(heights, record, entry);
+
+	Header header = m_header;
+	if (record.size() > entry.capacity)
+	{
+		entry.offset = header.end;
+		entry.capacity = uint32_t((record.size() + RECORD_ALIGN - 1) / RECORD_ALIGN * RECORD_ALIGN);
+		header.end += entry.capacity;
+	}
+	entry.size = uint32_t(record.size());
+
+	fstream file(m_path, ios::in | ios::out | ios::binary);
+	if (!file)
+	{
+		cout << "Failed to open terrain file " << m_path << endl;
+		return;
+	}
+
+	// The index only points at a record once all of it is on disk
+	file.seekp(entry.offset);
+	file.write((const char*)record.data(), record.size());
+	file.seekp(sizeof(Header) + i * sizeof(Entry));
+	file.write((const char*)&entry, sizeof(Entry));
+	file.seekp(0);
+	file.write((const char*)&header, sizeof(Header));
+
+	if (!file)
+	{
+		cout << "Failed to write terrain tile " << level << " " << x << " " << z << " to " << m_path << endl;
+		return;
+	}
+
+	m_header = header;
+	m_entries[i] = entry;
+	m_num_written++;
+}
@@ -0,0 +1,214 @@
+#include "TerrainGenerator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+#include <glm/glm.hpp>
+
+#include "Parallel.h"
+#include "TerrainFile.h"
+
+namespace
+{
+	const int MAX_OCTAVES = 12;
+}
+
+TerrainGenerator::TerrainGenerator(int tile_cells, int max_cached) :
+	m_version(0), m_tile_cells(tile_cells), m_max_cached(max_cached), m_clock(0)
+{
+	m_layers = createLayers(m_noise);
+}
+
+uint64_t TerrainGenerator::getKey(int level, int x, int z)
+{
+	return (uint64_t(level) << 56) | (uint64_t(uint32_t(x) & 0xFFFFFFF) << 28) | uint64_t(uint32_t(z) & 0xFFFFFFF);
+}
+
+vector<FastNoiseLite> TerrainGenerator::createLayers(const TerrainNoise& noise)
+{
+	// Octave i doubles the frequency and takes its own seed, the same split FastNoiseLite's FBm does internally
+	vector<FastNoiseLite> layers(MAX_OCTAVES);
+	for (int i = 0; i < MAX_OCTAVES; ++i)
+	{
+		layers[i].SetSeed(1337 + i);
+		layers[i].SetNoiseType(FastNoiseLite::NoiseType_OpenSimplex2);
+		layers[i].SetFrequency(noise.frequency * float(1 << i));
+	}
+
+	return layers;
+}
+
+int TerrainGenerator::setNoise(const TerrainNoise& noise)
+{
+	lock_guard<mutex> lock(m_mutex);
+
+	TerrainNoise next = noise;
+	next.octaves = glm::clamp(next.octaves, 1, MAX_OCTAVES);
+	if (next.frequency == m_noise.frequency && next.octaves == m_noise.octaves && next.amplitude == m_noise.amplitude)
+	{
+		return m_version;
+	}
+
+	// Cached layers only depend on the frequency
+	if (next.frequency != m_noise.frequency)
+	{
+		m_cache.clear();
+		m_layers = createLayers(next);
+	}
+
+	m_noise = next;
+	return ++m_version;
+}
+
+TerrainNoise TerrainGenerator::getNoise() const
+{
+	lock_guard<mutex> lock(m_mutex);
+	return m_noise;
+}
+
+int TerrainGenerator::getVersion() const
+{
+	lock_guard<mutex> lock(m_mutex);
+	return m_version;
+}
+
+void TerrainGenerator::evaluate(const vector<FastNoiseLite>& layers, int first, int last,
+	int gx0, int gz0, int step, int res, vector<vector<float>>& values)
+{
+	for (int i = first; i < last; ++i)
+	{
+		values[i].resize(res * res);
+	}
+
+	// One task per row and octave, each row is a contiguous run of samples
+	int rows = last - first;
+	parallel::forEach(rows * res,
+		[&](int task)
+		{
+			int octave = first + task / res;
+			int z = task % res;
+
+			const FastNoiseLite& noise = layers[octave];
+			float* row = values[octave].data() + res * z;
+			float gz = float(gz0 + z * step);
+			for (int x = 0; x < res; ++x)
+			{
+				row[x] = noise.GetNoise(float(gx0 + x * step), gz);
+			}
+		}, 16);
+}
+
+void TerrainGenerator::sum(const vector<vector<float>>& values, const TerrainNoise& noise, vector<float>& heights)
+{
+	int n = int(values[0].size());
+	heights.assign(n, 0.0f);
+
+	// Gain of one half per octave, normalised so the sum stays within the amplitude
+	float weight = 1.0f;
+	float total = 0.0f;
+	for (int i = 0; i < noise.octaves; ++i)
+	{
+		total += weight;
+		weight *= 0.5f;
+	}
+
+	weight = noise.amplitude / total;
+	for (int i = 0; i < noise.octaves; ++i)
+	{
+		const float* layer = values[i].data();
+		float* h = heights.data();
+		for (int j = 0; j < n; ++j)
+		{
+			h[j] += weight * layer[j];
+		}
+		weight *= 0.5f;
+	}
+
+	// On the grid the terrain file stores, saved tiles then match their generated neighbours exactly
+	for (float& h : heights)
+	{
+		h = TerrainFile::quantize(h);
+	}
+}
+
+void TerrainGenerator::generate(int gx0, int gz0, int step, int res, vector<float>& heights) const
+{
+	vector<FastNoiseLite> layers;
+	TerrainNoise noise;
+	{
+		lock_guard<mutex> lock(m_mutex);
+		layers = m_layers;
+		noise = m_noise;
+	}
+
+	vector<vector<float>> values(noise.octaves);
+	evaluate(layers, 0, noise.octaves, gx0, gz0, step, res, values);
+	sum(values, noise, heights);
+}
+
+void TerrainGenerator::benchmark() const
+{
+	TerrainNoise noise = getNoise();
+
+	cout << endl;
+	cout << "*************************Noise Benchmark**************************" << endl;
+	cout << "Octaves : " << noise.octaves << ", threads : " << max(1, int(thread::hardware_concurrency())) << endl;
+
+	vector<float> heights;
+	for (int res : { 1024, 2048, 4096 })
+	{
+		auto start = chrono::high_resolution_clock::now();
+		generate(0, 0, 1, res, heights);
+		auto end = chrono::high_resolution_clock::now();
+
+		double ms = chrono::duration<double, milli>(end - start).count();
+		cout << "Field " << res << "x" << res << " : " << ms << " ms, "
+			 << (double(res) * res / ms / 1000.0) << " M samples/s" << endl;
+	}
+
+	cout << "*********************************end**********************************" << endl;
+	cout << endl;
+}
+
+void TerrainGenerator::generateTile(int level, int x, int z, vector<float>& heights, int& version)
+{
+	vector<FastNoiseLite> layers;
+	TerrainNoise noise;
+	shared_ptr<Entry> entry;
+	{
+		lock_guard<mutex> lock(m_mutex);
+		layers = m_layers;
+		noise = m_noise;
+		version = m_version;
+
+		shared_ptr<Entry>& slot = m_cache[getKey(level, x, z)];
+		if (slot == nullptr) slot = make_shared<Entry>();
+		entry = slot;
+		entry->last_used = ++m_clock;
+
+		// Least recently generated tiles go first
+		if (int(m_cache.size()) > m_max_cached)
+		{
+			auto oldest = m_cache.end();
+			for (auto it = m_cache.begin(); it != m_cache.end(); ++it)
+			{
+				if (oldest == m_cache.end() || it->second->last_used < oldest->second->last_used) oldest = it;
+			}
+			m_cache.erase(oldest);
+		}
+	}
+
+	// Only the octaves missing from the cache are evaluated
+	lock_guard<mutex> lock(entry->lock);
+	int cached = int(entry->layers.size());
+	if (cached < noise.octaves)
+	{
+		int step = 1 << level;
+		entry->layers.resize(noise.octaves);
+		evaluate(layers, cached, noise.octaves, x * m_tile_cells * step, z * m_tile_cells * step, step, m_tile_cells + 1, entry->layers);
+	}
+
+	sum(entry->layers, noise, heights);
+}
@@ -0,0 +1,197 @@
+#include "TerrainHistory.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "TerrainStreamer.h"
+
+namespace
+{
+	inline uint32_t getBits(float f)
+	{
+		uint32_t bits;
+		memcpy(&bits, &f, sizeof(float));
+		return bits;
+	}
+
+	inline float getFloat(uint32_t bits)
+	{
+		float f;
+		memcpy(&f, &bits, sizeof(float));
+		return f;
+	}
+}
+
+TerrainHistory::TerrainHistory(int tile_res, size_t max_bytes) :
+	m_bytes(0), m_max_bytes(max_bytes), m_tile_res(tile_res), m_is_recording(false)
+{
+}
+
+void TerrainHistory::begin()
+{
+	if (m_is_recording) return;
+
+	m_is_recording = true;
+	m_snapshots.clear();
+}
+
+void TerrainHistory::touch(const shared_ptr<TerrainTile>& tile)
+{
+	if (!m_is_recording) return;
+
+	uint64_t key = (uint64_t(uint32_t(tile->x)) << 32) | uint64_t(uint32_t(tile->z));
+	if (m_snapshots.find(key) != m_snapshots.end()) return;
+
+	Snapshot& snapshot = m_snapshots[key];
+	snapshot.tile = tile;
+	snapshot.heights = tile->heights;
+}
+
+bool TerrainHistory::diff(const Snapshot& snapshot, TileDelta& delta) const
+{
+	const vector<float>& before = snapshot.heights;
+	const vector<float>& after = snapshot.tile->heights;
+	int res = m_tile_res;
+
+	// Rectangle of the samples that changed
+	delta.x0 = res;
+	delta.z0 = res;
+	delta.x1 = -1;
+	delta.z1 = -1;
+	for (int z = 0; z < res; ++z)
+	{
+		for (int x = 0; x < res; ++x)
+		{
+			int i = x + res * z;
+			if (getBits(before[i]) == getBits(after[i])) continue;
+
+			delta.x0 = min(delta.x0, x);
+			delta.z0 = min(delta.z0, z);
+			delta.x1 = max(delta.x1, x);
+			delta.z1 = max(delta.z1, z);
+		}
+	}
+
+	if (delta.x1 < 0) return false;
+
+	delta.x = snapshot.tile->x;
+	delta.z = snapshot.tile->z;
+	delta.packed.clear();
+
+	// Brush falloff leaves most of the rectangle unchanged, those samples become zero runs
+	uint32_t zeros = 0;
+	vector<uint32_t> literals;
+	auto flush = [&]()
+		{
+			delta.packed.push_back(zeros);
+			delta.packed.push_back(uint32_t(literals.size()));
+			delta.packed.insert(delta.packed.end(), literals.begin(), literals.end());
+			zeros = 0;
+			literals.clear();
+		};
+
+	for (int z = delta.z0; z <= delta.z1; ++z)
+	{
+		for (int x = delta.x0; x <= delta.x1; ++x)
+		{
+			int i = x + res * z;
+			uint32_t bits = getBits(before[i]) ^ getBits(after[i]);
+			if (bits == 0)
+			{
+				if (!literals.empty()) flush();
+				zeros++;
+			}
+			else
+			{
+				literals.push_back(bits);
+			}
+		}
+	}
+
+	if (zeros > 0 || !literals.empty()) flush();
+
+	delta.packed.shrink_to_fit();
+	return true;
+}
+
+void TerrainHistory::end()
+{
+	if (!m_is_recording) return;
+	m_is_recording = false;
+
+	TerrainStroke stroke;
+	for (const auto& it : m_snapshots)
+	{
+		TileDelta delta;
+		if (!diff(it.second, delta)) continue;
+
+		stroke.bytes += sizeof(TileDelta) + delta.packed.size() * sizeof(uint32_t);
+		stroke.tiles.push_back(move(delta));
+	}
+	m_snapshots.clear();
+
+	if (stroke.tiles.empty()) return;
+
+	// A new stroke branches off, what could be redone is gone
+	for (const TerrainStroke& redo : m_redo) m_bytes -= redo.bytes;
+	m_redo.clear();
+
+	m_bytes += stroke.bytes;
+	m_undo.push_back(move(stroke));
+	trim();
+}
+
+void TerrainHistory::trim()
+{
+	// Keeps at least the latest stroke, however large
+	while (m_bytes > m_max_bytes && m_undo.size() > 1)
+	{
+		m_bytes -= m_undo.front().bytes;
+		m_undo.pop_front();
+	}
+}
+
+void TerrainHistory::popUndo()
+{
+	if (m_undo.empty()) return;
+
+	m_redo.push_back(move(m_undo.back()));
+	m_undo.pop_back();
+}
+
+void TerrainHistory::popRedo()
+{
+	if (m_redo.empty()) return;
+
+	m_undo.push_back(move(m_redo.back()));
+	m_redo.pop_back();
+}
+
+void TerrainHistory::clear()
+{
+	m_undo.clear();
+	m_redo.clear();
+	m_snapshots.clear();
+	m_bytes = 0;
+	m_is_recording = false;
+}
+
+void TerrainHistory::apply(const TileDelta& delta, vector<float>& heights) const
+{
+	int width = delta.x1 - delta.x0 + 1;
+	int sample = 0;
+	size_t i = 0;
+	while (i < delta.packed.size())
+	{
+		sample += int(delta.packed[i++]);
+
+		uint32_t count = delta.packed[i++];
+		for (uint32_t j = 0; j < count; ++j, ++sample)
+		{
+			int x = delta.x0 + sample % width;
+			int z = delta.z0 + sample / width;
+			float& h = heights[x + m_tile_res * z];
+			h = getFloat(getBits(h) ^ delta.packed[i++]);
+		}
+	}
+}
@@ -0,0 +1,507 @@
+#include "TerrainScatter.h"
+
+#include <algorithm>
+#include <random>
+
+#include <glm/gtc/constants.hpp>
+
+#include "FastNoiseLite.h"
+#include "HeightMap.h"
+#include "Mesh.h"
+#include "Parallel.h"
+#include "Shader.h"
+#include "ShaderManager.h"
+#include "TerrainStreamer.h"
+
+namespace
+{
+	// Density samples along a tile
+	const int DENSITY_CELLS = 8;
+
+	// Visible instances one layer and LOD can draw, those past it are dropped by the cull
+	const int VISIBLE_CAPACITY = 1 << 15;
+
+	const int MAX_LODS = 4;
+
+	bool isBoxVisible(const array<glm::vec4, 6>& planes, const glm::vec3& b_min, const glm::vec3& b_max)
+	{
+		for (const auto& plane : planes)
+		{
+			glm::vec3 p(
+				plane.x > 0.0f ? b_max.x : b_min.x,
+				plane.y > 0.0f ? b_max.y : b_min.y,
+				plane.z > 0.0f ? b_max.z : b_min.z);
+
+			if (glm::dot(glm::vec3(plane), p) + plane.w < 0.0f) return false;
+		}
+
+		return true;
+	}
+
+	float getBoxDistance(const glm::vec3& p, const glm::vec3& b_min, const glm::vec3& b_max)
+	{
+		return glm::length(p - glm::clamp(p, b_min, b_max));
+	}
+
+	// Sphere squashed in y with a lumpy radius, LODs differ in sectors only so they share their silhouette
+	shared_ptr<Mesh> createRock(const string& name, int sectors)
+	{
+		FastNoiseLite noise;
+		noise.SetSeed(7);
+		noise.SetNoiseType(FastNoiseLite::NoiseType_OpenSimplex2);
+		noise.SetFrequency(1.5f);
+
+		int stacks = max(sectors / 2, 2);
+		vector<info::VertexLayout> vertices;
+		for (int j = 0; j <= stacks; ++j)
+		{
+			float phi = glm::pi<float>() * float(j) / float(stacks);
+			for (int i = 0; i <= sectors; ++i)
+			{
+				float theta = 2.0f * glm::pi<float>() * float(i % sectors) / float(sectors);
+				glm::vec3 dir(glm::sin(phi) * glm::cos(theta), glm::cos(phi), glm::sin(phi) * glm::sin(theta));
+				float r = 1.0f + 0.25f * noise.GetNoise(dir.x, dir.y, dir.z);
+
+				info::VertexLayout vertex;
+				vertex.position = dir * r * glm::vec3(1.0f, 0.6f, 1.0f);
+				vertex.texCoord = glm::vec2(float(i) / float(sectors), float(j) / float(stacks));
+				vertices.push_back(vertex);
+			}
+		}
+
+		vector<info::uint> indices;
+		for (int j = 0; j < stacks; ++j)
+		{
+			for (int i = 0; i < sectors; ++i)
+			{
+				info::uint a = info::uint(i + (sectors + 1) * j);
+				info::uint b = a + info::uint(sectors + 1);
+				indices.insert(indices.end(), { a, a + 1, b, a + 1, b + 1, b });
+			}
+		}
+
+		// Area weighted face normals, the seam column shares its position so it ends up the same on both sides
+		for (size_t t = 0; t < indices.size(); t += 3)
+		{
+			info::VertexLayout& v0 = vertices[indices[t]];
+			info::VertexLayout& v1 = vertices[indices[t + 1]];
+			info::VertexLayout& v2 = vertices[indices[t + 2]];
+			glm::vec3 n = glm::cross(v2.position - v0.position, v1.position - v0.position);
+			v0.normal += n;
+			v1.normal += n;
+			v2.normal += n;
+		}
+
+		for (auto& vertex : vertices)
+		{
+			float len = glm::length(vertex.normal);
+			vertex.normal = len > 0.0f ? vertex.normal / len : glm::normalize(vertex.position);
+		}
+
+		shared_ptr<Mesh> mesh = make_shared<Mesh>(name);
+		mesh->setupBuffer(vertices, indices);
+		return mesh;
+	}
+
+	// Crossed upright quads, lit as if they faced up so both sides get the same light
+	shared_ptr<Mesh> createPlant(const string& name, int blades)
+	{
+		vector<info::VertexLayout> vertices;
+		vector<info::uint> indices;
+		for (int i = 0; i < blades; ++i)
+		{
+			float angle = glm::pi<float>() * float(i) / float(blades);
+			glm::vec3 side(0.3f * glm::cos(angle), 0.0f, 0.3f * glm::sin(angle));
+
+			info::uint first = info::uint(vertices.size());
+			const glm::vec2 corners[4] = { { -1.0f, 0.0f }, { 1.0f, 0.0f }, { -1.0f, 1.0f }, { 1.0f, 1.0f } };
+			for (const glm::vec2& corner : corners)
+			{
+				info::VertexLayout vertex;
+				vertex.position = side * corner.x + glm::vec3(0.0f, corner.y, 0.0f);
+				vertex.normal = glm::vec3(0.0f, 1.0f, 0.0f);
+				vertex.texCoord = glm::vec2(corner.x * 0.5f + 0.5f, corner.y);
+				vertices.push_back(vertex);
+			}
+
+			indices.insert(indices.end(), { first, first + 1, first + 2, first + 1, first + 3, first + 2 });
+		}
+
+		shared_ptr<Mesh> mesh = make_shared<Mesh>(name);
+		mesh->setupBuffer(vertices, indices);
+		return mesh;
+	}
+
+	// Patches of density, clamped to [0, 1]
+	void fillDensity(vector<float>& density, int res, float cell, int seed, float base, float contrast)
+	{
+		FastNoiseLite noise;
+		noise.SetSeed(seed);
+		noise.SetNoiseType(FastNoiseLite::NoiseType_OpenSimplex2);
+		noise.SetFrequency(0.05f);
+
+		density.resize(res * res);
+		for (int z = 0; z < res; ++z)
+		{
+			for (int x = 0; x < res; ++x)
+			{
+				float n = noise.GetNoise(float(x) * cell, float(z) * cell);
+				density[x + res * z] = glm::clamp(base + contrast * n, 0.0f, 1.0f);
+			}
+		}
+	}
+}
+
+TerrainScatter::TerrainScatter(int num_tiles, float tile_size, const glm::vec2& origin) :
+	m_instance_buffer(0), m_cell_buffer(0), m_layer_buffer(0), m_command_buffer(0), m_visible_buffer(0),
+	m_origin(origin), m_tile_size(tile_size), m_num_tiles(num_tiles), m_num_instances(0)
+{
+	int res = m_num_tiles * DENSITY_CELLS + 1;
+	float cell = m_tile_size / float(DENSITY_CELLS);
+
+	Layer grass;
+	grass.name = "Grass";
+	grass.color = glm::vec3(0.25f, 0.45f, 0.12f);
+	grass.lods = { createPlant("ScatterGrass0", 4), createPlant("ScatterGrass1", 2) };
+	grass.lod_distances = { 20.0f, 45.0f };
+	grass.spacing = 0.5f;
+	grass.min_scale = 0.3f;
+	grass.max_scale = 0.6f;
+	grass.max_slope = 35.0f;
+	grass.radius = 1.0f;
+	fillDensity(grass.density, res, cell, 11, 0.5f, 0.8f);
+	addLayer(move(grass));
+
+	Layer rocks;
+	rocks.name = "Rocks";
+	rocks.color = glm::vec3(0.42f, 0.40f, 0.37f);
+	rocks.lods = { createRock("ScatterRock0", 16), createRock("ScatterRock1", 8), createRock("ScatterRock2", 5) };
+	rocks.lod_distances = { 30.0f, 80.0f, 160.0f };
+	rocks.spacing = 2.5f;
+	rocks.min_scale = 0.2f;
+	rocks.max_scale = 0.8f;
+	rocks.max_slope = 50.0f;
+	rocks.radius = 1.25f;
+	fillDensity(rocks.density, res, cell, 23, 0.1f, 0.6f);
+	addLayer(move(rocks));
+
+	// Tiles scatter independently, each into its own range
+	int num_tiles2 = m_num_tiles * m_num_tiles;
+	m_instances.resize(m_layers.back().first + m_layers.back().capacity * num_tiles2);
+	m_counts.assign(m_layers.size() * num_tiles2, 0);
+	for (int layer = 0; layer < int(m_layers.size()); ++layer)
+	{
+		parallel::forEach(num_tiles2, [&](int tile) { scatterTile(layer, tile); }, 16);
+	}
+
+	for (int count : m_counts) m_num_instances += count;
+
+	ShaderManager::createShader("Scatter", { "assets/shaders/Scatter.vert", "assets/shaders/Scatter.frag" });
+	ShaderManager::createComputeShader("ScatterCull", "assets/shaders/ScatterCull.comp");
+
+	createBuffers();
+
+	cout << "Scattered " << m_num_instances << " instances over " << num_tiles2 << " tiles" << endl;
+}
+
+TerrainScatter::~TerrainScatter()
+{
+	glDeleteBuffers(1, &m_instance_buffer);
+	glDeleteBuffers(1, &m_cell_buffer);
+	glDeleteBuffers(1, &m_layer_buffer);
+	glDeleteBuffers(1, &m_command_buffer);
+	glDeleteBuffers(1, &m_visible_buffer);
+}
+
+void TerrainScatter::addLayer(Layer&& layer)
+{
+	assert(!layer.lods.empty() && layer.lods.size() <= MAX_LODS);
+
+	int side = max(int(glm::round(m_tile_size / layer.spacing)), 1);
+	layer.spacing = m_tile_size / float(side);
+	layer.capacity = side * side;
+	layer.first = m_layers.empty() ? 0 : m_layers.back().first + m_layers.back().capacity * m_num_tiles * m_num_tiles;
+	layer.first_command = m_layers.empty() ? 0 : m_layers.back().first_command + int(m_layers.back().lods.size());
+	m_layers.push_back(move(layer));
+}
+
+void TerrainScatter::createBuffers()
+{
+	vector<LayerParams> params;
+	for (const Layer& layer : m_layers)
+	{
+		LayerParams p;
+		p.lod_distances = glm::vec4(0.0f);
+		for (int i = 0; i < int(layer.lod_distances.size()); ++i) p.lod_distances[i] = layer.lod_distances[i];
+		p.min_normal_y = glm::cos(glm::radians(layer.max_slope));
+		p.radius = layer.radius;
+		p.num_lods = GLint(layer.lods.size());
+		p.first_command = layer.first_command;
+		params.push_back(p);
+
+		// Every LOD draws the visible instances of its own range
+		for (const auto& mesh : layer.lods)
+		{
+			Command command;
+			command.count = GLuint(mesh->getSizeIndices());
+			command.instance_count = 0;
+			command.first_index = 0;
+			command.base_vertex = 0;
+			command.base_instance = GLuint(m_commands.size() * VISIBLE_CAPACITY);
+			m_commands.push_back(command);
+		}
+	}
+
+	glGenBuffers(1, &m_instance_buffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_instance_buffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, m_instances.size() * sizeof(Instance), m_instances.data(), GL_DYNAMIC_DRAW);
+
+	glGenBuffers(1, &m_layer_buffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_layer_buffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, params.size() * sizeof(LayerParams), params.data(), GL_STATIC_DRAW);
+
+	glGenBuffers(1, &m_command_buffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_command_buffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, m_commands.size() * sizeof(Command), m_commands.data(), GL_DYNAMIC_DRAW);
+
+	glGenBuffers(1, &m_cell_buffer);
+
+	glGenBuffers(1, &m_visible_buffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_visible_buffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, m_commands.size() * VISIBLE_CAPACITY * sizeof(glm::mat4), nullptr, GL_DYNAMIC_COPY);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	for (const Layer& layer : m_layers)
+	{
+		for (const auto& mesh : layer.lods) mesh->setInstanceBuffer(m_visible_buffer);
+	}
+}
+
+float TerrainScatter::getDensity(const Layer& layer, const glm::vec2& p) const
+{
+	int cells = m_num_tiles * DENSITY_CELLS;
+	glm::vec2 g = glm::clamp((p - m_origin) / m_tile_size * float(DENSITY_CELLS), glm::vec2(0.0f), glm::vec2(float(cells)));
+	int x = min(int(g.x), cells - 1);
+	int z = min(int(g.y), cells - 1);
+	float u = g.x - float(x);
+	float v = g.y - float(z);
+
+	int res = cells + 1;
+	const float* d = layer.density.data() + x + res * z;
+	return glm::mix(glm::mix(d[0], d[1], u), glm::mix(d[res], d[res + 1], u), v);
+}
+
+void TerrainScatter::scatterTile(int layer, int tile)
+{
+	const Layer& l = m_layers[layer];
+	int side = int(glm::round(m_tile_size / l.spacing));
+	glm::vec2 corner = m_origin + glm::vec2(tile % m_num_tiles, tile / m_num_tiles) * m_tile_size;
+
+	// Every candidate draws all its numbers, so a density change never moves the others
+	mt19937 rng(uint32_t(tile) * 2654435761u ^ uint32_t(layer + 1) * 40503u);
+	uniform_real_distribution<float> random(0.0f, 1.0f);
+
+	Instance* out = m_instances.data() + l.first + l.capacity * tile;
+	int count = 0;
+	for (int z = 0; z < side; ++z)
+	{
+		for (int x = 0; x < side; ++x)
+		{
+			float u = random(rng);
+			float v = random(rng);
+			float keep = random(rng);
+			float scale = random(rng);
+			float rotation = random(rng);
+
+			glm::vec2 p = corner + (glm::vec2(x, z) + glm::vec2(u, v)) * l.spacing;
+			if (keep >= getDensity(l, p)) continue;
+
+			out[count].position = p;
+			out[count].scale = glm::mix(l.min_scale, l.max_scale, scale);
+			out[count].rotation = rotation * 2.0f * glm::pi<float>();
+			count++;
+		}
+	}
+
+	m_counts[layer * m_num_tiles * m_num_tiles + tile] = count;
+}
+
+void TerrainScatter::paint(int layer, const glm::vec2& center, float radius, float amount)
+{
+	if (layer < 0 || layer >= int(m_layers.size()) || radius <= 0.0f) return;
+
+	Layer& l = m_layers[layer];
+	int cells = m_num_tiles * DENSITY_CELLS;
+	int res = cells + 1;
+	float cell = m_tile_size / float(DENSITY_CELLS);
+	int x0 = glm::clamp(int(glm::floor((center.x - radius - m_origin.x) / cell)), 0, cells);
+	int z0 = glm::clamp(int(glm::floor((center.y - radius - m_origin.y) / cell)), 0, cells);
+	int x1 = glm::clamp(int(glm::ceil((center.x + radius - m_origin.x) / cell)), 0, cells);
+	int z1 = glm::clamp(int(glm::ceil((center.y + radius - m_origin.y) / cell)), 0, cells);
+
+	for (int z = z0; z <= z1; ++z)
+	{
+		for (int x = x0; x <= x1; ++x)
+		{
+			float r = glm::length(m_origin + glm::vec2(x, z) * cell - center);
+			if (r > radius) continue;
+
+			float& d = l.density[x + res * z];
+			d = glm::clamp(d + amount * (1.0f - r / radius), 0.0f, 1.0f);
+		}
+	}
+
+	// Candidates read the density bilinearly, so tiles next to a changed sample change too
+	int tx0 = max((x0 - 1) / DENSITY_CELLS, 0);
+	int tz0 = max((z0 - 1) / DENSITY_CELLS, 0);
+	int tx1 = min(x1 / DENSITY_CELLS, m_num_tiles - 1);
+	int tz1 = min(z1 / DENSITY_CELLS, m_num_tiles - 1);
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_instance_buffer);
+	for (int tz = tz0; tz <= tz1; ++tz)
+	{
+		for (int tx = tx0; tx <= tx1; ++tx)
+		{
+			int tile = tx + m_num_tiles * tz;
+			int& count = m_counts[layer * m_num_tiles * m_num_tiles + tile];
+			m_num_instances -= count;
+			scatterTile(layer, tile);
+			m_num_instances += count;
+
+			int first = l.first + l.capacity * tile;
+			if (count > 0)
+				glBufferSubData(GL_SHADER_STORAGE_BUFFER, first * sizeof(Instance), count * sizeof(Instance), &m_instances[first]);
+		}
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void TerrainScatter::collectCells(
+	const vector<shared_ptr<TerrainTile>>& nodes,
+	const glm::vec3& local_view_pos,
+	const array<glm::vec4, 6>& planes)
+{
+	m_cells.clear();
+
+	// Taller instances reach above the heights of their node
+	float reach = 0.0f;
+	float max_distance = 0.0f;
+	for (const Layer& layer : m_layers)
+	{
+		reach = max(reach, layer.radius * layer.max_scale);
+		max_distance = max(max_distance, layer.lod_distances.back());
+	}
+
+	for (const auto& node : nodes)
+	{
+		if (node->slot < 0) continue;
+
+		// A node of level l is drawn over 2^l x 2^l tiles, each one a cell per layer
+		int span = 1 << node->level;
+		float node_size = m_tile_size * float(span);
+		glm::vec2 node_origin = m_origin + glm::vec2(node->x, node->z) * node_size;
+		for (int tz = node->z * span; tz < (node->z + 1) * span; ++tz)
+		{
+			for (int tx = node->x * span; tx < (node->x + 1) * span; ++tx)
+			{
+				glm::vec2 corner = m_origin + glm::vec2(tx, tz) * m_tile_size;
+				glm::vec3 b_min(corner.x, node->pyramid.getMin() - reach, corner.y);
+				glm::vec3 b_max(corner.x + m_tile_size, node->pyramid.getMax() + reach, corner.y + m_tile_size);
+
+				float d = getBoxDistance(local_view_pos, b_min, b_max);
+				if (d > max_distance) continue;
+				if (!isBoxVisible(planes, b_min, b_max)) continue;
+
+				int tile = tx + m_num_tiles * tz;
+				for (int layer = 0; layer < int(m_layers.size()); ++layer)
+				{
+					const Layer& l = m_layers[layer];
+					int count = m_counts[layer * m_num_tiles * m_num_tiles + tile];
+					if (count == 0 || d > l.lod_distances.back()) continue;
+
+					Cell cell;
+					cell.first = GLuint(l.first + l.capacity * tile);
+					cell.count = GLuint(count);
+					cell.layer = layer;
+					cell.slot = node->slot;
+					cell.node_origin = node_origin;
+					cell.node_size = node_size;
+					cell.unused = 0.0f;
+					m_cells.push_back(cell);
+				}
+			}
+		}
+	}
+}
+
+void TerrainScatter::draw(
+	const glm::mat4& P,
+	const glm::mat4& V,
+	const glm::mat4& M,
+	const glm::vec3& view_pos,
+	const glm::vec3& local_view_pos,
+	const array<glm::vec4, 6>& planes,
+	const Light& light,
+	const vector<shared_ptr<TerrainTile>>& nodes,
+	const HeightMap& height_map,
+	int grid_cells)
+{
+	collectCells(nodes, local_view_pos, planes);
+	if (m_cells.empty()) return;
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_cell_buffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, m_cells.size() * sizeof(Cell), m_cells.data(), GL_STREAM_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_command_buffer);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, m_commands.size() * sizeof(Command), m_commands.data());
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	// Cull, one work group per cell, then clamp the counts that ran past their range
+	shared_ptr<Shader> cull = ShaderManager::getShader("ScatterCull");
+	cull->load();
+	cull->setInt("height_map", 1);
+	cull->setInt("normal_map", 2);
+	height_map.bind(1, 2);
+
+	cull->setInt("grid_cells", grid_cells);
+	for (int i = 0; i < 6; ++i)
+	{
+		cull->setVec4("planes[" + to_string(i) + "]", planes[i]);
+	}
+	cull->setVec3("local_view_pos", local_view_pos);
+	cull->setMat4("model", M);
+	cull->setInt("capacity", VISIBLE_CAPACITY);
+	cull->setInt("num_commands", int(m_commands.size()));
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_instance_buffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_cell_buffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_layer_buffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, m_command_buffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, m_visible_buffer);
+
+	cull->setInt("pass", 0);
+	glDispatchCompute(GLuint(m_cells.size()), 1, 1);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+	cull->setInt("pass", 1);
+	glDispatchCompute(GLuint((m_commands.size() + 63) / 64), 1, 1);
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+
+	// One indirect draw per layer and LOD
+	shared_ptr<Shader> shader = ShaderManager::getShader("Scatter");
+	shader->load();
+	shader->setMat4("projection", P);
+	shader->setMat4("view", V);
+	shader->setVec3("view_pos", view_pos);
+	shader->setLight(light);
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_command_buffer);
+	for (const Layer& layer : m_layers)
+	{
+		shader->setVec3("color", layer.color);
+		for (int i = 0; i < int(layer.lods.size()); ++i)
+		{
+			layer.lods[i]->drawIndirect(GLintptr((layer.first_command + i) * sizeof(Command)));
+		}
+	}
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
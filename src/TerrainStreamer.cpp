@@ -0,0 +1,195 @@
+#include "TerrainStreamer.h"
+
+#include <algorithm>
+
+TerrainStreamer::TerrainStreamer(const string& path, int num_tiles, int tile_cells, int max_resident) :
+	m_quit(false), m_num_tiles(num_tiles), m_tile_cells(tile_cells),
+	m_max_resident(max_resident), m_max_pending(16), m_num_pending(0), m_frame(1)
+{
+	// Levels up to a single root tile
+	m_num_levels = 1;
+	while ((1 << (m_num_levels - 1)) < m_num_tiles) m_num_levels++;
+
+	// Generated tiles outlive their eviction for a while, coming back costs a sum over the cached octaves
+	m_generator = make_unique<TerrainGenerator>(tile_cells, 2 * max_resident);
+	m_file = make_unique<TerrainFile>(path, m_num_tiles, m_num_levels, getTileRes());
+
+	m_worker = thread(&TerrainStreamer::run, this);
+}
+
+TerrainStreamer::~TerrainStreamer()
+{
+	flush();
+
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_quit = true;
+	}
+	m_cv.notify_one();
+	m_worker.join();
+}
+
+uint64_t TerrainStreamer::getKey(int level, int x, int z)
+{
+	return (uint64_t(level) << 56) | (uint64_t(uint32_t(x) & 0xFFFFFFF) << 28) | uint64_t(uint32_t(z) & 0xFFFFFFF);
+}
+
+shared_ptr<TerrainTile> TerrainStreamer::request(int level, int x, int z)
+{
+	if (level < 0 || level >= m_num_levels) return nullptr;
+	if (x < 0 || z < 0 || x >= getNumTiles(level) || z >= getNumTiles(level)) return nullptr;
+
+	auto it = m_tiles.find(getKey(level, x, z));
+	if (it != m_tiles.end())
+	{
+		it->second->last_used = m_frame;
+		if (it->second->state == TerrainTile::READY) return it->second;
+		return nullptr;
+	}
+
+	if (m_num_pending >= m_max_pending) return nullptr;
+
+	shared_ptr<TerrainTile> tile = make_shared<TerrainTile>(level, x, z);
+	tile->last_used = m_frame;
+	m_tiles[getKey(level, x, z)] = tile;
+	m_num_pending++;
+
+	Job job;
+	job.tile = tile;
+	push(move(job));
+
+	return nullptr;
+}
+
+shared_ptr<TerrainTile> TerrainStreamer::find(int level, int x, int z) const
+{
+	auto it = m_tiles.find(getKey(level, x, z));
+	if (it == m_tiles.end() || it->second->state != TerrainTile::READY) return nullptr;
+	return it->second;
+}
+
+void TerrainStreamer::update(vector<shared_ptr<TerrainTile>>& loaded, vector<shared_ptr<TerrainTile>>& evicted)
+{
+	loaded.clear();
+	evicted.clear();
+
+	m_num_pending = 0;
+	vector<shared_ptr<TerrainTile>> unused;
+	for (const auto& it : m_tiles)
+	{
+		const shared_ptr<TerrainTile>& tile = it.second;
+		int state = tile->state;
+		if (state == TerrainTile::LOADING) m_num_pending++;
+		else if (state == TerrainTile::LOADED) loaded.push_back(tile);
+
+		// Anything the last frame did not touch can go, loads in flight stay
+		if (state != TerrainTile::LOADING && tile->last_used < m_frame) unused.push_back(tile);
+	}
+
+	int excess = int(m_tiles.size()) - m_max_resident;
+	if (excess > 0)
+	{
+		sort(unused.begin(), unused.end(),
+			[](const shared_ptr<TerrainTile>& lhs, const shared_ptr<TerrainTile>& rhs)
+			{
+				return lhs->last_used < rhs->last_used;
+			});
+
+		for (int i = 0; i < min(excess, int(unused.size())); ++i)
+		{
+			const shared_ptr<TerrainTile>& tile = unused[i];
+			if (tile->dirty) pushSave(*tile);
+
+			m_tiles.erase(getKey(tile->level, tile->x, tile->z));
+			evicted.push_back(tile);
+		}
+
+		loaded.erase(remove_if(loaded.begin(), loaded.end(),
+			[this](const shared_ptr<TerrainTile>& tile)
+			{
+				return m_tiles.find(getKey(tile->level, tile->x, tile->z)) == m_tiles.end();
+			}), loaded.end());
+	}
+
+	m_frame++;
+}
+
+void TerrainStreamer::flush()
+{
+	for (const auto& it : m_tiles)
+	{
+		const shared_ptr<TerrainTile>& tile = it.second;
+		if (!tile->dirty || tile->state != TerrainTile::READY) continue;
+
+		pushSave(*tile);
+
+		// Saved heights are the tile's own from now on, new noise settings leave it alone
+		tile->dirty = false;
+		tile->generated = false;
+	}
+}
+
+void TerrainStreamer::getTiles(vector<shared_ptr<TerrainTile>>& tiles) const
+{
+	tiles.clear();
+	for (const auto& it : m_tiles)
+	{
+		if (it.second->state == TerrainTile::READY) tiles.push_back(it.second);
+	}
+}
+
+void TerrainStreamer::push(Job&& job)
+{
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_jobs.push_back(move(job));
+	}
+	m_cv.notify_one();
+}
+
+void TerrainStreamer::pushSave(const TerrainTile& tile)
+{
+	Job job;
+	job.level = tile.level;
+	job.x = tile.x;
+	job.z = tile.z;
+	job.heights = tile.heights;
+	push(move(job));
+}
+
+void TerrainStreamer::run()
+{
+	while (true)
+	{
+		Job job;
+		{
+			unique_lock<mutex> lock(m_mutex);
+			m_cv.wait(lock, [this]() { return m_quit || !m_jobs.empty(); });
+
+			// Pending saves are still written on quit
+			if (m_jobs.empty()) return;
+
+			job = move(m_jobs.front());
+			m_jobs.pop_front();
+		}
+
+		if (job.tile) load(*job.tile);
+		else save(job);
+	}
+}
+
+void TerrainStreamer::load(TerrainTile& tile)
+{
+	int res = getTileRes();
+	tile.generated = !m_file->read(tile.level, tile.x, tile.z, tile.heights);
+	if (tile.generated) m_generator->generateTile(tile.level, tile.x, tile.z, tile.heights, tile.noise_version);
+
+	tile.normals.assign(res * res, glm::vec3(0.0f, 1.0f, 0.0f));
+	tile.pyramid.build(tile.heights, res);
+	tile.state = TerrainTile::LOADED;
+}
+
+void TerrainStreamer::save(const Job& job)
+{
+	m_file->write(job.level, job.x, job.z, job.heights);
+}
@@ -0,0 +1,125 @@
+#include "TetCache.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "MappedFile.h"
+
+static const uint32_t TET_CACHE_MAGIC = 0x54455443; // "TETC"
+static const uint32_t TET_CACHE_VERSION = 2;
+
+// FNV-1a, 64 bit
+static void hashBytes(uint64_t& h, const void* data, size_t size)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (size_t i = 0; i < size; ++i)
+	{
+		h ^= bytes[i];
+		h *= 1099511628211ull;
+	}
+}
+
+uint64_t TetCache::computeKey(
+	const vector<glm::vec3>& vertices,
+	const vector<info::uint>& indices,
+	float dx, const glm::vec3& b_min, const glm::vec3& b_max)
+{
+	uint64_t h = 14695981039346656037ull;
+	hashBytes(h, &TET_CACHE_VERSION, sizeof(TET_CACHE_VERSION));
+	hashBytes(h, vertices.data(), vertices.size() * sizeof(glm::vec3));
+	hashBytes(h, indices.data(), indices.size() * sizeof(info::uint));
+	hashBytes(h, &dx, sizeof(float));
+	hashBytes(h, &b_min, sizeof(glm::vec3));
+	hashBytes(h, &b_max, sizeof(glm::vec3));
+
+	return h;
+}
+
+string TetCache::getPath(uint64_t key)
+{
+	stringstream ss;
+	ss << "assets/cache/tet_" << hex << key << ".bin";
+	return ss.str();
+}
+
+bool TetCache::load(uint64_t key, TetData& data)
+{
+	MappedFile file(getPath(key));
+	if (file.getData() == nullptr || file.getSize() < sizeof(Header)) return false;
+
+	Header header;
+	memcpy(&header, file.getData(), sizeof(Header));
+	if (header.magic != TET_CACHE_MAGIC || header.version != TET_CACHE_VERSION || header.key != key)
+	{
+		cout << "Ignore stale tet cache " << getPath(key) << endl;
+		return false;
+	}
+
+	size_t size_vertices = header.num_vertices * sizeof(glm::vec3);
+	size_t size_tets = header.num_tets * sizeof(glm::ivec4);
+	size_t size_edges = header.num_edges * sizeof(glm::ivec2);
+	size_t size_rest_d = header.num_edges * sizeof(float);
+	size_t size_rest_v = header.num_tets * sizeof(float);
+	if (file.getSize() != sizeof(Header) + size_vertices + size_tets + size_edges + size_rest_d + size_rest_v)
+	{
+		cout << "Ignore truncated tet cache " << getPath(key) << endl;
+		return false;
+	}
+
+	const char* p = file.getData() + sizeof(Header);
+
+	data.vertices.resize(header.num_vertices);
+	memcpy(data.vertices.data(), p, size_vertices);
+	p += size_vertices;
+
+	data.tets.resize(header.num_tets);
+	memcpy(data.tets.data(), p, size_tets);
+	p += size_tets;
+
+	data.edges.resize(header.num_edges);
+	memcpy(data.edges.data(), p, size_edges);
+	p += size_edges;
+
+	data.rest_d.resize(header.num_edges);
+	memcpy(data.rest_d.data(), p, size_rest_d);
+	p += size_rest_d;
+
+	data.rest_v.resize(header.num_tets);
+	memcpy(data.rest_v.data(), p, size_rest_v);
+
+	return true;
+}
+
+bool TetCache::save(uint64_t key, const TetData& data)
+{
+	error_code ec;
+	filesystem::create_directories("assets/cache", ec);
+
+	// Write to a temporary file first so that a crash never leaves a half written cache behind
+	string path = getPath(key);
+	string tmp_path = path + ".tmp";
+
+	{
+		ofstream file(tmp_path, ios::binary | ios::trunc);
+		if (!file.is_open())
+		{
+			cout << "Failed to write tet cache " << path << endl;
+			return false;
+		}
+
+		Header header = { TET_CACHE_MAGIC, TET_CACHE_VERSION, key, data.vertices.size(), data.tets.size(), data.edges.size() };
+		file.write((const char*)&header, sizeof(Header));
+		file.write((const char*)data.vertices.data(), data.vertices.size() * sizeof(glm::vec3));
+		file.write((const char*)data.tets.data(), data.tets.size() * sizeof(glm::ivec4));
+		file.write((const char*)data.edges.data(), data.edges.size() * sizeof(glm::ivec2));
+		file.write((const char*)data.rest_d.data(), data.rest_d.size() * sizeof(float));
+		file.write((const char*)data.rest_v.data(), data.rest_v.size() * sizeof(float));
+		if (!file.good()) return false;
+	}
+
+	filesystem::rename(tmp_path, path, ec);
+	return !ec;
+}